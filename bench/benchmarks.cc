@@ -0,0 +1,846 @@
+#include <algorithm> // copy_n, fill_n, min
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>   // exit
+#include <cstring>   // memset
+#include <fstream>
+#include <iostream>
+#include <iterator>  // back_inserter
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/galois_field.hh"
+#include "netcode/detail/gf_region.hh"
+#include "netcode/detail/incremental_encoder.hh"
+#include "netcode/detail/invert_matrix.hh"
+#include "netcode/detail/packetizer.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source_list.hh"
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/udp_transport.hh"
+
+#include "bench/harness.hh"
+#include "tools/loss/burst.hh"
+#include "tools/loss/uniform.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+using ntc::detail::byte_buffer;
+
+/// @brief The number of items given at once to batched entry points, as read by recvmmsg().
+constexpr auto batch_size = 32u;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Command line configuration.
+struct configuration
+{
+  std::chrono::milliseconds min_time = std::chrono::milliseconds{200};
+  std::string filter = "";
+  std::string output = "";
+  unsigned int loss = 5;
+  std::uint8_t gf_size = 8;
+  std::uint16_t symbol_size = 1024;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Generate a deterministic pseudo-random buffer.
+byte_buffer
+random_buffer(std::size_t size, unsigned int seed)
+{
+  std::default_random_engine gen{seed};
+  std::uniform_int_distribution<int> dist{0, 255};
+  auto buffer = byte_buffer(size);
+  for (auto& byte : buffer)
+  {
+    byte = static_cast<char>(dist(gen));
+  }
+  return buffer;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet handler which keeps the last written packet.
+struct last_packet_handler
+{
+  ntc::packet pkt;
+
+  void
+  operator()(const char* data, std::size_t len)
+  noexcept
+  {
+    std::copy_n(data, len, std::back_inserter(pkt));
+  }
+
+  void
+  operator()()
+  noexcept
+  {}
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet handler which takes a whole packet as an array of iovec, without copying it.
+struct gather_packet_handler
+{
+  std::size_t size = 0;
+
+  void
+  operator()(const ::iovec* iov, std::size_t iovcnt)
+  noexcept
+  {
+    size = 0;
+    for (auto i = 0ul; i < iovcnt; ++i)
+    {
+      size += iov[i].iov_len;
+    }
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet handler which stores all packets.
+struct packets_handler
+{
+  std::vector<ntc::packet> packets;
+  ntc::packet current;
+
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    std::copy_n(data, len, std::back_inserter(current));
+  }
+
+  void
+  operator()()
+  {
+    packets.push_back(std::move(current));
+    current = ntc::packet{};
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A handler which discards everything.
+struct null_handler
+{
+  void
+  operator()(const char*, std::size_t)
+  noexcept
+  {}
+
+  void
+  operator()()
+  noexcept
+  {}
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+galois_field_benchmarks(bench::runner& r, const configuration& conf)
+{
+  for (const auto w : {4u, 8u, 16u, 32u})
+  {
+    ntc::detail::galois_field gf{static_cast<std::uint8_t>(w)};
+    const auto src = random_buffer(conf.symbol_size, 0);
+    auto dst = random_buffer(conf.symbol_size, 1);
+    const auto coeff = gf.coefficient(3, 7);
+
+    r.run( "galois_field/multiply", {{"w", w}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               gf.multiply(src.data(), dst.data(), src.size(), coeff);
+               bench::do_not_optimize(dst);
+             }
+           });
+
+    r.run( "galois_field/multiply_add", {{"w", w}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               gf.multiply_add(src.data(), dst.data(), src.size(), coeff);
+               bench::do_not_optimize(dst);
+             }
+           });
+
+    // Compare with 'multiply_add' for the same number of bytes written.
+    const auto nb_sources = 16u;
+    std::vector<byte_buffer> sources;
+    std::vector<const char*> symbols;
+    std::vector<std::size_t> sizes;
+    std::vector<std::uint32_t> coefficients;
+    for (auto i = 0u; i < nb_sources; ++i)
+    {
+      sources.emplace_back(random_buffer(conf.symbol_size, i));
+      symbols.emplace_back(sources.back().data());
+      sizes.emplace_back(conf.symbol_size);
+      coefficients.emplace_back(gf.coefficient(3, i));
+    }
+    r.run( "galois_field/dot_product"
+         , {{"w", w}, {"symbol_size", conf.symbol_size}, {"sources", nb_sources}}
+         , conf.symbol_size * nb_sources
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               gf.dot_product( symbols.data(), sizes.data(), coefficients.data(), nb_sources
+                             , dst.data(), dst.size());
+               bench::do_not_optimize(dst);
+             }
+           });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+gf_region_benchmarks(bench::runner& r, const configuration& conf)
+{
+  for (const auto w : {4u, 8u, 16u, 32u})
+  {
+    const auto src = random_buffer(conf.symbol_size, 0);
+    auto dst = random_buffer(conf.symbol_size, 1);
+    const auto coeff = ntc::detail::galois_field{static_cast<std::uint8_t>(w)}.coefficient(3, 7);
+
+    // The reference, to compare kernels with.
+    gf_t gf;
+    gf_init_easy(&gf, static_cast<int>(w));
+    r.run( "gf_region/gf-complete/multiply_add", {{"w", w}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               gf.multiply_region.w32( &gf, const_cast<char*>(src.data()), dst.data(), coeff
+                                     , static_cast<int>(src.size()), 1);
+               bench::do_not_optimize(dst);
+             }
+           });
+    gf_free(&gf, 0);
+
+    for (const auto& kernels : ntc::detail::gf_region_available())
+    {
+      const auto kernel = kernels.get(w).multiply;
+      if (kernel == nullptr)
+      {
+        continue;
+      }
+      r.run( std::string{"gf_region/"} + kernels.name + "/multiply_add"
+           , {{"w", w}, {"symbol_size", conf.symbol_size}}
+           , conf.symbol_size
+           , [&](std::uint64_t n)
+             {
+               ntc::detail::gf_region_coefficient c;
+               for (auto i = 0ul; i < n; ++i)
+               {
+                 ntc::detail::gf_region_prepare(c, w, coeff);
+                 kernel(c, src.data(), dst.data(), src.size(), true);
+                 bench::do_not_optimize(dst);
+               }
+             });
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder_benchmarks(bench::runner& r, const configuration& conf)
+{
+  for (const auto window : {1u, 8u, 64u, 256u, 1024u})
+  {
+    ntc::detail::source_list sources;
+    for (auto id = 0u; id < window; ++id)
+    {
+      sources.emplace(id, random_buffer(conf.symbol_size, id));
+    }
+    ntc::detail::encoder encoder{conf.gf_size};
+    ntc::detail::encoder_repair repair{0};
+
+    r.run( "encoder/repair"
+         , {{"w", conf.gf_size}, {"window", window}, {"symbol_size", conf.symbol_size}}
+         , window * conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               repair.reset();
+               repair.id() = static_cast<std::uint32_t>(i);
+               encoder(repair, sources);
+               bench::do_not_optimize(repair);
+             }
+           });
+
+    // The window doesn't slide: once all accumulators have been emitted, each repair rebuilds its
+    // accumulator from the window, which is the worst case.
+    ntc::detail::incremental_encoder incremental{conf.gf_size, 8};
+    r.run( "encoder/incremental_repair"
+         , { {"w", conf.gf_size}, {"window", window}, {"nb_accumulators", 8}
+           , {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               repair.reset();
+               repair.id() = static_cast<std::uint32_t>(i);
+               incremental(repair, sources);
+               bench::do_not_optimize(repair);
+             }
+           });
+
+    // The whole path of a source given to the encoder, once its window is full.
+    ntc::encoder<null_handler> full_encoder{conf.gf_size, null_handler{}};
+    full_encoder.set_window_size(window);
+    const auto data = random_buffer(conf.symbol_size, 0);
+    r.run( "encoder/commit"
+         , {{"w", conf.gf_size}, {"window", window}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               full_encoder(data);
+             }
+             bench::do_not_optimize(full_encoder.window());
+           });
+
+    // The same path without acks nor window limit, each repair encoding only the last sources.
+    ntc::encoder<null_handler> banded_encoder{conf.gf_size, null_handler{}};
+    banded_encoder.set_band_width(window);
+    r.run( "encoder/commit/banded"
+         , {{"w", conf.gf_size}, {"band_width", window}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               banded_encoder(data);
+             }
+             bench::do_not_optimize(banded_encoder.window());
+           });
+
+    // The same path, with sources given in bursts.
+    ntc::encoder<null_handler> batch_encoder{conf.gf_size, null_handler{}};
+    batch_encoder.set_window_size(window);
+    const auto batch = std::vector<ntc::data>(batch_size, data);
+    r.run( "encoder/commit/batch"
+         , { {"w", conf.gf_size}, {"window", window}, {"symbol_size", conf.symbol_size}
+           , {"batch_size", batch_size}}
+         , batch_size * conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               batch_encoder.commit(batch);
+             }
+             bench::do_not_optimize(batch_encoder.window());
+           });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+invert_benchmarks(bench::runner& r, const configuration& conf)
+{
+  ntc::detail::galois_field gf{conf.gf_size};
+  for (const auto dimension : {4ul, 16ul, 64ul, 256ul})
+  {
+    // Build the same kind of matrix as the decoder does when all sources are missing.
+    ntc::detail::square_matrix coefficients{dimension};
+    for (auto col = 0ul; col < dimension; ++col)
+    {
+      for (auto row = 0ul; row < dimension; ++row)
+      {
+        coefficients(row, col) = gf.coefficient( static_cast<std::uint32_t>(col)
+                                               , static_cast<std::uint32_t>(row));
+      }
+    }
+    // invert() overwrites its input: copies are made before the timed region, a few at a time
+    // so that reading the clock doesn't weigh on small matrices.
+    std::vector<ntc::detail::square_matrix> mats(16, coefficients);
+    ntc::detail::square_matrix inv{dimension};
+
+    r.run_timed( "invert", {{"w", conf.gf_size}, {"dimension", dimension}}, 0
+               , [&](std::uint64_t n)
+                 {
+                   auto elapsed = bench::runner::clock::duration{0};
+                   for (auto i = 0ul; i < n; i += mats.size())
+                   {
+                     const auto nb = std::min<std::uint64_t>(n - i, mats.size());
+                     std::fill_n(mats.begin(), nb, coefficients);
+                     const auto start = bench::runner::clock::now();
+                     for (auto j = 0ul; j < nb; ++j)
+                     {
+                       bench::do_not_optimize(ntc::detail::invert(gf, mats[j], inv));
+                     }
+                     elapsed += bench::runner::clock::now() - start;
+                   }
+                   return elapsed;
+                 });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+packetizer_benchmarks(bench::runner& r, const configuration& conf)
+{
+  for (const auto nb_ids : {1u, 64u, 1024u})
+  {
+    auto ids = ntc::detail::source_id_list{};
+    for (auto id = 0u; id < nb_ids; ++id)
+    {
+      ids.insert(ids.end(), id);
+    }
+    auto symbol = ntc::detail::zero_byte_buffer(conf.symbol_size, 'x');
+    const ntc::detail::encoder_repair repair{ 42, conf.symbol_size, std::move(ids)
+                                            , std::move(symbol)};
+
+    last_packet_handler h;
+    ntc::detail::packetizer<last_packet_handler> packetizer{h};
+    h.pkt.reserve(4 * conf.symbol_size + 4 * nb_ids);
+
+    r.run( "packetizer/write_repair", {{"nb_ids", nb_ids}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               h.pkt.clear();
+               packetizer.write_repair(repair);
+               bench::do_not_optimize(h.pkt);
+             }
+           });
+
+    gather_packet_handler gh;
+    ntc::detail::packetizer<gather_packet_handler> gather_packetizer{gh};
+    r.run( "packetizer/write_repair/gather", {{"nb_ids", nb_ids}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               gather_packetizer.write_repair(repair);
+               bench::do_not_optimize(gh.size);
+             }
+           });
+
+    const auto serialized = h.pkt;
+    r.run( "packetizer/read_repair", {{"nb_ids", nb_ids}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               bench::do_not_optimize(packetizer.read_repair(ntc::packet{serialized}));
+             }
+           });
+
+    r.run( "packetizer/write_repair/v4", {{"nb_ids", nb_ids}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               h.pkt.clear();
+               packetizer.write_repair(repair, ntc::wire_version::v4);
+               bench::do_not_optimize(h.pkt);
+             }
+           });
+
+    const auto serialized_v4 = h.pkt;
+    r.run( "packetizer/read_repair/v4", {{"nb_ids", nb_ids}, {"symbol_size", conf.symbol_size}}
+         , conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               bench::do_not_optimize(packetizer.read_repair(ntc::packet{serialized_v4}));
+             }
+           });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder_benchmarks(bench::runner& r, const configuration& conf)
+{
+  static constexpr auto nb_sources = 1000u;
+
+  for (const auto window : {16u, 128u})
+  {
+    // Encode a stream once, then replay it with losses to fresh decoders.
+    ntc::encoder<packets_handler> encoder{conf.gf_size, packets_handler{}};
+    encoder.set_rate(5).set_window_size(window);
+    for (auto id = 0u; id < nb_sources; ++id)
+    {
+      encoder(random_buffer(conf.symbol_size, id));
+    }
+
+    std::vector<ntc::packet> received;
+    if (conf.loss == 0)
+    {
+      received = encoder.packet_handler().packets;
+    }
+    else
+    {
+      loss::uniform lose{100 - conf.loss};
+      for (const auto& pkt : encoder.packet_handler().packets)
+      {
+        if (not lose())
+        {
+          received.push_back(pkt);
+        }
+      }
+    }
+
+    for (const auto engine : {ntc::decoding_engine::full, ntc::decoding_engine::progressive})
+    {
+      r.run( engine == ntc::decoding_engine::full ? "decoder" : "decoder/progressive"
+           , { {"w", conf.gf_size}, {"window", window}, {"loss_percent", conf.loss}
+             , {"nb_sources", nb_sources}, {"symbol_size", conf.symbol_size}}
+           , nb_sources * conf.symbol_size
+           , [&](std::uint64_t n)
+             {
+               for (auto i = 0ul; i < n; ++i)
+               {
+                 ntc::decoder<null_handler, null_handler> decoder{ conf.gf_size, ntc::in_order::yes
+                                                                 , null_handler{}, null_handler{}};
+                 decoder.set_ack_frequency(std::chrono::milliseconds{0});
+                 decoder.set_decoding_engine(engine);
+                 for (const auto& pkt : received)
+                 {
+                   decoder(pkt);
+                 }
+                 bench::do_not_optimize(decoder.nb_decoded());
+               }
+             });
+    }
+
+    // Losses come in bursts, about 10 packets long.
+    std::vector<ntc::packet> received_burst;
+    loss::burst lose_burst{99, 90};
+    for (const auto& pkt : encoder.packet_handler().packets)
+    {
+      if (not lose_burst())
+      {
+        received_burst.push_back(pkt);
+      }
+    }
+    // Sources decoded together are rebuilt by one thread, or by a pool of threads.
+    for (const auto nb_threads : {1ul, 4ul})
+    {
+      r.run( nb_threads == 1 ? "decoder/burst_loss" : "decoder/burst_loss/threads"
+           , { {"w", conf.gf_size}, {"window", window}, {"nb_sources", nb_sources}
+             , {"symbol_size", conf.symbol_size}, {"threads", nb_threads}}
+           , nb_sources * conf.symbol_size
+           , [&](std::uint64_t n)
+             {
+               for (auto i = 0ul; i < n; ++i)
+               {
+                 ntc::decoder<null_handler, null_handler> decoder{ conf.gf_size, ntc::in_order::yes
+                                                                 , null_handler{}, null_handler{}};
+                 decoder.set_ack_frequency(std::chrono::milliseconds{0});
+                 decoder.set_decoding_threads(nb_threads);
+                 for (const auto& pkt : received_burst)
+                 {
+                   decoder(pkt);
+                 }
+                 bench::do_not_optimize(decoder.nb_decoded());
+               }
+             });
+    }
+
+    // Packets are received in bursts, as with recvmmsg().
+    r.run( "decoder/batch"
+         , { {"w", conf.gf_size}, {"window", window}, {"loss_percent", conf.loss}
+           , {"nb_sources", nb_sources}, {"symbol_size", conf.symbol_size}
+           , {"batch_size", batch_size}}
+         , nb_sources * conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               ntc::decoder<null_handler, null_handler> decoder{ conf.gf_size, ntc::in_order::yes
+                                                               , null_handler{}, null_handler{}};
+               decoder.set_ack_frequency(std::chrono::milliseconds{0});
+               for (auto first = received.cbegin(); first != received.cend();)
+               {
+                 const auto last
+                   = first + std::min<std::ptrdiff_t>(batch_size, received.cend() - first);
+                 decoder.receive(first, last);
+                 first = last;
+               }
+               bench::do_not_optimize(decoder.nb_decoded());
+             }
+           });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#if defined(__linux__)
+
+/// @brief Two UDP sockets on the loopback, the first one connected to the second one.
+struct loopback_sockets
+{
+  int tx;
+  int rx;
+
+  loopback_sockets()
+    : tx{::socket(AF_INET, SOCK_DGRAM, 0)}
+    , rx{::socket(AF_INET, SOCK_DGRAM, 0)}
+  {
+    ::sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto len = static_cast<::socklen_t>(sizeof(addr));
+    if ( ::bind(rx, reinterpret_cast<const ::sockaddr*>(&addr), len) != 0
+      or ::getsockname(rx, reinterpret_cast<::sockaddr*>(&addr), &len) != 0
+      or ::connect(tx, reinterpret_cast<const ::sockaddr*>(&addr), len) != 0)
+    {
+      throw std::runtime_error{"Can't open sockets on the loopback"};
+    }
+    const auto buffer_size = 1 << 22;
+    ::setsockopt(tx, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    ::setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    // Don't wait forever if a packet is lost.
+    const auto timeout = ::timeval{1, 0};
+    ::setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+
+  ~loopback_sockets()
+  {
+    ::close(tx);
+    ::close(rx);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+transport_benchmarks(bench::runner& r, const configuration& conf)
+{
+  if (not r.enabled("transport"))
+  {
+    return;
+  }
+
+  loopback_sockets sockets;
+  const auto payload = random_buffer(conf.symbol_size, 0);
+  std::vector<ntc::packet> packets(batch_size, ntc::packet(conf.symbol_size));
+
+  // One system call for each packet.
+  r.run( "transport/send_recv", {{"packets", batch_size}, {"symbol_size", conf.symbol_size}}
+       , batch_size * conf.symbol_size
+       , [&](std::uint64_t n)
+         {
+           for (auto i = 0ul; i < n; ++i)
+           {
+             for (auto j = 0ul; j < batch_size; ++j)
+             {
+               ::send(sockets.tx, payload.data(), payload.size(), 0);
+             }
+             for (auto j = 0ul; j < batch_size; ++j)
+             {
+               if (::recv(sockets.rx, packets[j].data(), packets[j].size(), 0) < 0)
+               {
+                 break;
+               }
+             }
+             bench::do_not_optimize(packets);
+           }
+         });
+
+  // One system call for each batch, with and without offloads.
+  for (const auto offload : {false, true})
+  {
+    ntc::udp_transport tx{sockets.tx, batch_size, conf.symbol_size};
+    ntc::udp_transport rx{sockets.rx, batch_size, conf.symbol_size};
+    if ( tx.set_segmentation_offload(offload) != offload
+      or rx.set_receive_offload(offload) != offload)
+    {
+      // Not supported by the kernel.
+      continue;
+    }
+    auto writer = tx.make_writer();
+    r.run( offload ? "transport/mmsg/offload" : "transport/mmsg"
+         , {{"packets", batch_size}, {"symbol_size", conf.symbol_size}}
+         , batch_size * conf.symbol_size
+         , [&](std::uint64_t n)
+           {
+             for (auto i = 0ul; i < n; ++i)
+             {
+               for (auto j = 0ul; j < batch_size; ++j)
+               {
+                 std::copy_n(payload.data(), payload.size(), writer(payload.size()));
+                 writer();
+               }
+               tx.flush();
+               for (auto nb = 0ul; nb < batch_size;)
+               {
+                 const auto res = rx.receive(packets.begin(), packets.end());
+                 if (res == 0)
+                 {
+                   break;
+                 }
+                 nb += res;
+               }
+               bench::do_not_optimize(packets);
+             }
+           });
+  }
+}
+
+#endif // defined(__linux__)
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Print usage and exit
+/// @param status 0 when usage was asked for, written to stdout; an error otherwise, on stderr
+void
+usage(const char* name, int status = 1)
+{
+  (status == 0 ? std::cout : std::cerr)
+    << "Usage: " << name << " [options]\n"
+    << "  --filter <string>   only run benchmarks whose name contains <string>\n"
+    << "  --min-time <ms>     minimal time spent measuring each benchmark (default: 200)\n"
+    << "  --loss <percent>    loss rate of the decoder benchmark, in [0,100) (default: 5)\n"
+    << "  --gf <w>            Galois field size of encoder/decoder benchmarks (default: 8)\n"
+    << "  --symbol-size <n>   size of symbols, in bytes (default: 1024)\n"
+    << "  --output <file>     write JSON results to <file> instead of stdout\n"
+    << "  --help              print this message\n";
+  std::exit(status);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+configuration
+parse_arguments(int argc, char** argv)
+{
+  configuration conf;
+  for (auto i = 1; i < argc; ++i)
+  {
+    const auto arg = std::string{argv[i]};
+    if (arg == "--help" or arg == "-h")
+    {
+      usage(argv[0], 0);
+    }
+    if (i + 1 == argc)
+    {
+      usage(argv[0]);
+    }
+    const auto value = std::string{argv[++i]};
+    try
+    {
+      if (arg == "--filter")
+      {
+        conf.filter = value;
+      }
+      else if (arg == "--min-time")
+      {
+        conf.min_time = std::chrono::milliseconds{std::stoul(value)};
+      }
+      else if (arg == "--loss")
+      {
+        conf.loss = static_cast<unsigned int>(std::stoul(value));
+      }
+      else if (arg == "--gf")
+      {
+        conf.gf_size = static_cast<std::uint8_t>(std::stoul(value));
+      }
+      else if (arg == "--symbol-size")
+      {
+        conf.symbol_size = static_cast<std::uint16_t>(std::stoul(value));
+      }
+      else if (arg == "--output")
+      {
+        conf.output = value;
+      }
+      else
+      {
+        usage(argv[0]);
+      }
+    }
+    catch (const std::exception&)
+    {
+      usage(argv[0]);
+    }
+  }
+
+  if ( conf.loss >= 100 or conf.symbol_size == 0
+    or not (conf.gf_size == 4 or conf.gf_size == 8 or conf.gf_size == 16 or conf.gf_size == 32)
+    or conf.symbol_size % (conf.gf_size < 8 ? 1 : conf.gf_size / 8) != 0)
+  {
+    usage(argv[0]);
+  }
+  return conf;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, char** argv)
+{
+  const auto conf = parse_arguments(argc, argv);
+
+  bench::runner r{conf.min_time, conf.filter};
+  galois_field_benchmarks(r, conf);
+  gf_region_benchmarks(r, conf);
+  encoder_benchmarks(r, conf);
+  invert_benchmarks(r, conf);
+  packetizer_benchmarks(r, conf);
+  decoder_benchmarks(r, conf);
+#if defined(__linux__)
+  transport_benchmarks(r, conf);
+#endif
+
+  if (conf.output.empty())
+  {
+    r.write_json(std::cout);
+  }
+  else
+  {
+    std::ofstream file{conf.output};
+    if (not file.is_open())
+    {
+      std::cerr << "Can't open " << conf.output << '\n';
+      return 2;
+    }
+    r.write_json(file);
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
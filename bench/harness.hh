@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm> // max
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>   // pair
+#include <vector>
+
+namespace bench {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The outcome of a single benchmark
+struct result
+{
+  /// @brief The benchmark's name, e.g. "galois_field/multiply_add"
+  std::string name;
+
+  /// @brief The parameters of this run, e.g. {"w", 8}
+  std::vector<std::pair<std::string, std::uint64_t>> parameters;
+
+  /// @brief How many times the measured operation was executed
+  std::uint64_t iterations;
+
+  /// @brief The mean time spent in one operation, in nanoseconds
+  double ns_per_op;
+
+  /// @brief The number of bytes processed by one operation, 0 if not meaningful
+  std::uint64_t bytes_per_op;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Run benchmarks and collect their results
+class runner
+{
+public:
+
+  /// @brief The clock used to measure operations
+  using clock = std::chrono::steady_clock;
+
+  /// @brief Constructor
+  /// @param min_time The minimal time to spend measuring each benchmark
+  /// @param filter Only run benchmarks whose name contains this string
+  runner(std::chrono::milliseconds min_time, std::string filter)
+    : m_min_time{min_time}
+    , m_filter(std::move(filter))
+    , m_results()
+  {}
+
+  /// @brief Tell if a benchmark should be run
+  bool
+  enabled(const std::string& name)
+  const
+  {
+    return m_filter.empty() or name.find(m_filter) != std::string::npos;
+  }
+
+  /// @brief Measure an operation
+  /// @param fn The operation, called with the number of times it should be executed
+  ///
+  /// The number of iterations is doubled until the minimal time is reached. It's up to @p fn to
+  /// prepare its state before the loop it runs, so that only the operation is measured.
+  void
+  run( const std::string& name, std::vector<std::pair<std::string, std::uint64_t>> parameters
+     , std::uint64_t bytes_per_op, const std::function<void(std::uint64_t)>& fn)
+  {
+    run_timed( name, std::move(parameters), bytes_per_op
+             , [&](std::uint64_t n)
+               {
+                 const auto start = clock::now();
+                 fn(n);
+                 return clock::now() - start;
+               });
+  }
+
+  /// @brief Measure an operation which needs an untimed preparation before each execution
+  /// @param fn The operation, called with the number of times it should be executed, which
+  /// returns the time it spent in the measured part only
+  void
+  run_timed( const std::string& name, std::vector<std::pair<std::string, std::uint64_t>> parameters
+           , std::uint64_t bytes_per_op
+           , const std::function<clock::duration(std::uint64_t)>& fn)
+  {
+    if (not enabled(name))
+    {
+      return;
+    }
+
+    // Warm caches and lazily allocated memory.
+    fn(1);
+
+    auto iterations = std::uint64_t{1};
+    while (true)
+    {
+      const auto elapsed = fn(iterations);
+      if (elapsed >= m_min_time or iterations >= (std::uint64_t{1} << 40))
+      {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        m_results.push_back(result{ name, std::move(parameters), iterations
+                                  , static_cast<double>(ns) / static_cast<double>(iterations)
+                                  , bytes_per_op});
+        return;
+      }
+      iterations *= 2;
+    }
+  }
+
+  /// @brief Write all collected results as a JSON document
+  void
+  write_json(std::ostream& os)
+  const
+  {
+    os << "{\n  \"benchmarks\": [";
+    for (auto i = 0ul; i < m_results.size(); ++i)
+    {
+      const auto& r = m_results[i];
+      os << (i == 0 ? "\n" : ",\n")
+         << "    {\"name\": \"" << r.name << "\", \"parameters\": {";
+      for (auto j = 0ul; j < r.parameters.size(); ++j)
+      {
+        os << (j == 0 ? "" : ", ") << '"' << r.parameters[j].first << "\": "
+           << r.parameters[j].second;
+      }
+      os << "}, \"iterations\": " << r.iterations
+         << ", \"ns_per_op\": " << r.ns_per_op;
+      if (r.bytes_per_op != 0)
+      {
+        // Bytes per nanosecond is GB/s, a thousand times that is MB/s.
+        os << ", \"mb_per_s\": "
+           << static_cast<double>(r.bytes_per_op) / std::max(r.ns_per_op, 1e-9) * 1000;
+      }
+      os << '}';
+    }
+    os << "\n  ]\n}\n";
+  }
+
+private:
+
+  /// @brief The minimal time to spend measuring each benchmark
+  const std::chrono::milliseconds m_min_time;
+
+  /// @brief Only run benchmarks whose name contains this string
+  const std::string m_filter;
+
+  /// @brief All collected results
+  std::vector<result> m_results;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Prevent the compiler from optimizing away a computation
+template <typename T>
+inline
+void
+do_not_optimize(const T& value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace bench
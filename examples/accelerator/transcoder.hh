@@ -1,6 +1,5 @@
 #pragma once
 
-#include <algorithm> // copy_n
 #include <chrono>
 #include <memory>
 #include <iostream>
@@ -50,7 +49,7 @@ private:
   udp::socket& socket;
   udp::endpoint& endpoint;
 
-  std::vector<char> buffer;
+  std::vector<asio::const_buffer> buffers;
 
 public:
 
@@ -61,23 +60,21 @@ public:
   packet_handler& operator=(packet_handler&&) = default;
 
   packet_handler(udp::socket& sock, udp::endpoint& end)
-    : socket(sock), endpoint(end), buffer()
+    : socket(sock), endpoint(end), buffers()
   {}
 
-  /// @brief This function is invoked repeatedly until the packet is complete
+  /// @brief This function is invoked once with a complete packet, as a list of buffers
+  ///
+  /// The buffers are sent in a single datagram, without copying them.
   void
-  operator()(const char* data, std::size_t sz)
-  {
-    std::copy_n(data, sz, std::back_inserter(buffer));
-  }
-
-  /// @brief This function is invoked when the packet received by the previous callback is complete
-  void
-  operator()()
+  operator()(const ::iovec* iov, std::size_t iovcnt)
   {
-    // End of packet, we can now send it.
-    socket.send_to(asio::buffer(buffer), endpoint);
-    buffer.clear();
+    buffers.clear();
+    for (auto i = 0ul; i < iovcnt; ++i)
+    {
+      buffers.emplace_back(iov[i].iov_base, iov[i].iov_len);
+    }
+    socket.send_to(buffers, endpoint);
   }
 };
 
@@ -125,7 +122,6 @@ public:
                                                      , data_handler(m_app_socket, m_app_endpoint))
     , m_encoder(8, packet_handler(m_socket, m_endpoint))
     , m_packet(buffer_size)
-    , m_data(buffer_size)
     , m_other_side_seen(false)
   {
     // Deactivate automatic sending of ack by the library, we'll take care of it.
@@ -177,7 +173,9 @@ private:
   void
   start_app_handler()
   {
-    m_app_socket.async_receive_from( asio::buffer(m_data)
+    // The data is received directly in the encoder's window, it won't be copied.
+    const auto buffer = m_encoder.reserve_source(buffer_size);
+    m_app_socket.async_receive_from( asio::buffer(buffer, buffer_size)
                                    , m_app_endpoint
                                    , [this](const asio::error_code& err, std::size_t len)
                                      {
@@ -188,15 +186,9 @@ private:
 
                                        if (len > 0)
                                        {
-                                         // m_data has been filled by asio, but we still need to
+                                         // The buffer has been filled by asio, we just need to
                                          // tell to netcode how many bytes were really written.
-                                         m_data.resize(len);
-
-                                         // We can now safely give the data to the encoder.
-                                         m_encoder(std::move(m_data));
-
-                                         // To avoid allocating a new data, we reset m_data.
-                                         m_data.resize(buffer_size);
+                                         m_encoder.commit_reserved(len);
                                        }
 
                                        // Listen again for incoming data.
@@ -287,9 +279,6 @@ private:
   /// @brief Store packets received from the tunnel
   ntc::packet m_packet;
 
-  /// @brief Store data received from the proxied application
-  ntc::data m_data;
-
   /// @brief Set the first time a packet has been exchanged with the other side of the tunnel
   bool m_other_side_seen;
 };
@@ -64,3 +64,22 @@ noexcept
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_set_decoding_engine(ntc_decoder_t* dec, ntc_decoding_engine engine)
+noexcept
+{
+  dec->set_decoding_engine( engine == ntc_decoding_engine_full ? ntc::decoding_engine::full
+                                                               : ntc::decoding_engine::progressive);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_set_decoding_threads(ntc_decoder_t* dec, size_t nb, ntc_error* error)
+noexcept
+{
+  ntc::detail::check_error([&]{dec->set_decoding_threads(nb);}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
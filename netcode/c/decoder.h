@@ -29,6 +29,12 @@ typedef enum {ntc_in_order_yes, ntc_in_order_no} ntc_ordering_type;
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_decoder
+/// @brief Describe how a decoder rebuilds lost sources from repairs
+typedef enum {ntc_decoding_engine_full, ntc_decoding_engine_progressive} ntc_decoding_engine;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_decoder
 /// @return A new decoder if allocation suceeded; a null pointer otherwise
 ntc_decoder_t*
@@ -96,6 +102,31 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_decoder
+/// @brief Configure how a decoder rebuilds lost sources from repairs
+/// @note The default engine of a decoder is ntc_decoding_engine_full
+/// @note Pending repairs are dropped when the engine changes
+void
+ntc_decoder_set_decoding_engine(ntc_decoder_t* dec, ntc_decoding_engine engine)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Configure how many threads rebuild lost sources with the full engine
+/// @param dec The decoder to configure
+/// @param nb The number of threads, including the one which gives packets to the decoder
+/// @param error The reported error, if any
+/// @note The default is 1, that is the thread which gives packets to the decoder
+/// @pre @p nb > 0
+void
+ntc_decoder_set_decoding_threads(ntc_decoder_t* dec, size_t nb, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -33,6 +33,24 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+char*
+ntc_encoder_reserve_data(ntc_encoder_t* enc, size_t size, ntc_error* error)
+noexcept
+{
+  return ntc::detail::check_error([&]{return enc->reserve_source(size);}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_commit_reserved_data(ntc_encoder_t* enc, size_t size, ntc_error* error)
+noexcept
+{
+  ntc::detail::check_error([&]{enc->commit_reserved(size);}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 size_t
 ntc_encoder_add_packet(ntc_encoder_t* enc, ntc_packet_t* packet, ntc_error* error)
 noexcept
@@ -96,3 +114,30 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+void
+ntc_encoder_set_nb_accumulators(ntc_encoder_t* enc, size_t nb, ntc_error* error)
+noexcept
+{
+  ntc::detail::check_error([&]{enc->set_nb_accumulators(nb);}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_band_width(ntc_encoder_t* enc, size_t nb)
+noexcept
+{
+  enc->set_band_width(nb);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_wire_version(ntc_encoder_t* enc, ntc_wire_version version)
+noexcept
+{
+  enc->set_wire_version(version == ntc_wire_version_v1 ? ntc::wire_version::v1
+                                                       : ntc::wire_version::v2);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -30,6 +30,12 @@ typedef enum {ntc_systematic_yes, ntc_systematic_no} ntc_code_type;
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Describe the version of the wire format of packets
+typedef enum {ntc_wire_version_v1, ntc_wire_version_v2} ntc_wire_version;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @return A new decoder if allocation suceeded; a null pointer otherwise
 ntc_encoder_t*
@@ -63,6 +69,35 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Get a buffer to write the next data of an encoder in place
+/// @param enc The encoder which will own the data
+/// @param size The maximal size of the next data
+/// @param error The reported error, if any
+/// @return A buffer of @p size bytes, valid until another data is given to @p enc
+/// @pre @p size > 0
+/// @note The returned value is invalid if an error occurred
+/// @see ntc_encoder_commit_reserved_data
+char*
+ntc_encoder_reserve_data(ntc_encoder_t* enc, size_t size, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Let an encoder handle the data written in the buffer given by ntc_encoder_reserve_data()
+/// @param enc The encoder to notify
+/// @param size The size of the data, at most the size given to ntc_encoder_reserve_data()
+/// @param error The reported error, if any
+/// @pre @p size > 0
+void
+ntc_encoder_commit_reserved_data(ntc_encoder_t* enc, size_t size, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @brief Notify an encoder with a new incoming packet
 /// @param enc The encoder to notify
@@ -150,6 +185,43 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Configure the number of accumulators used to generate repairs incrementally
+/// @param enc The encoder to configure
+/// @param nb The number of accumulators, 0 to encode the whole window for each repair
+/// @param error The reported error, if any
+/// @note An encoder doesn't use accumulators by default
+void
+ntc_encoder_set_nb_accumulators(ntc_encoder_t* enc, size_t nb, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure the number of most recent sources encoded by each repair
+/// @param enc The encoder to configure
+/// @param nb The number of sources, 0 to encode the whole window for each repair
+/// @note An encoder encodes the whole window by default
+void
+ntc_encoder_set_band_width(ntc_encoder_t* enc, size_t nb)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure the version of the wire format used until the decoder advertises its own
+/// @param enc The encoder to configure
+/// @param version The version of the wire format
+/// @note An encoder uses v1 by default, then the version advertised by acks
+void
+ntc_encoder_set_wire_version(ntc_encoder_t* enc, ntc_wire_version version)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
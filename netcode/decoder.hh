@@ -5,7 +5,13 @@
 #include "netcode/detail/serialize_packet.hh"
 #endif
 
+#include <algorithm> // max
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <iterator> // begin, end
+#include <utility> // pair
+#include <vector>
 
 #include "netcode/detail/decoder.hh"
 #include "netcode/detail/packet_type.hh"
@@ -13,8 +19,10 @@
 #include "netcode/detail/repair.hh"
 #include "netcode/detail/source.hh"
 #include "netcode/detail/visibility.hh"
+#include "netcode/decoding_engine.hh"
 #include "netcode/errors.hh"
 #include "netcode/in_order.hh"
+#include "netcode/wire_version.hh"
 
 namespace ntc {
 
@@ -22,6 +30,8 @@ namespace ntc {
 
 /// @ingroup ntc_decoder
 /// @brief The class to interact with on the receiver side.
+///
+/// @p PacketHandler is given acks the same way as encoder's packet handler is given packets.
 template <typename PacketHandler, typename DataHandler>
 class NTC_PUBLIC decoder final
 {
@@ -56,6 +66,9 @@ public:
     , m_ack_nb_packets{50}
     , m_last_ack_date(std::chrono::steady_clock::now())
     , m_ack{}
+    , m_encoder_version{wire_version::v1}
+    , m_max_latency{0}
+    , m_deadlines{}
     , m_decoder{ m_galois_field_size
                  // The real decoder needs to know how to handle decoded or received sources.
                , [this](const detail::decoder_source& src){handle_source(src);}
@@ -66,6 +79,9 @@ public:
     , m_nb_received_repairs{0}
     , m_nb_received_sources{0}
     , m_nb_sent_ack{0}
+    , m_in_batch{false}
+    , m_batch_dated{false}
+    , m_batch_date()
 #ifdef NTC_DUMP_PACKETS
     , m_dump_file{NTC_DUMP_PACKETS_FILE}
 #endif
@@ -97,11 +113,31 @@ public:
     switch (detail::get_packet_type(p))
     {
       case detail::packet_type::repair:
+      case detail::packet_type::keyed_repair:
       {
         ++m_nb_received_repairs;
         ++m_ack.nb_packets();
-        auto res = m_packetizer.read_repair(std::move(p));
-        m_decoder(std::move(res.first));
+        // The encoder understands at least the version of its repairs.
+        m_encoder_version = std::max(m_encoder_version, detail::get_wire_version(p));
+        const auto block_end = detail::ends_block(p);
+        auto end = std::uint32_t{0};
+        // Repairs which are not needed are dropped before their list of sources is built.
+        auto res = m_packetizer.read_repair( std::move(p)
+                                           , [&]( std::uint32_t id
+                                                , const std::vector<detail::source_id_range>& r)
+                                             {
+                                               end = r.empty() ? 0 : r.back().last;
+                                               return m_decoder.drop_repair(id, r);
+                                             });
+        if (res.first)
+        {
+          m_decoder(std::move(*res.first));
+        }
+        if (block_end)
+        {
+          m_decoder.close_block(end);
+        }
+        check_deadlines();
         return res.second;
       }
 
@@ -111,6 +147,7 @@ public:
         ++m_ack.nb_packets();
         auto res = m_packetizer.read_source(std::move(p));
         m_decoder(std::move(res.first));
+        check_deadlines();
         return res.second;
       }
 
@@ -121,6 +158,46 @@ public:
     }
   }
 
+  /// @brief Notify the decoder of several incoming packets.
+  ///
+  /// Packets of a mutable range are moved from. The need for an ack is checked once all packets
+  /// have been processed, rather than after each delivered source.
+  /// @return The number of read bytes.
+  template <typename InputIterator>
+  std::size_t
+  receive(InputIterator first, InputIterator last)
+  {
+    auto nb_read = std::size_t{0};
+    m_in_batch = true;
+    m_batch_dated = false;
+    try
+    {
+      for (; first != last; ++first)
+      {
+        nb_read += operator()(std::move(*first));
+      }
+    }
+    catch (...)
+    {
+      m_in_batch = false;
+      throw;
+    }
+    m_in_batch = false;
+    maybe_ack();
+    return nb_read;
+  }
+
+  /// @brief Notify the decoder of several incoming packets.
+  /// @see receive(InputIterator, InputIterator)
+  template <typename Range>
+  std::size_t
+  receive(Range&& r)
+  {
+    using std::begin;
+    using std::end;
+    return receive(begin(r), end(r));
+  }
+
   /// @brief Get the data handler.
   const packet_handler_type&
   packet_handler()
@@ -174,7 +251,7 @@ public:
   nb_missing_sources()
   const noexcept
   {
-    return m_decoder.missing_sources().size();
+    return m_decoder.nb_missing_sources();
   }
 
   /// @brief Get the total number of received repairs.
@@ -209,18 +286,49 @@ public:
     return m_decoder.nb_useless_repairs();
   }
 
+  /// @brief Tell if acks are cumulative.
+  ///
+  /// Acks list all known sources until a repair shows that the encoder understands cumulative
+  /// acks, which only carry what changed since the previous ack.
+  /// @see wire_version
+  bool
+  cumulative_acks()
+  const noexcept
+  {
+    return m_encoder_version >= wire_version::v3;
+  }
+
   /// @brief Force the generation of an ack.
   void
   generate_ack()
   {
-    // Add all currently known source identifiers to the ack to be sent.
-    for (const auto& id_src : m_decoder.sources())
+    if (cumulative_acks())
+    {
+      // Acknowledge all sources up to the first missing one, then the ones held after it.
+      const auto first_missing = m_decoder.first_missing_source();
+      m_ack.cumulative() = true;
+      m_ack.first_missing() = first_missing;
+      for (const auto& r : m_decoder.held_sources())
+      {
+        if (r.first > first_missing)
+        {
+          m_ack.ranges().push_back(r);
+        }
+      }
+      m_decoder.clear_held_sources();
+    }
+    else
     {
-      m_ack.source_ids().insert(m_ack.source_ids().end(), id_src.first);
+      // Add all currently known source identifiers to the ack to be sent.
+      const auto& sources = m_decoder.sources();
+      for (auto cit = sources.begin(), end = sources.end(); cit != end; ++cit)
+      {
+        m_ack.source_ids().insert(m_ack.source_ids().end(), cit.id());
+      }
     }
 
     // Ask packetizer to handle the bytes of the new ack (will be routed to user's handler).
-    m_packetizer.write_ack(m_ack);
+    m_packetizer.write_ack(m_ack, m_encoder_version);
     ++m_nb_sent_ack;
 
     // Start a fresh new ack.
@@ -286,8 +394,204 @@ public:
     return m_ack_nb_packets;
   }
 
+  /// @brief Set how missing sources are rebuilt from repairs.
+  /// @note Pending repairs are dropped when the engine changes.
+  decoder&
+  set_decoding_engine(ntc::decoding_engine engine)
+  noexcept
+  {
+    m_decoder.set_engine(engine);
+    return *this;
+  }
+
+  /// @brief Get how missing sources are rebuilt from repairs.
+  ntc::decoding_engine
+  decoding_engine()
+  const noexcept
+  {
+    return m_decoder.engine();
+  }
+
+  /// @brief Get the pool of buffers of this decoder.
+  ///
+  /// Packets received from the network should be constructed with this pool, see
+  /// @ref packet::packet(packet_pool&, size_type). The decoder keeps them as sources and repairs,
+  /// then their buffers are reused by the next packets once the decoder drops them. Decoded sources
+  /// also take their buffers from this pool.
+  /// @attention The pool is not thread-safe, packets shall be constructed by the decoder's thread.
+  packet_pool&
+  pool()
+  noexcept
+  {
+    return m_decoder.pool();
+  }
+
+  /// @brief Set the number of threads which rebuild missing sources with the full engine.
+  ///
+  /// Missing sources decoded together are rebuilt in parallel, the calling thread included. The
+  /// data handler is still called by the calling thread, in order if required.
+  /// @note The default is 1, that is sources are rebuilt by the calling thread only.
+  decoder&
+  set_decoding_threads(std::size_t nb)
+  {
+    m_decoder.set_nb_threads(nb);
+    return *this;
+  }
+
+  /// @brief Get the number of threads which rebuild missing sources.
+  std::size_t
+  decoding_threads()
+  const noexcept
+  {
+    return m_decoder.nb_threads();
+  }
+
+  /// @brief Set how many identifiers of sources the decoder keeps track of.
+  ///
+  /// Missing sources more than @p nb identifiers older than the most recent received one are given
+  /// up on: the sources which wait for them are delivered and their repairs are dropped. It bounds
+  /// the state of the decoder when acks don't reach the encoder, as in a one-way operation.
+  /// A packet so far ahead that all known sources would be given up on is ignored, unless the next
+  /// such packet is near it: a single corrupted identifier doesn't reset the decoder.
+  /// When @p nb == 0, the default of 2^16 identifiers is restored.
+  decoder&
+  set_max_span(std::uint32_t nb)
+  noexcept
+  {
+    m_decoder.set_max_span(nb != 0 ? nb : detail::decoder::sources_set_type::default_max_span);
+    return *this;
+  }
+
+  /// @brief Get how many identifiers of sources the decoder keeps track of.
+  std::uint32_t
+  max_span()
+  const noexcept
+  {
+    return m_decoder.max_span();
+  }
+
+  /// @brief Set how long a received or decoded source may wait for older missing sources.
+  ///
+  /// When a source can't be delivered in order since @p latency, the missing sources before it are
+  /// given up on and it is delivered, whether it was received or decoded. Given up sources are
+  /// never delivered, even if they are decoded later. Deadlines are checked when a packet is
+  /// received, or when expire() is called; packets given at once to receive() share one date.
+  /// With in-order delivery, it bounds the reordering delay, see set_gap_handler().
+  /// When @p latency == 0 (the default), there is no deadline.
+  decoder&
+  set_max_latency(std::chrono::milliseconds latency)
+  noexcept
+  {
+    m_max_latency = latency;
+    if (latency.count() == 0)
+    {
+      m_deadlines.clear();
+      m_decoder.set_hold_callback(nullptr);
+    }
+    else
+    {
+      // Received or decoded sources which wait for older missing ones start their clock.
+      m_decoder.set_hold_callback([this](std::uint32_t id){start_deadline(id);});
+    }
+    return *this;
+  }
+
+  /// @brief Get how long a source may wait for older missing sources, 0 if forever.
+  std::chrono::milliseconds
+  max_latency()
+  const noexcept
+  {
+    return m_max_latency;
+  }
+
+  /// @brief Give up on the missing sources which are waited for since more than max_latency().
+  ///
+  /// Should be called periodically when no packets are received for a while.
+  void
+  expire()
+  {
+    if (m_max_latency.count() == 0 or m_deadlines.empty())
+    {
+      return;
+    }
+    const auto now = date();
+    while (not m_deadlines.empty())
+    {
+      const auto& front = m_deadlines.front();
+      if (front.first >= m_decoder.first_missing_source())
+      {
+        if (now - front.second < m_max_latency)
+        {
+          break;
+        }
+        m_decoder.skip_to(front.first);
+      }
+      // Otherwise, the missing sources were received or decoded in time.
+      m_deadlines.pop_front();
+    }
+  }
+
+  /// @brief Set the handler notified when in-order delivery skips missing sources.
+  ///
+  /// @p h is called with the range [first, last) of identifiers of the skipped sources, just before
+  /// the data which follow them are given to the data handler, whether these data were received or
+  /// decoded. Sources are skipped when they are given up on, see set_max_latency() and
+  /// set_max_span(), or when repairs no longer encode them.
+  /// @note Never called with in_order::no, as sources are delivered as soon as they are known.
+  decoder&
+  set_gap_handler(std::function<void(std::uint32_t first, std::uint32_t last)> h)
+  {
+    m_decoder.set_gap_callback(std::move(h));
+    return *this;
+  }
+
+  /// @brief Get the total number of missing sources skipped by in-order delivery.
+  std::size_t
+  nb_skipped_sources()
+  const noexcept
+  {
+    return m_decoder.nb_skipped();
+  }
+
 private:
 
+  /// @brief Give up on sources which waited for too long once a packet has been handled.
+  void
+  check_deadlines()
+  {
+    if (m_max_latency.count() != 0)
+    {
+      expire();
+    }
+  }
+
+  /// @brief Start the clock of a source which waits for older missing sources.
+  void
+  start_deadline(std::uint32_t id)
+  {
+    // A source older than the last one waiting is released no later than it.
+    if (m_deadlines.empty() or m_deadlines.back().first < id)
+    {
+      m_deadlines.emplace_back(id, date());
+    }
+  }
+
+  /// @brief Get the current date, read once for all the packets of a batch.
+  std::chrono::steady_clock::time_point
+  date()
+  {
+    if (not m_in_batch)
+    {
+      return std::chrono::steady_clock::now();
+    }
+    if (not m_batch_dated)
+    {
+      m_batch_date = std::chrono::steady_clock::now();
+      m_batch_dated = true;
+    }
+    return m_batch_date;
+  }
+
   /// @brief Callback given to the real encoder to be notified when a source is processed.
   void
   handle_source(const detail::decoder_source& src)
@@ -295,8 +599,11 @@ private:
     // Ask user to read the bytes of this new source.
     m_data_handler(src.symbol(), src.symbol_size());
 
-    // Send an ack if necessary.
-    maybe_ack();
+    // Send an ack if necessary, batches are checked once at the end.
+    if (not m_in_batch)
+    {
+      maybe_ack();
+    }
   }
 
 private:
@@ -316,6 +623,15 @@ private:
   /// @brief Re-use the same memory to prepare an ack packet.
   detail::ack m_ack;
 
+  /// @brief The highest version of the wire format of received repairs.
+  wire_version m_encoder_version;
+
+  /// @brief How long a received source may wait for older missing sources, 0 if forever.
+  std::chrono::milliseconds m_max_latency;
+
+  /// @brief The sources waiting for older missing sources, with the date they started to wait.
+  std::deque<std::pair<std::uint32_t, std::chrono::steady_clock::time_point>> m_deadlines;
+
   /// @brief The component that rebuilds sources using repairs.
   detail::decoder m_decoder;
 
@@ -337,6 +653,15 @@ private:
   /// @brief The number of ack sent back to the encoder.
   std::size_t m_nb_sent_ack;
 
+  /// @brief Tell if packets are being processed by receive().
+  bool m_in_batch;
+
+  /// @brief Tell if the date of the current batch has been read.
+  bool m_batch_dated;
+
+  /// @brief The date of the current batch.
+  std::chrono::steady_clock::time_point m_batch_date;
+
 #ifdef NTC_DUMP_PACKETS
   std::ofstream m_dump_file;
 #endif
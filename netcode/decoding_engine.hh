@@ -0,0 +1,21 @@
+#pragma once
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Describe how a decoder rebuilds lost sources from repairs.
+///
+/// - full: repairs are stored as they arrive, missing sources are rebuilt all at once by inverting
+///   the matrix of coefficients when there are as many repairs as missing sources.
+/// - progressive: each arriving repair is eliminated against the repairs already received, which
+///   are kept in reduced row echelon form. The cost of the decoding is spread over arrivals and a
+///   missing source is delivered as soon as it's determined.
+/// @see decoder::set_decoding_engine
+/// @see decoder::decoding_engine
+/// @ingroup ntc_decoder
+enum class decoding_engine {full, progressive};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "netcode/detail/source_id_list.hh"
+#include "netcode/wire_version.hh"
 
 namespace ntc { namespace detail {
 
@@ -8,6 +12,11 @@ namespace ntc { namespace detail {
 
 /// @internal
 /// @brief An acknowledgement packet.
+///
+/// A legacy ack lists all the sources known by the decoder. A cumulative ack acknowledges all
+/// sources before the first missing one, as well as ranges of sources received or decoded after
+/// it since the previous ack. Thus, its size doesn't depend on the number of sources kept by the
+/// decoder.
 class ack final
 {
 public:
@@ -27,13 +36,33 @@ public:
   /// @brief Default constructor.
   ack()
     : m_source_ids{}
+    , m_cumulative{false}
+    , m_first_missing{0}
+    , m_ranges{}
     , m_nb_packets{0}
+    , m_version{wire_version::v5}
   {}
 
-  /// @brief Constructor.
-  explicit ack(source_id_list&& source_ids, std::uint16_t nb_packets)
+  /// @brief Constructor of a legacy ack.
+  explicit ack( source_id_list&& source_ids, std::uint16_t nb_packets
+              , wire_version version = wire_version::v5)
     : m_source_ids{std::move(source_ids)}
+    , m_cumulative{false}
+    , m_first_missing{0}
+    , m_ranges{}
+    , m_nb_packets{nb_packets}
+    , m_version{version}
+  {}
+
+  /// @brief Constructor of a cumulative ack.
+  ack( std::uint32_t first_missing, std::vector<source_id_range>&& ranges
+     , std::uint16_t nb_packets, wire_version version = wire_version::v5)
+    : m_source_ids{}
+    , m_cumulative{true}
+    , m_first_missing{first_missing}
+    , m_ranges{std::move(ranges)}
     , m_nb_packets{nb_packets}
+    , m_version{version}
   {}
 
   /// @brief Get the list of acknowledged sources.
@@ -52,14 +81,65 @@ public:
     return m_source_ids;
   }
 
+  /// @brief Tell if this ack is a cumulative one.
+  bool
+  cumulative()
+  const noexcept
+  {
+    return m_cumulative;
+  }
+
+  /// @brief Tell if this ack is a cumulative one.
+  bool&
+  cumulative()
+  noexcept
+  {
+    return m_cumulative;
+  }
+
+  /// @brief Get the identifier of the first missing source of a cumulative ack.
+  ///
+  /// All sources with a smaller identifier are acknowledged.
+  std::uint32_t
+  first_missing()
+  const noexcept
+  {
+    return m_first_missing;
+  }
+
+  /// @brief Get the identifier of the first missing source of a cumulative ack.
+  std::uint32_t&
+  first_missing()
+  noexcept
+  {
+    return m_first_missing;
+  }
+
+  /// @brief Get the sorted ranges of sources acknowledged after the first missing one.
+  const std::vector<source_id_range>&
+  ranges()
+  const noexcept
+  {
+    return m_ranges;
+  }
+
+  /// @brief Get the sorted ranges of sources acknowledged after the first missing one.
+  std::vector<source_id_range>&
+  ranges()
+  noexcept
+  {
+    return m_ranges;
+  }
+
   /// @brief Reset this ack.
   ///
-  /// List of source identifiers is resized to 0.
+  /// Lists of source identifiers and of ranges are resized to 0.
   void
   reset()
   noexcept
   {
     m_source_ids.clear();
+    m_ranges.clear();
     m_nb_packets = 0;
   }
 
@@ -79,13 +159,33 @@ public:
     return m_nb_packets;
   }
 
+  /// @brief Get the highest version of the wire format understood by the decoder.
+  wire_version
+  version()
+  const noexcept
+  {
+    return m_version;
+  }
+
 private:
 
-  /// @brief The list of acknowledged sources.
+  /// @brief The list of acknowledged sources, for a legacy ack.
   source_id_list m_source_ids;
 
+  /// @brief Tell if this ack is a cumulative one.
+  bool m_cumulative;
+
+  /// @brief All sources before this one are acknowledged, for a cumulative ack.
+  std::uint32_t m_first_missing;
+
+  /// @brief The ranges of sources acknowledged after the first missing one, for a cumulative ack.
+  std::vector<source_id_range> m_ranges;
+
   /// @brief The number of received packet since the last ack.
   std::uint16_t m_nb_packets;
+
+  /// @brief The highest version of the wire format understood by the decoder.
+  wire_version m_version;
 };
 
 /*------------------------------------------------------------------------------------------------*/
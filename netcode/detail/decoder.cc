@@ -1,5 +1,7 @@
-#include <algorithm>  // all_of
+#include <algorithm>  // all_of, max, min, sort, upper_bound
 #include <cassert>
+#include <iterator>   // prev
+#include <limits>     // numeric_limits
 #include <vector>
 
 #include "netcode/detail/decoder.hh"
@@ -9,23 +11,80 @@ namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
+namespace /* unnamed */ {
+
+/// @brief Tell if @p id is too far behind the values of @p w to be added.
+template <typename Window>
+bool
+too_old(const Window& w, std::uint32_t id)
+noexcept
+{
+  return not w.empty() and id < w.begin().id() and not w.fits(id);
+}
+
+/// @brief Tell if adding @p id to @p w would push all its values out of its span.
+template <typename Window>
+bool
+beyond(const Window& w, std::uint32_t id)
+noexcept
+{
+  return w.empty() or (id >= w.end_id() and id + 1 - w.end_id() >= w.max_span());
+}
+
+/// @brief Tell if a far ahead identifier was preceded by another one nearby, then remember it.
+///
+/// A single packet with a corrupted or forged identifier must not make a decoder give up on all
+/// the state it keeps track of.
+bool
+corroborated(boost::optional<std::uint32_t>& far, std::uint32_t id, std::uint32_t span)
+noexcept
+{
+  const auto res = far and std::max(*far, id) - std::min(*far, id) < span;
+  far = res ? boost::none : boost::make_optional(id);
+  return res;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
 decoder::decoder( std::uint8_t galois_field_size, std::function<void(const decoder_source&)> h
                 , in_order order)
-  : m_gf{galois_field_size}
+  : m_packet_pool{}
+  , m_gf{galois_field_size}
   , m_in_order{order == in_order::yes}
-  , m_first_missing_source_in_order{0}
-  , m_ordered_sources{}
+  , m_first_missing_source{0}
+  , m_held_sources()
   , m_callback(std::move(h))
+  , m_gap_callback()
+  , m_hold_callback()
+  , m_engine{decoding_engine::full}
   , m_repairs{}
   , m_sources{}
   , m_last_id{}
+  , m_block_end{}
+  , m_skipped{0}
+  , m_far_source{}
+  , m_far_repair{}
   , m_missing_sources{}
+  , m_degree_one{}
+  , m_echelon{m_gf, m_packet_pool}
   , m_nb_useless_repairs{0}
   , m_nb_failed_full_decodings{0}
   , m_nb_decoded{0}
+  , m_nb_skipped{0}
   , m_coefficients{32}
   , m_inv{32}
+  , m_last_ids()
+  , m_prefix()
   , m_index()
+  , m_decoded_sources()
+  , m_symbols()
+  , m_sizes()
+  , m_dot_coefficients()
+  , m_offsets()
+  , m_pool()
+  , m_pool_gfs()
 {}
 
 /*------------------------------------------------------------------------------------------------*/
@@ -45,8 +104,22 @@ decoder::operator()(decoder_source&& src)
     return;
   }
 
-  add_source_recursive(std::move(src));
-  attempt_full_decoding();
+  if (not admit_sources(src.id(), src.id()))
+  {
+    // Too old to be kept with the current sources.
+    return;
+  }
+
+  if (m_engine == decoding_engine::progressive)
+  {
+    add_source_progressive(std::move(src));
+  }
+  else
+  {
+    add_source_and_peel(std::move(src));
+    attempt_full_decoding();
+  }
+  release_block();
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -69,6 +142,12 @@ decoder::operator()(decoder_repair&& incoming_r)
     return;
   }
 
+  if (not admit_sources(*incoming_r.source_ids().begin(), last_id_in_source_ids))
+  {
+    // Encodes sources too old or too many to be kept.
+    return;
+  }
+
   // Remove sources with an id strictly less than the smallest the current repair encodes.
   // Remove repairs which encodes sources with an id smaller than the smallest the current repair
   // encodes.
@@ -88,14 +167,22 @@ decoder::operator()(decoder_repair&& incoming_r)
     return;
   }
 
+  if (m_engine == decoding_engine::progressive)
+  {
+    add_repair_progressive(std::move(incoming_r));
+    return;
+  }
+
+  if (not admit_repair(incoming_r.id()))
+  {
+    return;
+  }
+
   // Add this repair to the set of known repairs.
   const auto r_id = incoming_r.id(); // to force evaluation order in the following call.
-  const auto insertion = m_repairs.emplace(r_id, std::move(incoming_r));
-  assert(insertion.second && "Repair with the same id already processed");
+  auto& r = m_repairs.emplace(r_id, std::move(incoming_r));
 
   // Don't use incoming_r beyond this point (as it was moved into repairs_), instead use r.
-  auto r_cit = insertion.first;
-  auto& r = insertion.first->second;
 
   // Remove from incoming repair all existing sources and link with missing sources.
   // Reverse loop as flat_set::erase() invalidates iterators behind the one being erased.
@@ -103,10 +190,10 @@ decoder::operator()(decoder_repair&& incoming_r)
       ; ++id_rcit)
   {
     const auto search = m_sources.find(*id_rcit);
-    if (search != m_sources.end())
+    if (search)
     {
       // The source has already been received.
-      remove_source_data_from_repair(search->second /* source */, r);
+      remove_source_data_from_repair(*search /* source */, r);
 
       // Get the 'normal' iterator corresponding to the current reverse iterator.
       // http://stackoverflow.com/a/1830240/21584
@@ -116,15 +203,15 @@ decoder::operator()(decoder_repair&& incoming_r)
     else // Link this repair with the missing sources it references.
     {
       auto search_src_id = m_missing_sources.find(*id_rcit);
-      if (search_src_id == m_missing_sources.end())
+      if (not search_src_id)
       {
         // Create missing source.
-        m_missing_sources.emplace(*id_rcit, repairs_iterators_type{r_cit});
+        m_missing_sources.emplace(*id_rcit, repair_ids_type{r_id});
       }
       else
       {
         // The missing source already exists.
-        search_src_id->second.emplace(r_cit);
+        search_src_id->emplace(r_id);
       }
     }
   }
@@ -133,22 +220,97 @@ decoder::operator()(decoder_repair&& incoming_r)
   // Check if we can rebuild a missing source directly with this repair.
   if (r.source_ids().size() == 1)
   {
-    // Create missing source.
-    auto src = create_source_from_repair(r);
+    // This newly decoded source might trigger the decoding of several other sources.
+    m_degree_one.push_back(r_id);
+    peel();
+    return;
+  }
 
-    // Source is no longer missing.
-    m_missing_sources.erase(src.id());
+  attempt_full_decoding();
+}
 
-    // This repair is no longer needed.
-    m_repairs.erase(r_cit);
+/*------------------------------------------------------------------------------------------------*/
 
-    // This newly decode source might trigger the decoding of several other sources.
-    add_source_recursive(std::move(src));
+bool
+decoder::drop_repair(std::uint32_t id, const std::vector<source_id_range>& ranges)
+{
+  if (ranges.empty())
+  {
+    // A repair which encodes no source is useless.
+    return true;
+  }
 
-    return;
+  if (m_last_id and ranges.back().last - 1 < *m_last_id)
+  {
+    // It's a repair that provide outdated informations, drop it.
+    return true;
   }
 
-  attempt_full_decoding();
+  if (m_repairs.count(id))
+  {
+    // A duplicate repair. Drop it.
+    return true;
+  }
+
+  // Look for each range of sources in the bitmap of known sources, rather than for each source.
+  const auto useless = std::all_of( begin(ranges), end(ranges)
+                                  , [this](const source_id_range& r)
+                                    {
+                                      return m_sources.contains(r.first, r.last);
+                                    });
+  if (not useless)
+  {
+    return false;
+  }
+
+  // Like operator(), drop sources and repairs which are outdated by this repair.
+  drop_outdated(ranges.front().first);
+  ++m_nb_useless_repairs;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::close_block(std::uint32_t end)
+{
+  if (not m_block_end or *m_block_end < end)
+  {
+    m_block_end = end;
+  }
+  release_block();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::skip_to(std::uint32_t id)
+{
+  m_skipped = std::max(m_skipped, id);
+  if (not m_last_id or *m_last_id < id)
+  {
+    drop_outdated(id);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::set_max_span(std::uint32_t span)
+noexcept
+{
+  m_sources.set_max_span(span);
+  m_missing_sources.set_max_span(span);
+  m_repairs.set_max_span(span);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint32_t
+decoder::max_span()
+const noexcept
+{
+  return m_sources.max_span();
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -161,13 +323,13 @@ noexcept
   const auto src_id = *r.source_ids().begin();
 
   // The inverse of the coefficient which was used to encode the missing source.
-  const auto inv = m_gf.invert(m_gf.coefficient(r.id(), src_id));
+  const auto inv = m_gf.invert(m_gf.coefficient(r.coefficient_id(), src_id));
 
   // Reconstruct size.
   const auto src_sz = m_gf.multiply_size(r.encoded_size(), inv);
 
   // The source that will be reconstructed.
-  auto src = decoder_source{src_id, packet(src_sz + packet::alignment), src_sz};
+  auto src = decoder_source{src_id, packet(m_packet_pool, src_sz + packet::alignment), src_sz};
 
   // Reconstruct missing source.
   m_gf.multiply(r.symbol(), src.symbol(), src_sz, inv);
@@ -192,6 +354,82 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+void
+decoder::set_engine(decoding_engine engine)
+noexcept
+{
+  if (engine != m_engine)
+  {
+    m_engine = engine;
+    m_repairs.clear();
+    m_missing_sources.clear();
+    m_echelon.clear();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+decoding_engine
+decoder::engine()
+const noexcept
+{
+  return m_engine;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::set_nb_threads(std::size_t nb)
+{
+  assert(nb > 0);
+  m_pool_gfs.clear();
+  m_pool.reset();
+  if (nb > 1)
+  {
+    m_pool.reset(new thread_pool{nb});
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      m_pool_gfs.emplace_back(new galois_field{static_cast<std::uint8_t>(m_gf.size())});
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+decoder::nb_threads()
+const noexcept
+{
+  return m_pool ? m_pool->size() : 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::set_gap_callback(std::function<void(std::uint32_t, std::uint32_t)> h)
+{
+  m_gap_callback = std::move(h);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::set_hold_callback(std::function<void(std::uint32_t)> h)
+{
+  m_hold_callback = std::move(h);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+packet_pool&
+decoder::pool()
+noexcept
+{
+  return m_packet_pool;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 const decoder::repairs_set_type&
 decoder::repairs()
 const noexcept
@@ -219,6 +457,44 @@ const noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+std::size_t
+decoder::nb_missing_sources()
+const noexcept
+{
+  return m_engine == decoding_engine::progressive
+       ? m_echelon.nb_missing_sources()
+       : m_missing_sources.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint32_t
+decoder::first_missing_source()
+const noexcept
+{
+  return m_first_missing_source;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::vector<source_id_range>&
+decoder::held_sources()
+const noexcept
+{
+  return m_held_sources;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::clear_held_sources()
+noexcept
+{
+  m_held_sources.clear();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 std::size_t
 decoder::nb_useless_repairs()
 const noexcept
@@ -246,94 +522,319 @@ const noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+std::size_t
+decoder::nb_skipped()
+const noexcept
+{
+  return m_nb_skipped;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
-decoder::add_source_recursive(decoder_source&& src)
+decoder::add_source_and_peel(decoder_source&& src)
 {
-  if (not m_in_order)
+  remove_source_from_repairs(src);
+  insert_source(std::move(src));
+  peel();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::remove_source_from_repairs(const decoder_source& src)
+{
+  const auto search = m_missing_sources.find(src.id());
+  if (not search)
   {
-    m_callback(src);
+    return;
   }
-  else if (src.id() == m_first_missing_source_in_order)
+
+  for (const auto r_id : *search)
   {
-    m_callback(src);
-    m_first_missing_source_in_order += 1;
-    // Send all sources that could not be previously sent because their ids were greater than
-    // m_first_missing_source_in_order.
-    flush_ordered_sources();
+    const auto r = m_repairs.find(r_id);
+    if (not r)
+    {
+      // The repair which rebuilt this source.
+      continue;
+    }
+
+    if (r->source_ids().size() == 1)
+    {
+      // This repair encodes only this source, it no longer brings anything.
+      m_repairs.erase(r_id);
+    }
+    else
+    {
+      remove_source_from_repair(src, *r);
+      if (r->source_ids().size() == 1)
+      {
+        // The remaining missing source can now be rebuilt from this repair.
+        m_degree_one.push_back(r_id);
+      }
+    }
   }
 
-  // First, remove this source from all repairs that encode it.
-  const auto search = m_missing_sources.find(src.id());
-  if (search != m_missing_sources.end())
+  // It's no longer a missing source.
+  m_missing_sources.erase(src.id());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::peel()
+{
+  // Each decoded source is removed only from the repairs that encode it, which might in turn give
+  // repairs that encode only one source. Thus, the cost is proportional to the number of links
+  // between missing sources and repairs that are actually removed.
+  while (not m_degree_one.empty())
   {
-    for (auto r_cit : search->second)
+    const auto r_id = m_degree_one.back();
+    m_degree_one.pop_back();
+
+    const auto r = m_repairs.find(r_id);
+    if (not r or r->source_ids().size() != 1)
     {
-      auto& r = r_cit->second;
-      remove_source_from_repair(src, r);
+      // The source of this repair was rebuilt by another repair in the meantime.
+      continue;
     }
 
-    // It's no longer a missing source.
-    m_missing_sources.erase(search);
+    // Check that this source doesn't belong to the set of current sources.
+    assert(not m_sources.count(*r->source_ids().begin()));
+
+    auto decoded_src = create_source_from_repair(*r);
+
+    // We can erase this repair.
+    m_repairs.erase(r_id);
+
+    remove_source_from_repairs(decoded_src);
+    insert_source(std::move(decoded_src));
   }
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-  // Now, look for repairs that encodes only 1 source. When one is found, the corresponding
-  // encoded source is decoded and the repair is erased.
-  for ( auto miss_cit = m_missing_sources.begin(), miss_end = m_missing_sources.end()
-      ; miss_cit != miss_end;)
+void
+decoder::add_repair_progressive(decoder_repair&& r)
+{
+  // Remove from incoming repair all existing sources.
+  // Reverse loop as flat_set::erase() invalidates iterators behind the one being erased.
+  for ( auto id_rcit = r.source_ids().rbegin(), end = r.source_ids().rend(); id_rcit != end
+      ; ++id_rcit)
   {
-    const auto& repairs_cits = miss_cit->second;
-    // Does this missing source is referenced by only one repair?
-    if (repairs_cits.size() == 1)
+    const auto search = m_sources.find(*id_rcit);
+    if (search)
     {
-      // Some shortcuts.
-      const auto r_cit = *repairs_cits.begin();
-      const auto& r = r_cit->second;
+      remove_source_data_from_repair(*search /* source */, r);
+      r.source_ids().erase(std::next(id_rcit).base());
+    }
+  }
+  assert(not r.source_ids().empty());
 
-      // Does this repair encode only 1 source?
-      if (r.source_ids().size() == 1)
-      {
-        // Check that this source wasn't decoded in the past.
-        assert(m_last_id ? *r.source_ids().begin() >= *m_last_id : true);
-        // Check that this source doesn't belong to the set of current sources.
-        assert(not m_sources.count(*r.source_ids().begin()));
+  if (not m_echelon.add(r))
+  {
+    // This repair doesn't bring any new information.
+    ++m_nb_useless_repairs;
+    return;
+  }
+
+  while (m_echelon.has_decoded())
+  {
+    m_nb_decoded += 1;
+    insert_source(m_echelon.pop_decoded());
+  }
+}
 
-        // This missing source is referenced by only 1 repair and this repair references only 1
-        // missing source. Thus, we can reconstruct the missing source.
-        auto decoded_src = create_source_from_repair(r);
+/*------------------------------------------------------------------------------------------------*/
 
-        // We can erase this repair.
-        m_repairs.erase(r_cit);
+void
+decoder::add_source_progressive(decoder_source&& src)
+{
+  m_echelon.remove(src);
+  insert_source(std::move(src));
 
-        // It's no longer a missing source.
-        miss_cit = m_missing_sources.erase(miss_cit);
+  // Other rows already have a zero coefficient for the pivot of a decoded source, there's no need
+  // to remove it from them.
+  while (m_echelon.has_decoded())
+  {
+    m_nb_decoded += 1;
+    insert_source(m_echelon.pop_decoded());
+  }
+}
 
-        // This newly decoded source might trigger the decoding of other sources.
-        add_source_recursive(std::move(decoded_src));
-      }
-      else
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::insert_source(decoder_source&& src)
+{
+  const auto src_id = src.id(); // to force evaluation order in the following call.
+  const auto& inserted_src = m_sources.emplace(src_id, std::move(src));
+  // Sources which were given up on are never delivered late.
+  if (not m_in_order and src_id >= m_skipped)
+  {
+    m_callback(inserted_src);
+  }
+  if (src_id == m_first_missing_source)
+  {
+    if (m_in_order)
+    {
+      m_callback(inserted_src);
+    }
+    m_first_missing_source += 1;
+    // Send all sources that could not be previously sent because their ids were greater than
+    // m_first_missing_source.
+    flush_ordered_sources();
+  }
+  else
+  {
+    // With in-order delivery, we can't send the current source as there are some older sources
+    // which have not been sent.
+    hold_source(src_id);
+    if (m_hold_callback and src_id > m_first_missing_source)
+    {
+      m_hold_callback(src_id);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::hold_source(std::uint32_t id)
+{
+  if (not m_held_sources.empty() and m_held_sources.back().last == id)
+  {
+    // The common case: sources come in order after a loss.
+    m_held_sources.back().last += 1;
+    return;
+  }
+
+  // Find the first range which starts after id.
+  auto it = std::upper_bound( m_held_sources.begin(), m_held_sources.end(), id
+                            , [](std::uint32_t lhs, const source_id_range& rhs)
+                              {
+                                return lhs < rhs.first;
+                              });
+  if (it != m_held_sources.begin() and std::prev(it)->last >= id)
+  {
+    // A decoded source fills a hole at the end of the previous range.
+    auto prev = std::prev(it);
+    if (prev->last == id)
+    {
+      prev->last += 1;
+      if (it != m_held_sources.end() and it->first == prev->last)
       {
-        // This repair encodes too much sources, other sources are needed to reconstruct *miss_cit.
-        // Try next missing source.
-        ++miss_cit;
+        prev->last = it->last;
+        m_held_sources.erase(it);
       }
     }
-    else
+    return;
+  }
+  if (it != m_held_sources.end() and it->first == id + 1)
+  {
+    it->first = id;
+    return;
+  }
+  if (m_held_sources.size() == max_held_ranges)
+  {
+    if (it == m_held_sources.begin())
     {
-      // This missing source is referenced by multiple repairs. Try next missing source.
-      ++miss_cit;
+      // Older than all remembered ranges.
+      return;
     }
+    // Forget the oldest range.
+    m_held_sources.erase(m_held_sources.begin());
+    --it;
   }
+  m_held_sources.insert(it, source_id_range{id, id + 1});
+}
 
-  // Insert-move this new source in the set of known sources.
-  const auto src_id = src.id(); // to force evaluation order in the following call.
-  const auto insertion = m_sources.emplace(src_id, std::move(src));
-  assert(insertion.second && "source already added");
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+decoder::admit_sources(std::uint32_t first, std::uint32_t last)
+{
+  if (  last - first >= m_sources.max_span()
+     or last == std::numeric_limits<std::uint32_t>::max())
+  {
+    // Too many sources, or the greatest identifier which can't be represented.
+    return false;
+  }
+  if (too_old(m_sources, first) or too_old(m_missing_sources, first))
+  {
+    return false;
+  }
+  if (m_sources.fits(last) and m_missing_sources.fits(last))
+  {
+    // Don't let a stale far ahead identifier corroborate a much later one.
+    m_far_source = boost::none;
+  }
+  else
+  {
+    if ( beyond(m_sources, last) and beyond(m_missing_sources, last)
+        and not corroborated(m_far_source, last, m_sources.max_span()))
+    {
+      return false;
+    }
+    // Give up on the oldest sources rather than growing the windows.
+    const auto oldest = last + 1 - m_sources.max_span();
+    skip_to(oldest);
+    // Repairs which encode given up sources still reference them as missing.
+    for (auto cit = m_repairs.begin(); cit != m_repairs.end(); ++cit)
+    {
+      if (*cit->source_ids().begin() < oldest)
+      {
+        forget_repair(cit.id());
+      }
+    }
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+decoder::admit_repair(std::uint32_t id)
+noexcept
+{
+  if (m_repairs.fits(id))
+  {
+    m_far_repair = boost::none;
+    return true;
+  }
+  if (too_old(m_repairs, id) or id == std::numeric_limits<std::uint32_t>::max())
+  {
+    return false;
+  }
+  if (beyond(m_repairs, id) and not corroborated(m_far_repair, id, m_repairs.max_span()))
+  {
+    return false;
+  }
+  // Drop the oldest repairs rather than growing the window.
+  const auto oldest = id + 1 - m_repairs.max_span();
+  for (auto cit = m_repairs.begin(); cit != m_repairs.end() and cit.id() < oldest; ++cit)
+  {
+    forget_repair(cit.id());
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-  if (m_in_order and insertion.first->second.id() > m_first_missing_source_in_order)
+void
+decoder::forget_repair(std::uint32_t id)
+noexcept
+{
+  for (const auto src_id : m_repairs.find(id)->source_ids())
   {
-    // We can't send the current source as there are some older sources which have not been sent.
-    m_ordered_sources.emplace(insertion.first->second.id(), &insertion.first->second);
+    const auto repairs_ids = m_missing_sources.find(src_id);
+    repairs_ids->erase(id);
+    if (repairs_ids->empty())
+    {
+      m_missing_sources.erase(src_id);
+    }
   }
+  m_repairs.erase(id);
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -345,47 +846,80 @@ noexcept
   // All sources with an identifier strictly less than last_id_ are now considered outdated.
   m_last_id = id;
 
-  // Remove repairs which references this id.
-  for (auto cit = m_repairs.begin(), end = m_repairs.end(); cit != end;)
+  // Remove repairs which only reference outdated sources.
+  for (auto cit = m_repairs.begin(); cit != m_repairs.end(); ++cit)
   {
-    const auto& r = cit->second;
+    const auto& r = *cit;
     assert(not r.source_ids().empty());
 
-    // Does this repair encodes sources with identifiers strictly less than id? If so, it's no
-    // longer useful.
-    if (id > *r.source_ids().begin())
+    // Does this repair encodes only sources with identifiers strictly less than id? If so, no
+    // incoming repair will ever be combined with it. Otherwise, it can still rebuild its outdated
+    // sources with the help of newer repairs, like the overlapping bands of a banded code.
+    if (id > *r.source_ids().rbegin())
     {
-      for (const auto src_id : r.source_ids())
-      {
-        m_missing_sources.find(src_id)->second.erase(cit);
-      }
-      cit = m_repairs.erase(cit);
-    }
-    else
-    {
-       ++cit;
+      forget_repair(cit.id());
     }
   }
+  m_echelon.drop_outdated(id);
 
   if (m_in_order)
   {
     // flush_ordered_sources() won't give to user sources with identifier smaller than id, thus we
-    // take care of it now.
-    for (auto cit = m_ordered_sources.begin(), end = m_ordered_sources.lower_bound(id); cit != end;)
+    // take care of it now, skipping the missing ones.
+    auto next = m_first_missing_source;
+    for (auto cit = m_sources.begin(); cit != m_sources.end() and cit.id() < id; ++cit)
     {
-      m_callback(*cit->second);
-      cit = m_ordered_sources.erase(cit);
+      if (cit.id() >= next)
+      {
+        skip(next, cit.id());
+        m_callback(*cit);
+        next = cit.id() + 1;
+      }
     }
-    if (m_first_missing_source_in_order < id)
+    skip(next, id);
+  }
+  if (m_first_missing_source < id)
+  {
+    m_first_missing_source = id;
+  }
+  flush_ordered_sources();
+
+  // Erase all sources with an identifer smaller (strict) than id. Missing sources were erased
+  // with the last repair referencing them.
+  m_sources.erase_before(id);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::skip(std::uint32_t first, std::uint32_t last)
+noexcept
+{
+  if (first < last)
+  {
+    m_nb_skipped += last - first;
+    if (m_gap_callback)
     {
-      m_first_missing_source_in_order = id;
+      m_gap_callback(first, last);
     }
-    flush_ordered_sources();
   }
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-  // Erase all sources and missing sources with an identifer smaller (strict) than id.
-  m_sources.erase(m_sources.begin(), m_sources.lower_bound(id));
-  m_missing_sources.erase(m_missing_sources.begin(), m_missing_sources.lower_bound(id));
+void
+decoder::release_block()
+noexcept
+{
+  if (m_block_end and m_first_missing_source >= *m_block_end)
+  {
+    if (not m_last_id or *m_last_id < *m_block_end)
+    {
+      // All sources of the block were received or decoded, its repairs are useless.
+      drop_outdated(*m_block_end);
+    }
+    m_block_end = boost::none;
+  }
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -397,7 +931,7 @@ noexcept
   assert(r.source_ids().size() > 1 && "Repair encodes only one source");
   assert(src.symbol_size() <= r.symbol_size());
 
-  const auto coeff = m_gf.coefficient(r.id(), src.id());
+  const auto coeff = m_gf.coefficient(r.coefficient_id(), src.id());
 
   // Remove source size.
   r.encoded_size()
@@ -412,34 +946,77 @@ noexcept
 void
 decoder::attempt_full_decoding()
 {
-  if (m_repairs.empty() or m_missing_sources.empty())
+  while (not m_repairs.empty() and not m_missing_sources.empty() and decode_prefix())
+  {}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+decoder::decode_prefix()
+{
+  // Repairs only encode missing sources. A repair belongs to the system of the k oldest missing
+  // sources when its newest missing source is one of them. With a dense code, all repairs
+  // usually encode the newest missing source and the system is the whole set of missing sources.
+  // With a banded code, old sources can be decoded while newer ones are still missing.
+  m_last_ids.clear();
+  for (auto r_cit = m_repairs.begin(); r_cit != m_repairs.end(); ++r_cit)
   {
-    return;
+    m_last_ids.emplace_back(*r_cit->source_ids().rbegin(), r_cit.id());
+  }
+  std::sort(m_last_ids.begin(), m_last_ids.end());
+
+  // Look for the smallest prefix of missing sources encoded by as many repairs.
+  m_prefix.clear();
+  auto nb_repairs = 0ul;
+  for (auto miss_cit = m_missing_sources.begin(); miss_cit != m_missing_sources.end(); ++miss_cit)
+  {
+    m_prefix.push_back(miss_cit.id());
+    while (nb_repairs < m_last_ids.size() and m_last_ids[nb_repairs].first <= miss_cit.id())
+    {
+      ++nb_repairs;
+    }
+    if (nb_repairs >= m_prefix.size())
+    {
+      break;
+    }
   }
 
   // Do we have enough repairs to try to decode missing sources?
-  if (m_missing_sources.size() > m_repairs.size())
+  if (nb_repairs < m_prefix.size())
   {
-    return;
+    return false;
   }
 
-  assert(m_missing_sources.size() == m_repairs.size() && "More repairs than missing sources");
-  assert(m_missing_sources.size() > 1 && "Trying to create a matrix for only one missing source.");
+  const auto dimension = m_prefix.size();
+  assert(dimension > 1 && "Trying to create a matrix for only one missing source.");
+
+  // Build an index for fast retrieving of repairs from the inverted matrix.
+  m_index.clear();
+  for (auto i = 0ul; i < dimension; ++i)
+  {
+    m_index.emplace_back(m_repairs.find(m_last_ids[i].second));
+  }
 
   // Build coefficient matrix.
-  m_coefficients.resize(m_repairs.size());
-  auto col = 0ul;
-  for (const auto& r : m_repairs)
+  m_coefficients.resize(dimension);
+  for (auto col = 0ul; col < dimension; ++col)
   {
-    auto row = 0ul;
-    for (const auto& missing : m_missing_sources)
+    // Both the missing sources and the sources of the repair are sorted, thus they are walked
+    // together rather than searched.
+    const auto& r = *m_index[col];
+    auto id_cit = r.source_ids().begin();
+    const auto id_end = r.source_ids().end();
+    for (auto row = 0ul; row < dimension; ++row)
     {
-      m_coefficients(row, col) = r.second.source_ids().count(missing.first)
-                               ? m_gf.coefficient(r.first, missing.first)
+      while (id_cit != id_end and *id_cit < m_prefix[row])
+      {
+        ++id_cit;
+      }
+      m_coefficients(row, col) = (id_cit != id_end and *id_cit == m_prefix[row])
+                               ? m_gf.coefficient(r.coefficient_id(), m_prefix[row])
                                : 0u; // repair doesn't encode the missing source.
-      ++row;
     }
-    ++col;
   }
 
   // Invert it.
@@ -449,36 +1026,33 @@ decoder::attempt_full_decoding()
   {
     // Inversion failed, remove the faulty repair.
     m_nb_failed_full_decodings += 1;
-
-    // Find the repair corresponding to r_col.
-    auto r_cit = m_repairs.begin();
-    // To avoid a conversion warning with clang's -Wconversion.
-    using difference_type = std::iterator_traits<decltype(r_cit)>::difference_type;
-    std::advance(r_cit, static_cast<difference_type>(*r_col));
+    const auto r_id = m_last_ids[*r_col].second;
 
     // Remove repair from missing sources that reference it.
-    for (const auto src : r_cit->second.source_ids())
+    for (const auto src : m_index[*r_col]->source_ids())
     {
-      m_missing_sources[src].erase(r_cit);
+      const auto repairs_ids = m_missing_sources.find(src);
+      repairs_ids->erase(r_id);
+      if (repairs_ids->empty())
+      {
+        m_missing_sources.erase(src);
+      }
     }
 
     // We can now effectively remove the repair.
-    m_repairs.erase(r_cit);
-    return;
+    m_repairs.erase(r_id);
+    return true;
   }
 
   // Matrix successfully inverted, we can now decode missing sources. Phew!
-
-  // Build an index for fast retrieving of repairs from the inverted matrix.
-  m_index.clear();
-  m_index.reserve(m_repairs.size());
-  for (auto& rid_repair : m_repairs)
-  {
-    m_index.emplace_back(&rid_repair.second);
-  }
-
-  auto src_col = 0u;
-  for (const auto& miss : m_missing_sources)
+  // First, gather which repairs are combined to rebuild each source.
+  m_decoded_sources.clear();
+  m_symbols.clear();
+  m_sizes.clear();
+  m_dot_coefficients.clear();
+  m_offsets.clear();
+  auto nb_bytes = 0ul;
+  for (auto src_col = 0ul; src_col < dimension; ++src_col)
   {
     // First, decode the size of the source.
     const auto src_sz = [&,this]
@@ -496,73 +1070,80 @@ decoder::attempt_full_decoding()
       return res;
     }();
 
-    // Now, decode symbol.
     // When sources are directly received from the network, they are constructed in a such way that
     // there is a padding before the symbol and the headers (to avoid copy). Here, we have to
     // construct the source in the same way.
-    auto src = decoder_source{ miss.first, packet( src_sz + packet::alignment
-                                                 , 0 /* zero out the buffer */)
-                             , src_sz};
-    auto repair_row = 0ul;
-    auto coeff = 0u;
-
-    // Find first non-zero coefficient.
-    for (; repair_row < repairs().size(); ++repair_row)
-    {
-      coeff = m_inv(repair_row, src_col);
-      if (coeff != 0)
-      {
-        break;
-      }
-    }
-    assert(repair_row != m_repairs.size() && "No coefficients for missing source");
+    m_decoded_sources.emplace_back( m_prefix[src_col]
+                                  , packet( m_packet_pool, src_sz + packet::alignment
+                                          , 0 /* zero out the buffer */)
+                                  , src_sz);
 
     // Repair's buffer might be smaller than the size of the source to decode, or it could be
     // the opposite situation. Thus, we need to make sure that we only read the right number of
     // bytes.
-    auto sz = std::min(src_sz, static_cast<std::uint16_t>(m_index[repair_row]->symbol_size()));
-    m_gf.multiply(m_index[repair_row]->symbol(), src.symbol(), sz, coeff);
-
-    for (++repair_row; repair_row < m_inv.dimension(); ++repair_row)
+    m_offsets.push_back(m_symbols.size());
+    for (auto repair_row = 0ul; repair_row < m_inv.dimension(); ++repair_row)
     {
-      coeff = m_inv(repair_row, src_col);
+      const auto coeff = m_inv(repair_row, src_col);
       if (coeff != 0)
       {
-        sz = std::min(src_sz, static_cast<std::uint16_t>(m_index[repair_row]->symbol_size()));
-        m_gf.multiply_add(m_index[repair_row]->symbol(), src.symbol(), sz, coeff);
+        m_symbols.push_back(m_index[repair_row]->symbol());
+        m_sizes.push_back(std::min( static_cast<std::size_t>(src_sz)
+                                  , static_cast<std::size_t>(m_index[repair_row]->symbol_size())));
+        m_dot_coefficients.push_back(coeff);
+        nb_bytes += m_sizes.back();
       }
     }
-    ++src_col;
-
-    // Source decoded, add it to the set of known sources.
-    const auto insertion = m_sources.emplace(miss.first, std::move(src));
-    assert(insertion.second && "source already added");
+    assert(m_symbols.size() != m_offsets.back() && "No coefficients for missing source");
+  }
+  m_offsets.push_back(m_symbols.size());
 
-    const auto& inserted_src = insertion.first->second;
-    if (not m_in_order)
-    {
-      m_callback(inserted_src);
-    }
-    else if (inserted_src.id() == m_first_missing_source_in_order)
-    {
-      m_callback(inserted_src);
-      m_first_missing_source_in_order += 1;
-      // Send all sources that could not be previously sent because their ids were greater than
-      // first_missing_source_.
-      flush_ordered_sources();
-    }
-    else
+  // Now, decode symbols. Multiply all repairs with their coefficient and add them in a single pass
+  // on the source. Each source is rebuilt independently of the others.
+  const auto rebuild = [this](std::size_t src_col, galois_field& gf)
+  {
+    auto& src = m_decoded_sources[src_col];
+    const auto first = m_offsets[src_col];
+    gf.dot_product( m_symbols.data() + first, m_sizes.data() + first
+                  , m_dot_coefficients.data() + first, m_offsets[src_col + 1] - first
+                  , src.symbol(), src.symbol_size());
+  };
+
+  // Waking up the threads of the pool is only worth it for large enough systems.
+  static constexpr auto parallel_threshold = 1ul << 16;
+  if (m_pool and nb_bytes >= parallel_threshold)
+  {
+    m_pool->run( dimension
+               , [&,this](std::size_t src_col, std::size_t slot)
+                 {
+                   rebuild(src_col, *m_pool_gfs[slot]);
+                 });
+  }
+  else
+  {
+    for (auto src_col = 0ul; src_col < dimension; ++src_col)
     {
-      // We can't send the current source as there are some older sources which have not been sent.
-      m_ordered_sources.emplace(inserted_src.id(), &inserted_src);
+      rebuild(src_col, m_gf);
     }
   }
+  m_nb_decoded += dimension;
 
-  m_nb_decoded += m_missing_sources.size();
+  // Cleanup. Other repairs of the prefix only encode decoded sources, they will be dropped when
+  // these sources are removed from them.
+  for (auto i = 0ul; i < dimension; ++i)
+  {
+    m_repairs.erase(m_last_ids[i].second);
+  }
 
-  // Cleanup.
-  m_repairs.clear();
-  m_missing_sources.clear();
+  // Decoded sources are removed from newer repairs, which might permit to decode other sources.
+  for (auto& src : m_decoded_sources)
+  {
+    remove_source_from_repairs(src);
+    insert_source(std::move(src));
+  }
+  m_decoded_sources.clear();
+  peel();
+  return true;
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -572,21 +1153,14 @@ decoder::flush_ordered_sources()
 {
   // If we find the first missing source, we can give to user all sources with a identifier
   // that follow m_first_missing_source in sequence.
-  auto cit = m_ordered_sources.find(m_first_missing_source_in_order);
-  if (cit != m_ordered_sources.end())
+  for ( auto src = m_sources.find(m_first_missing_source); src
+      ; src = m_sources.find(m_first_missing_source))
   {
-    while (true)
+    if (m_in_order)
     {
-      assert(cit->first == m_first_missing_source_in_order);
-      m_callback(*cit->second);
-      cit = m_ordered_sources.erase(cit);
-      m_first_missing_source_in_order += 1;
-
-      if (cit == m_ordered_sources.end() or cit->first > m_first_missing_source_in_order)
-      {
-        break;
-      }
+      m_callback(*src);
     }
+    m_first_missing_source += 1;
   }
 }
 
@@ -1,16 +1,22 @@
 #pragma once
 
+#include <memory> // unique_ptr
 #include <vector>
 
 #include <boost/container/flat_set.hpp>
-#include <boost/container/map.hpp>
 #include <boost/optional.hpp>
 
+#include "netcode/detail/echelon_form.hh"
 #include "netcode/detail/galois_field.hh"
+#include "netcode/detail/id_window.hh"
 #include "netcode/detail/repair.hh"
 #include "netcode/detail/source.hh"
+#include "netcode/detail/source_id_list.hh"
 #include "netcode/detail/square_matrix.hh"
+#include "netcode/detail/thread_pool.hh"
+#include "netcode/decoding_engine.hh"
 #include "netcode/in_order.hh"
+#include "netcode/packet_pool.hh"
 
 namespace ntc { namespace detail {
 
@@ -22,35 +28,18 @@ class decoder final
 {
 public:
 
-  /// @brief Type of an ordered container of repairs.
-  using repairs_set_type = boost::container::map<std::uint32_t, decoder_repair>;
+  /// @brief Type of a container of repairs, indexed by identifier.
+  using repairs_set_type = id_window<decoder_repair>;
 
-  /// @brief Type of an ordered container of sources.
-  using sources_set_type = boost::container::map<std::uint32_t, decoder_source>;
+  /// @brief Type of a container of sources, indexed by identifier.
+  using sources_set_type = id_window<decoder_source>;
 
-private:
+  /// @brief Type of a sorted container of repair identifiers.
+  using repair_ids_type = boost::container::flat_set<std::uint32_t>;
 
-  /// @brief We need a total order on repairs_set_type::iterator.
-  struct cmp_repairs_iterator
-  {
-    bool
-    operator()(const repairs_set_type::iterator& lhs, const repairs_set_type::iterator& rhs)
-    const noexcept
-    {
-      // Use identifiers to sort.
-      return lhs->first < rhs->first;
-    }
-  };
-
-public:
-
-  /// @brief Type of a sorted container of repair iterators.
-  using repairs_iterators_type = boost::container::flat_set< repairs_set_type::iterator
-                                                           , cmp_repairs_iterator>;
-
-  /// @brief Type of an ordered container that associate missing sources to the repairs that
-  /// contain them.
-  using missing_sources_type = boost::container::map<std::uint32_t, repairs_iterators_type>;
+  /// @brief Type of a container that associates missing sources to the identifiers of the repairs
+  /// that contain them.
+  using missing_sources_type = id_window<repair_ids_type>;
 
 public:
 
@@ -66,6 +55,42 @@ public:
   void
   operator()(decoder_repair&& incoming_r);
 
+  /// @brief Drop a received repair before the list of its sources is built, if it's outdated,
+  /// duplicated or useless.
+  /// @param id The repair's identifier.
+  /// @param ranges The sorted ranges of sources the repair encodes.
+  /// @return true if the repair was dropped, false if it shall be given to operator().
+  bool
+  drop_repair(std::uint32_t id, const std::vector<source_id_range>& ranges);
+
+  /// @brief Tell that no repair will encode sources with an identifier smaller than @p end.
+  ///
+  /// Once all these sources are known, they are released with the repairs which encode them,
+  /// without waiting for a repair of the next block.
+  void
+  close_block(std::uint32_t end);
+
+  /// @brief Give up on all sources with an identifier smaller than @p id.
+  ///
+  /// Known sources before @p id are given to the callback if they were waiting for a missing
+  /// source, missing ones will never be. Does nothing if these sources were already dropped.
+  void
+  skip_to(std::uint32_t id);
+
+  /// @brief Set how many identifiers of sources and of repairs are kept track of.
+  ///
+  /// When a packet is too far ahead, the oldest sources or repairs are given up on. A packet so
+  /// far ahead that all of them would be is ignored, unless it's corroborated by another one.
+  /// @note The default is 2^16.
+  void
+  set_max_span(std::uint32_t span)
+  noexcept;
+
+  /// @brief Get how many identifiers of sources and of repairs are kept track of.
+  std::uint32_t
+  max_span()
+  const noexcept;
+
   /// @brief Decode a source contained in a repair.
   /// @attention @p r shall encode exactly one source.
   decoder_source
@@ -78,7 +103,55 @@ public:
   remove_source_from_repair(const decoder_source& src, decoder_repair& r)
   noexcept;
 
+  /// @brief Change the way missing sources are rebuilt.
+  /// @note Pending repairs are dropped when the engine changes.
+  void
+  set_engine(decoding_engine engine)
+  noexcept;
+
+  /// @brief Get the way missing sources are rebuilt.
+  decoding_engine
+  engine()
+  const noexcept;
+
+  /// @brief Set the number of threads which rebuild missing sources with the full engine.
+  ///
+  /// Once the matrix is inverted, each missing source is rebuilt independently of the others. With
+  /// more than one thread, they are rebuilt in parallel by a pool of threads, including the
+  /// caller's one. Sources are still given to the callback by the caller's thread.
+  /// @note The default is 1, that is sources are rebuilt by the caller's thread only.
+  void
+  set_nb_threads(std::size_t nb);
+
+  /// @brief Get the number of threads which rebuild missing sources.
+  std::size_t
+  nb_threads()
+  const noexcept;
+
+  /// @brief Set the callback to call when in-order delivery skips missing sources.
+  ///
+  /// It's given the range [first, last) of identifiers of the skipped sources, before the sources
+  /// which follow them are given to the source callback.
+  void
+  set_gap_callback(std::function<void(std::uint32_t, std::uint32_t)> h);
+
+  /// @brief Set the callback to call when a received or decoded source is held.
+  ///
+  /// It's given the identifier of a source which can't be delivered in order, as older sources are
+  /// missing.
+  void
+  set_hold_callback(std::function<void(std::uint32_t)> h);
+
+  /// @brief Get the pool of buffers of sources and repairs.
+  ///
+  /// Decoded sources are allocated in this pool. Packets received from the network can also be
+  /// constructed with it, so that their buffers are reused once the decoder drops them.
+  packet_pool&
+  pool()
+  noexcept;
+
   /// @brief Get the current set of repairs, indexed by identifier.
+  /// @note Always empty with the progressive engine, which keeps its own rows.
   const repairs_set_type&
   repairs()
   const noexcept;
@@ -89,10 +162,36 @@ public:
   const noexcept;
 
   /// @brief Get the current set of missing sources.
+  /// @note Always empty with the progressive engine, use nb_missing_sources() instead.
   const missing_sources_type&
   missing_sources()
   const noexcept;
 
+  /// @brief Get the number of missing sources referenced by pending repairs.
+  std::size_t
+  nb_missing_sources()
+  const noexcept;
+
+  /// @brief Get the identifier of the first missing source.
+  ///
+  /// All sources with a smaller identifier were received, decoded, or are outdated.
+  std::uint32_t
+  first_missing_source()
+  const noexcept;
+
+  /// @brief Get the sorted ranges of sources received or decoded after the first missing one,
+  /// since the last call to clear_held_sources().
+  /// @note Some ranges may have been overtaken by the first missing source since. When there are
+  /// too many of them, the oldest ones are forgotten.
+  const std::vector<source_id_range>&
+  held_sources()
+  const noexcept;
+
+  /// @brief Forget the ranges of held sources.
+  void
+  clear_held_sources()
+  noexcept;
+
   /// @brief Get the number of repairs that were dropped because they were useless.
   std::size_t
   nb_useless_repairs()
@@ -108,11 +207,68 @@ public:
   nb_decoded()
   const noexcept;
 
+  /// @brief Get the number of missing sources skipped by in-order delivery.
+  std::size_t
+  nb_skipped()
+  const noexcept;
+
 private:
 
-  /// @brief Recursively decode any repair that encodes only one source.
+  /// @brief Add a received source, then decode all sources it permits to rebuild.
+  void
+  add_source_and_peel(decoder_source&& src);
+
+  /// @brief Remove a newly known source from the repairs that encode it.
+  ///
+  /// Repairs left with only one missing source are queued in m_degree_one.
   void
-  add_source_recursive(decoder_source&& src);
+  remove_source_from_repairs(const decoder_source& src);
+
+  /// @brief Decode the sources of the queued repairs which encode only one missing source, until
+  /// there is none left.
+  void
+  peel();
+
+  /// @brief Eliminate a repair against the rows of the progressive engine.
+  void
+  add_repair_progressive(decoder_repair&& r);
+
+  /// @brief Remove a source from the rows of the progressive engine and deliver all sources it
+  /// permits to decode.
+  void
+  add_source_progressive(decoder_source&& src);
+
+  /// @brief Add a received or decoded source to the set of known sources and give it to callback,
+  /// when possible.
+  void
+  insert_source(decoder_source&& src);
+
+  /// @brief Remember that a source after the first missing one is known.
+  void
+  hold_source(std::uint32_t id);
+
+  /// @brief Make room for sources [first, last] in the windows of sources and missing sources.
+  ///
+  /// When @p last is too far ahead, the oldest sources are given up on, as with skip_to(). If all
+  /// known sources would be, @p last must be corroborated by the next far ahead packet.
+  /// @return false if @p first is too far behind, if there are too many sources, or if @p last is
+  /// not corroborated yet.
+  bool
+  admit_sources(std::uint32_t first, std::uint32_t last);
+
+  /// @brief Make room for the repair @p id in the window of repairs.
+  ///
+  /// When @p id is too far ahead, the oldest repairs are dropped. If all known repairs would be,
+  /// @p id must be corroborated by the next far ahead repair.
+  /// @return false if @p id is too far behind, or if it's not corroborated yet.
+  bool
+  admit_repair(std::uint32_t id)
+  noexcept;
+
+  /// @brief Drop a repair and its links to the missing sources it encodes.
+  void
+  forget_repair(std::uint32_t id)
+  noexcept;
 
   /// @brief Drop outdated sources and repairs.
   /// @param id The oldest id to keep. 
@@ -123,6 +279,16 @@ private:
   drop_outdated(std::uint32_t id)
   noexcept;
 
+  /// @brief Tell that in-order delivery skips the missing sources in [first, last).
+  void
+  skip(std::uint32_t first, std::uint32_t last)
+  noexcept;
+
+  /// @brief Release the last closed block if all its sources are known.
+  void
+  release_block()
+  noexcept;
+
   /// @brief Remove a source from a repair, but not the id from the list of source identifiers.
   /// @attention The id of the removed src must be removed from the repair's list of source
   /// identifiers afterwards.
@@ -135,30 +301,55 @@ private:
   void
   attempt_full_decoding();
 
-  /// @brief Give to callback ordered sources, if possible.
+  /// @brief Try to construct the smallest prefix of missing sources which is encoded by as many
+  /// repairs.
+  /// @return false if there is no such prefix.
+  bool
+  decode_prefix();
+
+  /// @brief Move the first missing source past the known ones and, with in-order delivery, give
+  /// them to callback.
   void
   flush_ordered_sources();
 
 private:
 
+  /// @brief The maximal number of ranges of held sources.
+  static constexpr std::size_t max_held_ranges = 64;
+
+  /// @brief Where the buffers of decoded sources come from.
+  ///
+  /// It's the first member, as it shall outlive all sources and repairs.
+  packet_pool m_packet_pool;
+
   /// @brief The implementation of a Galois field.
   galois_field m_gf;
 
   /// @brief Indicates if sources should be given in-order to the callback.
   const bool m_in_order;
 
-  /// @brief The identifier of the first source which has not yet been given in order to callback.
+  /// @brief The identifier of the first source which is neither known nor outdated.
   ///
-  /// Used to give sources in-order to the callback.
-  std::uint32_t m_first_missing_source_in_order;
+  /// Used to give sources in-order to the callback: it's the first source which has not yet been
+  /// given to callback, known sources with a greater identifier are the ones which are waiting for
+  /// older sources. Also used to acknowledge all older sources at once.
+  std::uint32_t m_first_missing_source;
 
-  /// @brief Maintains a list of sources which could not be given to callback when some older
-  /// sources are still missing.
-  boost::container::map<std::uint32_t, const decoder_source*> m_ordered_sources;
+  /// @brief The ranges of sources received or decoded after the first missing one.
+  std::vector<source_id_range> m_held_sources;
 
   /// @brief The callback to call when a source has been decoded or received.
   const std::function<void(const decoder_source&)> m_callback;
 
+  /// @brief The callback to call when in-order delivery skips missing sources, if any.
+  std::function<void(std::uint32_t, std::uint32_t)> m_gap_callback;
+
+  /// @brief The callback to call when a source is held, if any.
+  std::function<void(std::uint32_t)> m_hold_callback;
+
+  /// @brief How missing sources are rebuilt.
+  decoding_engine m_engine;
+
   /// @brief The set of received repairs.
   repairs_set_type m_repairs;
 
@@ -170,9 +361,27 @@ private:
   /// All sources with an identifier smaller than this value were received or decoded in the past.
   boost::optional<std::uint32_t> m_last_id;
 
+  /// @brief The end of the last closed block which has not been released yet.
+  boost::optional<std::uint32_t> m_block_end;
+
+  /// @brief Sources with an identifier smaller than this value were given up on by skip_to().
+  std::uint32_t m_skipped;
+
+  /// @brief The last source identifier so far ahead that all known sources would be given up on.
+  boost::optional<std::uint32_t> m_far_source;
+
+  /// @brief The last repair identifier so far ahead that all known repairs would be dropped.
+  boost::optional<std::uint32_t> m_far_repair;
+
   /// @brief All sources that have not been yet received, but which are referenced by a repair.
   missing_sources_type m_missing_sources;
 
+  /// @brief Repairs which encode only one missing source, waiting to be decoded.
+  std::vector<std::uint32_t> m_degree_one;
+
+  /// @brief The rows of the progressive engine.
+  echelon_form m_echelon;
+
   /// @brief The number of repairs which were dropped because they were useless.
   std::size_t m_nb_useless_repairs;
 
@@ -182,14 +391,45 @@ private:
   /// @brief The number of decoded sources.
   std::size_t m_nb_decoded;
 
+  /// @brief The number of missing sources skipped by in-order delivery.
+  std::size_t m_nb_skipped;
+
   /// @brief Re-use the same memory for the matrix of coefficients.
   square_matrix m_coefficients;
 
   /// @brief Re-use the same memory for the inverted matrix of coefficients.
   square_matrix m_inv;
 
+  /// @brief Re-use the same memory for the repairs sorted by their newest missing source.
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> m_last_ids;
+
+  /// @brief Re-use the same memory for the missing sources to decode together.
+  std::vector<std::uint32_t> m_prefix;
+
   /// @brief Re-use the same memory for the index of repairs in the inverted matrix.
   std::vector<decoder_repair*> m_index;
+
+  /// @brief Re-use the same memory for the sources decoded together.
+  std::vector<decoder_source> m_decoded_sources;
+
+  /// @brief Re-use the same memory for the symbols of repairs combined to decode a source.
+  std::vector<const char*> m_symbols;
+
+  /// @brief Re-use the same memory for the sizes of repairs combined to decode a source.
+  std::vector<std::size_t> m_sizes;
+
+  /// @brief Re-use the same memory for the coefficients of repairs combined to decode a source.
+  std::vector<std::uint32_t> m_dot_coefficients;
+
+  /// @brief Re-use the same memory for where the repairs combined to decode each source start in
+  /// m_symbols, m_sizes and m_dot_coefficients.
+  std::vector<std::size_t> m_offsets;
+
+  /// @brief The threads which rebuild missing sources, if there are more than one.
+  std::unique_ptr<thread_pool> m_pool;
+
+  /// @brief A Galois field for each thread of m_pool, as a field has its own scratch space.
+  std::vector<std::unique_ptr<galois_field>> m_pool_gfs;
 };
 
 /*------------------------------------------------------------------------------------------------*/
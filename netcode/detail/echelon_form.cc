@@ -0,0 +1,308 @@
+#include <algorithm>  // copy_n, min
+#include <cassert>
+
+#include "netcode/detail/echelon_form.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+echelon_form::echelon_form(galois_field& gf, packet_pool& pool)
+  : m_gf(gf)
+  , m_pool(pool)
+  , m_rows{}
+  , m_decoded{}
+  , m_references{}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+echelon_form::add(const decoder_repair& r)
+{
+  assert(not r.source_ids().empty());
+
+  auto x = row{{}, zero_byte_buffer(r.symbol(), r.symbol() + r.symbol_size()), r.encoded_size()};
+  for (const auto src_id : r.source_ids())
+  {
+    x.coefficients.emplace_hint(x.coefficients.end(), src_id
+                               , m_gf.coefficient(r.coefficient_id(), src_id));
+  }
+  return insert(std::move(x));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::remove(const decoder_source& src)
+{
+  for (auto& pivot_row : m_rows)
+  {
+    auto& x = pivot_row.second;
+    const auto search = x.coefficients.find(src.id());
+    if (search == x.coefficients.end())
+    {
+      continue;
+    }
+    const auto coeff = search->second;
+    x.coefficients.erase(search);
+    unreference(src.id());
+
+    // Remove source size and symbol.
+    x.encoded_size
+      = static_cast<std::uint16_t>(m_gf.multiply_size(src.symbol_size(), coeff) ^ x.encoded_size);
+    if (x.symbol.size() < src.symbol_size())
+    {
+      x.symbol.resize(src.symbol_size());
+    }
+    m_gf.multiply_add(src.symbol(), x.symbol.data(), src.symbol_size(), coeff);
+
+    if (pivot_row.first != src.id())
+    {
+      check_decoded(pivot_row.first, x);
+    }
+  }
+
+  // The row whose pivot was src, if any, has to be inserted again.
+  const auto search = m_rows.find(src.id());
+  if (search != m_rows.end())
+  {
+    auto x = std::move(search->second);
+    unreference(x);
+    m_rows.erase(search);
+    m_decoded.erase(src.id());
+    if (not x.coefficients.empty())
+    {
+      // Other pivots are already absent from this row, insert() only has to choose a new pivot.
+      insert(std::move(x));
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::drop_outdated(std::uint32_t id)
+noexcept
+{
+  for (auto cit = m_rows.begin(), end = m_rows.end(); cit != end;)
+  {
+    if (cit->second.coefficients.begin()->first < id)
+    {
+      unreference(cit->second);
+      m_decoded.erase(cit->first);
+      cit = m_rows.erase(cit);
+    }
+    else
+    {
+      ++cit;
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+echelon_form::has_decoded()
+const noexcept
+{
+  return not m_decoded.empty();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+decoder_source
+echelon_form::pop_decoded()
+{
+  assert(has_decoded());
+
+  const auto pivot = *m_decoded.begin();
+  m_decoded.erase(m_decoded.begin());
+
+  const auto search = m_rows.find(pivot);
+  assert(search != m_rows.end());
+  const auto& x = search->second;
+  assert(x.coefficients.size() == 1 and x.coefficients.begin()->second == 1);
+
+  // The pivot's coefficient is 1, the row holds the source itself.
+  const auto src_sz = x.encoded_size;
+  auto src = decoder_source{ pivot
+                           , packet(m_pool, src_sz + packet::alignment, 0 /* zero out the buffer */)
+                           , src_sz};
+  std::copy_n(x.symbol.data(), std::min(x.symbol.size(), static_cast<std::size_t>(src_sz))
+             , src.symbol());
+
+  unreference(x);
+  m_rows.erase(search);
+  return src;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::clear()
+noexcept
+{
+  m_rows.clear();
+  m_decoded.clear();
+  m_references.clear();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+echelon_form::rank()
+const noexcept
+{
+  return m_rows.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+echelon_form::nb_missing_sources()
+const noexcept
+{
+  return m_references.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+echelon_form::insert(row&& x)
+{
+  // Eliminate existing pivots. As rows are reduced, it doesn't introduce other pivots in x.
+  for (const auto& pivot_row : m_rows)
+  {
+    const auto search = x.coefficients.find(pivot_row.first);
+    if (search != x.coefficients.end())
+    {
+      add_multiple(x, pivot_row.second, search->second, false);
+    }
+  }
+
+  if (x.coefficients.empty())
+  {
+    // A linear combination of existing rows.
+    return false;
+  }
+
+  // Normalize x so that its pivot's coefficient is 1.
+  const auto pivot = x.coefficients.begin()->first;
+  const auto coeff = x.coefficients.begin()->second;
+  if (coeff != 1)
+  {
+    const auto inv = m_gf.invert(coeff);
+    for (auto& src_coeff : x.coefficients)
+    {
+      src_coeff.second = m_gf.multiply(src_coeff.second, inv);
+    }
+    x.encoded_size = m_gf.multiply_size(x.encoded_size, inv);
+    m_gf.multiply(x.symbol.data(), x.symbol.data(), x.symbol.size(), inv);
+  }
+
+  // Eliminate the new pivot from all other rows.
+  for (auto& pivot_row : m_rows)
+  {
+    const auto search = pivot_row.second.coefficients.find(pivot);
+    if (search != pivot_row.second.coefficients.end())
+    {
+      add_multiple(pivot_row.second, x, search->second, true);
+      check_decoded(pivot_row.first, pivot_row.second);
+    }
+  }
+
+  const auto insertion = m_rows.emplace(pivot, std::move(x));
+  assert(insertion.second && "Pivot already used");
+  reference(insertion.first->second);
+  check_decoded(pivot, insertion.first->second);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::add_multiple(row& dst, const row& src, std::uint32_t coeff, bool in_rows)
+{
+  for (const auto& src_coeff : src.coefficients)
+  {
+    const auto value = m_gf.multiply(src_coeff.second, coeff);
+    const auto search = dst.coefficients.find(src_coeff.first);
+    if (search == dst.coefficients.end())
+    {
+      dst.coefficients.emplace(src_coeff.first, value);
+      if (in_rows)
+      {
+        ++m_references[src_coeff.first];
+      }
+    }
+    else if ((search->second ^= value) == 0)
+    {
+      dst.coefficients.erase(search);
+      if (in_rows)
+      {
+        unreference(src_coeff.first);
+      }
+    }
+  }
+
+  dst.encoded_size
+    = static_cast<std::uint16_t>(m_gf.multiply_size(src.encoded_size, coeff) ^ dst.encoded_size);
+  if (dst.symbol.size() < src.symbol.size())
+  {
+    dst.symbol.resize(src.symbol.size());
+  }
+  m_gf.multiply_add(src.symbol.data(), dst.symbol.data(), src.symbol.size(), coeff);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::reference(const row& x)
+{
+  for (const auto& src_coeff : x.coefficients)
+  {
+    ++m_references[src_coeff.first];
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::unreference(const row& x)
+noexcept
+{
+  for (const auto& src_coeff : x.coefficients)
+  {
+    unreference(src_coeff.first);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::unreference(std::uint32_t src_id)
+noexcept
+{
+  const auto search = m_references.find(src_id);
+  assert(search != m_references.end() && "Source not referenced");
+  if (--search->second == 0)
+  {
+    m_references.erase(search);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+echelon_form::check_decoded(std::uint32_t pivot, const row& x)
+{
+  if (x.coefficients.size() == 1)
+  {
+    m_decoded.insert(pivot);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <boost/container/flat_set.hpp>
+#include <boost/container/map.hpp>
+
+#include "netcode/detail/buffer.hh"
+#include "netcode/detail/galois_field.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source.hh"
+#include "netcode/packet_pool.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A system of linear equations on missing sources, kept in reduced row echelon form.
+///
+/// Each row is a linear combination of missing sources, with its own symbol and encoded size.
+/// Every row has a pivot, a source whose coefficient is 1 in this row and 0 in all others. When an
+/// equation is added, the pivots are eliminated from it, then its own pivot is eliminated from all
+/// other rows (Gauss-Jordan elimination). Thus, a row reduced to its pivot is a decoded source.
+class echelon_form final
+{
+public:
+
+  /// @brief Constructor.
+  /// @param pool Where the buffers of decoded sources come from.
+  echelon_form(galois_field& gf, packet_pool& pool);
+
+  /// @brief Add the equation given by a repair.
+  /// @attention Sources already known shall have been removed from @p r beforehand.
+  /// @return false if @p r is a linear combination of the existing rows, and thus useless.
+  bool
+  add(const decoder_repair& r);
+
+  /// @brief Remove a newly known source from all rows.
+  void
+  remove(const decoder_source& src);
+
+  /// @brief Drop all rows that reference sources with an identifier smaller than @p id.
+  void
+  drop_outdated(std::uint32_t id)
+  noexcept;
+
+  /// @brief Tell if a row is reduced to its pivot.
+  bool
+  has_decoded()
+  const noexcept;
+
+  /// @brief Remove a row reduced to its pivot and build the corresponding source.
+  /// @pre has_decoded()
+  decoder_source
+  pop_decoded();
+
+  /// @brief Drop all rows.
+  void
+  clear()
+  noexcept;
+
+  /// @brief Get the number of rows.
+  std::size_t
+  rank()
+  const noexcept;
+
+  /// @brief Get the number of sources referenced by rows.
+  std::size_t
+  nb_missing_sources()
+  const noexcept;
+
+private:
+
+  /// @brief An equation on missing sources.
+  struct row
+  {
+    /// @brief The coefficients of the missing sources, indexed by source identifier.
+    boost::container::map<std::uint32_t, std::uint32_t> coefficients;
+
+    /// @brief The combination of symbols.
+    zero_byte_buffer symbol;
+
+    /// @brief The combination of sizes.
+    std::uint16_t encoded_size;
+  };
+
+  /// @brief Eliminate pivots from @p x, then add it as a new row.
+  /// @return false if @p x was reduced to nothing.
+  bool
+  insert(row&& x);
+
+  /// @brief Compute dst = dst + coeff * src.
+  /// @param in_rows Tell if @p dst is one of the rows, whose sources are counted.
+  void
+  add_multiple(row& dst, const row& src, std::uint32_t coeff, bool in_rows);
+
+  /// @brief Count the sources of a row which is added to the rows.
+  void
+  reference(const row& x);
+
+  /// @brief Stop counting the sources of a row which is removed from the rows.
+  void
+  unreference(const row& x)
+  noexcept;
+
+  /// @brief Stop counting a source which is removed from a row.
+  void
+  unreference(std::uint32_t src_id)
+  noexcept;
+
+  /// @brief Remember a row if it's reduced to its pivot.
+  void
+  check_decoded(std::uint32_t pivot, const row& x);
+
+private:
+
+  /// @brief The Galois field used to combine rows.
+  galois_field& m_gf;
+
+  /// @brief Where the buffers of decoded sources come from.
+  packet_pool& m_pool;
+
+  /// @brief The rows, indexed by their pivot.
+  boost::container::map<std::uint32_t, row> m_rows;
+
+  /// @brief The pivots of rows reduced to their pivot.
+  boost::container::flat_set<std::uint32_t> m_decoded;
+
+  /// @brief The number of rows which reference each missing source.
+  boost::container::map<std::uint32_t, std::size_t> m_references;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -1,3 +1,4 @@
+#include <algorithm> // max
 #include <cstdint>
 
 #include "netcode/detail/encoder.hh"
@@ -8,58 +9,71 @@ namespace ntc { namespace detail {
 
 encoder::encoder(std::uint8_t galois_field_size)
   : m_gf{galois_field_size}
+  , m_symbols{}
+  , m_sizes{}
+  , m_coefficients{}
 {}
 
 /*------------------------------------------------------------------------------------------------*/
 
+template <typename Field>
 void
-encoder::operator()(encoder_repair& repair, source_list& sources)
+encoder::encode(const Field& field, encoder_repair& repair, source_list& sources)
 {
-  assert(sources.size() && "Empty source list");
-
   auto cit = sources.cbegin();
   const auto src_end = sources.cend();
 
-  assert((reinterpret_cast<std::uintptr_t>(cit->symbol().data()) % 16) == 0);
-
-  // Resize the repair's symbol buffer to fit the first source symbol buffer.
-  repair.symbol().resize(cit->size());
-
-  // Add the current source id to the list of encoded sources by this repair.
-  repair.source_ids().insert(repair.source_ids().end(), cit->id());
-
-  // The coefficient for this repair and source.
-  auto c = m_gf.coefficient(repair.id(), cit->id());
+  assert((reinterpret_cast<std::uintptr_t>(cit->symbol()) % 16) == 0);
 
-  // Only multiply for the first source, no need to add with repair.
-  m_gf.multiply(cit->symbol().data(), repair.symbol().data(), cit->size(), c);
+  // Coefficients are generated from the repair's own identifier.
+  repair.coefficient_id() = repair.id();
+  repair.keyed() = false;
 
-  // Initialize the user's size.
-  repair.encoded_size() = m_gf.multiply_size(cit->size(), c);
-
-  // Then, for each remaining source, multiply it with a coefficient and add it with
-  // current repair.
-  for (++cit; cit != src_end; ++cit)
+  m_symbols.clear();
+  m_sizes.clear();
+  m_coefficients.clear();
+  repair.encoded_size() = 0;
+  auto max_size = std::size_t{0};
+  for (; cit != src_end; ++cit)
   {
-    // The current repair's symbol buffer might be too small for the current source.
-    if (cit->size() > repair.symbol().size())
-    {
-      repair.symbol().resize(cit->size());
-    }
-
     // The coefficient for this repair and source.
-    c = m_gf.coefficient(repair.id(), cit->id());
+    const auto c = Field::coefficient(repair.id(), cit->id());
 
     // Add the current source id to the list of encoded sources by this repair.
     repair.source_ids().insert(repair.source_ids().end(), cit->id());
 
-    // Multiply and add for all following sources.
-    m_gf.multiply_add(cit->symbol().data(), repair.symbol().data(), cit->size(), c);
+    m_symbols.push_back(cit->symbol());
+    m_sizes.push_back(cit->size());
+    m_coefficients.push_back(c);
+    max_size = std::max(max_size, static_cast<std::size_t>(cit->size()));
 
-    // Finally, add the user size.
+    // Add the user size.
     // Cast is necessary to inhibit conversion warning as xor implicitly convert to a signed value.
     repair.encoded_size()
-      = static_cast<std::uint16_t>(m_gf.multiply_size(cit->size(), c) ^ repair.encoded_size());
+      = static_cast<std::uint16_t>(field.multiply_size(cit->size(), c) ^ repair.encoded_size());
+  }
+
+  // The repair's symbol buffer must fit the largest source symbol buffer.
+  repair.symbol().resize(max_size);
+
+  // Multiply all sources with their coefficient and add them in a single pass on the repair.
+  m_gf.dot_product( m_symbols.data(), m_sizes.data(), m_coefficients.data(), m_symbols.size()
+                  , repair.symbol().data(), max_size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder::operator()(encoder_repair& repair, source_list& sources)
+{
+  assert(sources.size() && "Empty source list");
+
+  switch (m_gf.size())
+  {
+    case 4 : encode(gf4{}, repair, sources); break;
+    case 8 : encode(gf8{}, repair, sources); break;
+    case 16: encode(gf16{}, repair, sources); break;
+    default: encode(gf32{}, repair, sources); break;
   }
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "netcode/detail/galois_field.hh"
 #include "netcode/detail/repair.hh"
 #include "netcode/detail/source.hh"
@@ -24,10 +26,27 @@ public:
   void
   operator()(encoder_repair& repair, source_list& sources);
 
+private:
+
+  /// @brief Fill a @ref detail::repair, with the scalar arithmetic of a field size known at
+  /// compile-time.
+  template <typename Field>
+  void
+  encode(const Field& field, encoder_repair& repair, source_list& sources);
+
 private:
 
   /// @brief The implementation of a Galois field.
   detail::galois_field m_gf;
+
+  /// @brief The symbols of the sources to encode, reused between repairs.
+  std::vector<const char*> m_symbols;
+
+  /// @brief The sizes of the sources to encode, reused between repairs.
+  std::vector<std::size_t> m_sizes;
+
+  /// @brief The coefficients of the sources to encode, reused between repairs.
+  std::vector<std::uint32_t> m_coefficients;
 };
 
 /*------------------------------------------------------------------------------------------------*/
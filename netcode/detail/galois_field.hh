@@ -1,14 +1,19 @@
 #pragma once
 
+#include <algorithm> // fill_n, min
 #include <cassert>
 #include <cstddef> // size_t
 #include <cstdint>
 #include <stdexcept>
+#include <vector>
 
 extern "C" {
 #include <gf_complete.h>
 }
 
+#include "netcode/detail/gf_field.hh"
+#include "netcode/detail/gf_region.hh"
+
 namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
@@ -35,12 +40,33 @@ public:
   explicit galois_field(std::uint8_t w)
     : m_gf() // '()' to avoid warning about members uninitialized
     , m_w{w}
+    , m_kernel(gf_region_selected().get(w))
+    , m_prepared{}
+    , m_scratch()
+    , m_coefficients{}
   {
     assert(w== 4 or w == 8 or w == 16 or w == 32);
     if (gf_init_easy(&m_gf, static_cast<int>(m_w)) == 0)
     {
       throw std::runtime_error("Can't allocate galois field");
     }
+    // Small fields have few coefficients, prepare all of them once for all.
+    if (m_kernel.multiply and m_w <= 8)
+    {
+      m_prepared.resize(1u << m_w);
+      for (auto coeff = 0u; coeff < m_prepared.size(); ++coeff)
+      {
+        gf_region_prepare(m_prepared[coeff], m_w, coeff);
+      }
+    }
+    // Compute the tables of the scalar arithmetic now, rather than on first use.
+    switch (m_w)
+    {
+      case 4 : static_cast<void>(gf4{}); break;
+      case 8 : static_cast<void>(gf8{}); break;
+      case 16: static_cast<void>(gf16{}); break;
+      default: static_cast<void>(gf32{}); break;
+    }
   }
 
   /// @brief Destructor.
@@ -66,6 +92,11 @@ public:
   multiply(const char* src, char* dst, std::size_t len, std::uint32_t coeff)
   noexcept
   {
+    if (m_kernel.multiply)
+    {
+      m_kernel.multiply(prepared(coeff), src, dst, len, false);
+      return;
+    }
     m_gf.multiply_region.w32( &m_gf
                             , const_cast<char*>(src)
                             , dst
@@ -83,6 +114,11 @@ public:
   multiply_add(const char* src, char* dst, std::size_t len, std::uint32_t coeff)
   noexcept
   {
+    if (m_kernel.multiply)
+    {
+      m_kernel.multiply(prepared(coeff), src, dst, len, true);
+      return;
+    }
     m_gf.multiply_region.w32( &m_gf
                             , const_cast<char*>(src)
                             , dst
@@ -91,51 +127,106 @@ public:
                             , 1 /* add to src */);
   }
 
+  /// @brief Multiply regions with constants and sum the results.
+  /// @param srcs The regions to multiply.
+  /// @param lens The size of each region of @p srcs.
+  /// @param coeffs The constant of each region of @p srcs.
+  /// @param n The number of regions.
+  /// @param dst Where to put the result.
+  /// @param len The size of the @p dst region.
+  ///
+  /// A region shorter than @p len is considered to be padded with zeros. Whenever possible, the
+  /// destination is written only once.
+  void
+  dot_product( const char* const* srcs, const std::size_t* lens, const std::uint32_t* coeffs
+             , std::size_t n, char* dst, std::size_t len)
+  {
+    if (m_kernel.dot_product)
+    {
+      m_coefficients.resize(n);
+      for (auto i = 0ul; i < n; ++i)
+      {
+        m_coefficients[i] = prepared(coeffs[i]);
+      }
+      m_kernel.dot_product(m_coefficients.data(), srcs, lens, n, dst, len, false);
+      return;
+    }
+    std::fill_n(dst, len, 0);
+    for (auto i = 0ul; i < n; ++i)
+    {
+      multiply_add(srcs[i], dst, std::min(lens[i], len), coeffs[i]);
+    }
+  }
+
+  /// @brief Multiply a row of elements with a constant.
+  /// @param src The row to multiply.
+  /// @param dst Where to put the result.
+  /// @param len The number of elements of @p src and @p dst.
+  /// @param coeff The constant.
+  void
+  multiply_row(const std::uint32_t* src, std::uint32_t* dst, std::size_t len, std::uint32_t coeff)
+  noexcept
+  {
+    row_operation(src, dst, len, coeff, false);
+  }
+
+  /// @brief Multiply a row of elements with a constant, add the result to another row.
+  /// @param src The row to multiply.
+  /// @param dst The row to add the result to.
+  /// @param len The number of elements of @p src and @p dst.
+  /// @param coeff The constant.
+  void
+  multiply_add_row( const std::uint32_t* src, std::uint32_t* dst, std::size_t len
+                  , std::uint32_t coeff)
+  noexcept
+  {
+    row_operation(src, dst, len, coeff, true);
+  }
+
   /// @brief Multiply a size with a coefficient.
   /// @attention Make sure that the coefficient is generated with galois_field::coefficient.
   std::uint16_t
   multiply_size(std::uint16_t size, std::uint32_t coeff)
-  noexcept
+  const noexcept
   {
     assert(  (((m_w == 4 or m_w == 8 or m_w == 16 ) and coeff < (1u << m_w)) or (m_w == 32))
           && "Invalid coefficient");
 
-    if (size == 0 or coeff == 0)
-    {
-      return 0;
-    }
-
-    if (m_w <= 8) // 4 or 8
+    switch (m_w)
     {
-      __attribute__((aligned(16))) std::uint16_t res;
-      __attribute__((aligned(16))) std::uint16_t size_ = size;
-      multiply( reinterpret_cast<char*>(&size_), reinterpret_cast<char*>(&res)
-              , sizeof(std::uint16_t), coeff);
-      return res;
-    }
-    else // w = 16 or 32
-    {
-      return static_cast<std::uint16_t>(m_gf.multiply.w32(&m_gf, size, coeff));
+      case 4 : return gf4{}.multiply_size(size, coeff);
+      case 8 : return gf8{}.multiply_size(size, coeff);
+      case 16: return gf16{}.multiply_size(size, coeff);
+      default: return gf32{}.multiply_size(size, coeff);
     }
   }
 
-  /// @brief Multiply two coefficients, to use when inverting a matrix.
+  /// @brief Multiply two coefficients.
   std::uint32_t
   multiply(std::uint32_t x, std::uint32_t y)
-  noexcept
+  const noexcept
   {
-    return (x == 0 or y == 0)
-         ? 0
-         : m_gf.multiply.w32(&m_gf, x, y);
+    switch (m_w)
+    {
+      case 4 : return gf4{}.multiply(x, y);
+      case 8 : return gf8{}.multiply(x, y);
+      case 16: return gf16{}.multiply(x, y);
+      default: return gf32{}.multiply(x, y);
+    }
   }
 
   /// @brief Invert a coeeficient.
   std::uint32_t
   invert(std::uint32_t coef)
-  noexcept
+  const noexcept
   {
-    assert(coef != 0);
-    return m_gf.divide.w32(&m_gf, 1, coef);
+    switch (m_w)
+    {
+      case 4 : return gf4{}.invert(coef);
+      case 8 : return gf8{}.invert(coef);
+      case 16: return gf16{}.invert(coef);
+      default: return gf32{}.invert(coef);
+    }
   }
 
   /// @brief Get the coefficient for a repair and a source.
@@ -144,16 +235,68 @@ public:
   coefficient(std::uint32_t repair_id, std::uint32_t src_id)
   const noexcept
   {
-    if (m_w == 32)
+    switch (m_w)
+    {
+      case 4 : return gf4::coefficient(repair_id, src_id);
+      case 8 : return gf8::coefficient(repair_id, src_id);
+      case 16: return gf16::coefficient(repair_id, src_id);
+      default: return gf32::coefficient(repair_id, src_id);
+    }
+  }
+
+private:
+
+  /// @brief Get the constants needed by region kernels to multiply by @p coeff.
+  /// @attention The result is valid until the next call.
+  const gf_region_coefficient&
+  prepared(std::uint32_t coeff)
+  noexcept
+  {
+    if (not m_prepared.empty())
     {
-      // Unsigned integer overflow is well defined: http://stackoverflow.com/q/18195715/21584
-      const auto res = ((repair_id + 1) + (src_id + 1)) * (repair_id + 1);
-      // But it still can be 0.
-      return res == 0 ? 1 : res;
+      return m_prepared[coeff];
     }
-    else
+    gf_region_prepare(m_scratch, m_w, coeff);
+    return m_scratch;
+  }
+
+  /// @brief Multiply a row of elements with a constant, add the result to @p dst if @p add.
+  void
+  row_operation( const std::uint32_t* src, std::uint32_t* dst, std::size_t len
+               , std::uint32_t coeff, bool add)
+  noexcept
+  {
+    // Short rows don't amortize the call to a kernel.
+    if (m_kernel.multiply and len >= 16)
+    {
+      // Elements are stored in 32 bits words, whose unused high bits are 0. Region kernels are
+      // only available on x86, which is little-endian, thus a word is seen as an element followed
+      // by zeros by kernels of smaller fields. As 0 * coeff = 0, the high bits stay 0.
+      m_kernel.multiply( prepared(coeff), reinterpret_cast<const char*>(src)
+                       , reinterpret_cast<char*>(dst), len * sizeof(std::uint32_t), add);
+      return;
+    }
+    switch (m_w)
+    {
+      case 4 : row_operation(gf4{}, src, dst, len, coeff, add); break;
+      case 8 : row_operation(gf8{}, src, dst, len, coeff, add); break;
+      case 16: row_operation(gf16{}, src, dst, len, coeff, add); break;
+      default: row_operation(gf32{}, src, dst, len, coeff, add); break;
+    }
+  }
+
+  /// @brief Multiply a row of elements with the scalar arithmetic of a field size known at
+  /// compile-time.
+  template <typename Field>
+  static
+  void
+  row_operation( const Field& field, const std::uint32_t* src, std::uint32_t* dst
+               , std::size_t len, std::uint32_t coeff, bool add)
+  noexcept
+  {
+    for (auto i = 0ul; i < len; ++i)
     {
-      return (((repair_id + 1) + (src_id + 1)) * (repair_id + 1)) % ((1 << m_w) - 1) + 1;
+      dst[i] = field.multiply(src[i], coeff) ^ (add ? dst[i] : 0);
     }
   }
 
@@ -164,6 +307,18 @@ private:
 
   /// @brief This field size.
   std::uint8_t  m_w;
+
+  /// @brief The SIMD kernels for this field size, if any; gf-complete is used otherwise.
+  const gf_region_kernel m_kernel;
+
+  /// @brief The constants of all coefficients, for fields small enough.
+  std::vector<gf_region_coefficient> m_prepared;
+
+  /// @brief The constants of the last coefficient, for larger fields.
+  gf_region_coefficient m_scratch;
+
+  /// @brief Scratch space for the coefficients of dot_product().
+  std::vector<gf_region_coefficient> m_coefficients;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+extern "C" {
+#include <gf_complete.h>
+}
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Logarithm and exponential tables of GF(2^W), with the polynomials of gf-complete.
+///
+/// The exponential table is doubled, so that a product is looked up without any modulo.
+template <std::uint8_t W>
+class gf_log_tables final
+{
+public:
+
+  /// @brief The number of non-zero elements of the field.
+  static constexpr std::uint32_t order = (1u << W) - 1;
+
+  /// @brief Get the tables of this field size, computed on first call.
+  static
+  const gf_log_tables&
+  get()
+  {
+    static const gf_log_tables tables;
+    return tables;
+  }
+
+  /// @brief The logarithm of each non-zero element.
+  std::vector<std::uint16_t> log;
+
+  /// @brief The powers of the generator x, from x^0 to x^(2 * (order - 1)).
+  std::vector<std::uint16_t> exp;
+
+private:
+
+  /// @brief Polynomials used by default by gf-complete, without the x^W term.
+  static constexpr std::uint32_t polynomial = W == 4 ? 0x3 : W == 8 ? 0x1d : 0x100b;
+
+  /// @brief Constructor.
+  gf_log_tables()
+    : log(order + 1, 0)
+    , exp(2 * order, 0)
+  {
+    auto x = 1u;
+    for (auto i = 0u; i < order; ++i)
+    {
+      exp[i] = static_cast<std::uint16_t>(x);
+      exp[i + order] = static_cast<std::uint16_t>(x);
+      log[x] = static_cast<std::uint16_t>(i);
+      x <<= 1;
+      if (x & (1u << W))
+      {
+        x = (x & order) ^ polynomial;
+      }
+    }
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The scalar arithmetic of GF(2^W), for W = 4, 8 or 16.
+///
+/// As the field size is known at compile-time, the arithmetic is inlined in loops and doesn't
+/// branch on the field size. Multiplications are table lookups.
+template <std::uint8_t W>
+class gf_field final
+{
+  static_assert(W == 4 or W == 8 or W == 16, "Unsupported field size");
+
+public:
+
+  /// @brief The size of this field.
+  static constexpr std::uint8_t w = W;
+
+  /// @brief Constructor.
+  gf_field()
+    : m_log(gf_log_tables<W>::get().log.data())
+    , m_exp(gf_log_tables<W>::get().exp.data())
+  {}
+
+  /// @brief Get the coefficient for a repair and a source.
+  /// @note The result is guaranted to be different from 0.
+  static
+  std::uint32_t
+  coefficient(std::uint32_t repair_id, std::uint32_t src_id)
+  noexcept
+  {
+    return (((repair_id + 1) + (src_id + 1)) * (repair_id + 1)) % gf_log_tables<W>::order + 1;
+  }
+
+  /// @brief Multiply two elements.
+  std::uint32_t
+  multiply(std::uint32_t x, std::uint32_t y)
+  const noexcept
+  {
+    return (x == 0 or y == 0) ? 0 : m_exp[m_log[x] + m_log[y]];
+  }
+
+  /// @brief Invert an element.
+  std::uint32_t
+  invert(std::uint32_t x)
+  const noexcept
+  {
+    assert(x != 0);
+    return m_exp[gf_log_tables<W>::order - m_log[x]];
+  }
+
+  /// @brief Multiply a size with a coefficient.
+  ///
+  /// Like a region of 2 bytes, the size is made of 16 / W elements which are multiplied
+  /// independently.
+  std::uint16_t
+  multiply_size(std::uint16_t size, std::uint32_t coeff)
+  const noexcept
+  {
+    auto res = 0u;
+    for (auto shift = 0u; shift < 16; shift += W)
+    {
+      res |= multiply((size >> shift) & gf_log_tables<W>::order, coeff) << shift;
+    }
+    return static_cast<std::uint16_t>(res);
+  }
+
+private:
+
+  /// @brief The logarithm table.
+  const std::uint16_t* m_log;
+
+  /// @brief The exponential table.
+  const std::uint16_t* m_exp;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The scalar arithmetic of GF(2^32).
+///
+/// Tables would be too large, gf-complete is used instead.
+template <>
+class gf_field<32> final
+{
+public:
+
+  /// @brief The size of this field.
+  static constexpr std::uint8_t w = 32;
+
+  /// @brief Constructor.
+  gf_field()
+    : m_gf(shared())
+  {}
+
+  /// @brief Get the coefficient for a repair and a source.
+  /// @note The result is guaranted to be different from 0.
+  static
+  std::uint32_t
+  coefficient(std::uint32_t repair_id, std::uint32_t src_id)
+  noexcept
+  {
+    // Unsigned integer overflow is well defined: http://stackoverflow.com/q/18195715/21584
+    const auto res = ((repair_id + 1) + (src_id + 1)) * (repair_id + 1);
+    // But it still can be 0.
+    return res == 0 ? 1 : res;
+  }
+
+  /// @brief Multiply two elements.
+  std::uint32_t
+  multiply(std::uint32_t x, std::uint32_t y)
+  const noexcept
+  {
+    return (x == 0 or y == 0) ? 0 : m_gf->multiply.w32(m_gf, x, y);
+  }
+
+  /// @brief Invert an element.
+  std::uint32_t
+  invert(std::uint32_t x)
+  const noexcept
+  {
+    assert(x != 0);
+    return m_gf->divide.w32(m_gf, 1, x);
+  }
+
+  /// @brief Multiply a size with a coefficient.
+  /// @attention The product is truncated to 16 bits.
+  std::uint16_t
+  multiply_size(std::uint16_t size, std::uint32_t coeff)
+  const noexcept
+  {
+    return static_cast<std::uint16_t>(multiply(size, coeff));
+  }
+
+private:
+
+  /// @brief Get the gf-complete field shared by all instances.
+  static
+  gf_t*
+  shared()
+  {
+    struct holder
+    {
+      gf_t gf;
+
+      holder()
+        : gf() // '()' to avoid warning about members uninitialized
+      {
+        if (gf_init_easy(&gf, 32) == 0)
+        {
+          throw std::runtime_error("Can't allocate galois field");
+        }
+      }
+
+      ~holder()
+      {
+        gf_free(&gf, 0 /* non-recursive */);
+      }
+    };
+    static holder h;
+    return &h.gf;
+  }
+
+private:
+
+  /// @brief The real underlying galois field.
+  gf_t* m_gf;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief GF(2^4).
+using gf4 = gf_field<4>;
+
+/// @internal
+/// @brief GF(2^8).
+using gf8 = gf_field<8>;
+
+/// @internal
+/// @brief GF(2^16).
+using gf16 = gf_field<16>;
+
+/// @internal
+/// @brief GF(2^32).
+using gf32 = gf_field<32>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,259 @@
+#include "netcode/detail/gf_region.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef NTC_GF_REGION_SSSE3
+extern const gf_region_kernels gf_region_ssse3;
+#endif
+#ifdef NTC_GF_REGION_AVX2
+extern const gf_region_kernels gf_region_avx2;
+#endif
+#ifdef NTC_GF_REGION_AVX2_GFNI
+extern const gf_region_kernels gf_region_avx2_gfni;
+#endif
+#ifdef NTC_GF_REGION_AVX512
+extern const gf_region_kernels gf_region_avx512;
+#endif
+#ifdef NTC_GF_REGION_AVX512_GFNI
+extern const gf_region_kernels gf_region_avx512_gfni;
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief Polynomials used by default by gf-complete, without the x^w term.
+std::uint64_t
+polynomial(unsigned int w)
+noexcept
+{
+  switch (w)
+  {
+    case 4 : return 0x3;
+    case 8 : return 0x1d;
+    case 16: return 0x100b;
+    default: return 0x400007;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Multiply by x in GF(2^w).
+std::uint32_t
+times_x(std::uint32_t a, unsigned int w)
+noexcept
+{
+  const auto high = (a >> (w - 1)) & 1;
+  const auto mask = w == 32 ? 0xffffffffu : ((1u << w) - 1);
+  return ((a << 1) & mask) ^ (high ? static_cast<std::uint32_t>(polynomial(w)) : 0u);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Compute floor(x^2w / polynomial) in GF(2)[x].
+std::uint64_t
+barrett(unsigned int w)
+noexcept
+{
+  const auto p = polynomial(w) | (std::uint64_t{1} << w);
+  // First step of the division of x^2w is always taken, which keeps the remainder in 64 bits.
+  auto mu = std::uint64_t{1} << w;
+  auto rem = polynomial(w) << w;
+  for (auto i = w; i-- > 0;)
+  {
+    if ((rem >> (w + i)) & 1)
+    {
+      mu |= std::uint64_t{1} << i;
+      rem ^= p << i;
+    }
+  }
+  return mu;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell if the running CPU supports an instruction set.
+bool
+supports(const gf_region_kernels& kernels)
+noexcept
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+# ifdef NTC_GF_REGION_SSSE3
+  if (&kernels == &gf_region_ssse3)
+  {
+    return __builtin_cpu_supports("ssse3") and __builtin_cpu_supports("pclmul");
+  }
+# endif
+# ifdef NTC_GF_REGION_AVX2
+  if (&kernels == &gf_region_avx2)
+  {
+    return __builtin_cpu_supports("avx2");
+  }
+# endif
+# ifdef NTC_GF_REGION_AVX2_GFNI
+  if (&kernels == &gf_region_avx2_gfni)
+  {
+    return __builtin_cpu_supports("avx2") and __builtin_cpu_supports("gfni")
+       and __builtin_cpu_supports("vpclmulqdq");
+  }
+# endif
+# ifdef NTC_GF_REGION_AVX512
+  if (&kernels == &gf_region_avx512)
+  {
+    return __builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw");
+  }
+# endif
+# ifdef NTC_GF_REGION_AVX512_GFNI
+  if (&kernels == &gf_region_avx512_gfni)
+  {
+    return __builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw")
+       and __builtin_cpu_supports("gfni") and __builtin_cpu_supports("vpclmulqdq");
+  }
+# endif
+#endif
+  (void)kernels;
+  return false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Combine the best kernels of each field size.
+gf_region_kernels
+select()
+{
+  auto res = gf_region_kernels{"gf-complete", {nullptr, nullptr}, {nullptr, nullptr}
+                              , {nullptr, nullptr}, {nullptr, nullptr}};
+  const auto pick = [](gf_region_kernel& best, const gf_region_kernel& candidate)
+  {
+    if (best.multiply == nullptr)
+    {
+      best = candidate;
+    }
+  };
+  const auto available = gf_region_available();
+  for (const auto& kernels : available)
+  {
+    pick(res.w4, kernels.w4);
+    pick(res.w8, kernels.w8);
+    pick(res.w16, kernels.w16);
+    pick(res.w32, kernels.w32);
+  }
+  if (not available.empty())
+  {
+    res.name = available.front().name;
+  }
+  return res;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::vector<gf_region_kernels>
+gf_region_available()
+{
+  const auto candidates = std::vector<const gf_region_kernels*>
+  {
+#ifdef NTC_GF_REGION_AVX512_GFNI
+    &gf_region_avx512_gfni,
+#endif
+#ifdef NTC_GF_REGION_AVX2_GFNI
+    &gf_region_avx2_gfni,
+#endif
+#ifdef NTC_GF_REGION_AVX512
+    &gf_region_avx512,
+#endif
+#ifdef NTC_GF_REGION_AVX2
+    &gf_region_avx2,
+#endif
+#ifdef NTC_GF_REGION_SSSE3
+    &gf_region_ssse3,
+#endif
+  };
+
+  auto res = std::vector<gf_region_kernels>{};
+  for (const auto kernels : candidates)
+  {
+    if (supports(*kernels))
+    {
+      res.push_back(*kernels);
+    }
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const gf_region_kernels&
+gf_region_selected()
+{
+  static const auto selected = select();
+  return selected;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+gf_region_prepare(gf_region_coefficient& c, unsigned int w, std::uint32_t coeff)
+noexcept
+{
+  c.coeff = coeff;
+  c.polynomial = polynomial(w) | (std::uint64_t{1} << w);
+  if (w > 8)
+  {
+    static const auto mu_16 = barrett(16);
+    static const auto mu_32 = barrett(32);
+    c.mu = w == 16 ? mu_16 : mu_32;
+    return;
+  }
+
+  // Products of the coefficient with x^j, for each bit j of a byte (of a nibble in GF(2^4)).
+  std::uint32_t powers[8];
+  powers[0] = coeff;
+  for (auto j = 1u; j < w; ++j)
+  {
+    powers[j] = times_x(powers[j - 1], w);
+  }
+
+  c.low[0] = 0;
+  c.high[0] = 0;
+  for (auto i = 1u; i < 16; ++i)
+  {
+    const auto j = static_cast<unsigned int>(__builtin_ctz(i));
+    if (w == 4)
+    {
+      c.low[i] = static_cast<std::uint8_t>(c.low[i & (i - 1)] ^ powers[j]);
+      c.high[i] = static_cast<std::uint8_t>(c.low[i] << 4);
+    }
+    else
+    {
+      c.low[i] = static_cast<std::uint8_t>(c.low[i & (i - 1)] ^ powers[j]);
+      c.high[i] = static_cast<std::uint8_t>(c.high[i & (i - 1)] ^ powers[j + 4]);
+    }
+  }
+
+  // GF2P8AFFINEQB computes bit i of the result with the byte 7 - i of the matrix, whose bit j
+  // tells if bit j of the source contributes, that is if bit i of coeff * x^j is set. Thus, the
+  // matrix is the transpose of the products with x^j, with bytes in reverse order.
+  auto m = std::uint64_t{0};
+  for (auto j = 0u; j < 8; ++j)
+  {
+    // In GF(2^4), nibbles are independent.
+    const auto product = w == 8 ? powers[j] : j < 4 ? powers[j] : (powers[j - 4] << 4);
+    m |= std::uint64_t{product & 0xff} << (8 * j);
+  }
+  auto t = (m ^ (m >> 7)) & 0x00aa00aa00aa00aaull;
+  m = m ^ t ^ (t << 7);
+  t = (m ^ (m >> 14)) & 0x0000cccc0000ccccull;
+  m = m ^ t ^ (t << 14);
+  t = (m ^ (m >> 28)) & 0x00000000f0f0f0f0ull;
+  m = m ^ t ^ (t << 28);
+  c.affine = __builtin_bswap64(m);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <vector>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The constants needed by a region kernel to multiply by a coefficient.
+/// @see gf_region_prepare
+struct gf_region_coefficient
+{
+  /// @brief Products of the coefficient with all values of the low nibble of a byte.
+  alignas(16) std::uint8_t low[16];
+
+  /// @brief Products of the coefficient with all values of the high nibble of a byte.
+  alignas(16) std::uint8_t high[16];
+
+  /// @brief The 8x8 bit matrix of the multiplication of a byte by the coefficient, for GFNI.
+  std::uint64_t affine;
+
+  /// @brief The coefficient itself, for carry-less multiplications.
+  std::uint64_t coeff;
+
+  /// @brief The Barrett constant floor(x^2w / polynomial).
+  std::uint64_t mu;
+
+  /// @brief The field's polynomial.
+  std::uint64_t polynomial;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Multiply a region by a coefficient.
+/// @param c The coefficient, prepared with gf_region_prepare().
+/// @param src The region to multiply.
+/// @param dst Where to put the result.
+/// @param len The size of @p src and @p dst regions.
+/// @param add If true, add the result to @p dst rather than overwriting it.
+using gf_region_function
+  = void (*)(const gf_region_coefficient& c, const char* src, char* dst, std::size_t len, bool add);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Multiply several regions by coefficients and sum the results.
+///
+/// dst = c[0] * srcs[0] + ... + c[n-1] * srcs[n-1] (+ dst if @p add is true). A source region
+/// shorter than @p len contributes as if it were padded with zeros.
+/// @param c The coefficients, prepared with gf_region_prepare().
+/// @param srcs The regions to multiply.
+/// @param lens The size of each region of @p srcs.
+/// @param n The number of regions.
+/// @param dst Where to put the result.
+/// @param len The size of the @p dst region.
+/// @param add If true, add the result to @p dst rather than overwriting it.
+using gf_region_dot_function
+  = void (*)( const gf_region_coefficient* c, const char* const* srcs, const std::size_t* lens
+            , std::size_t n, char* dst, std::size_t len, bool add);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The kernels of an instruction set for a field size.
+struct gf_region_kernel
+{
+  /// @brief Multiply a region.
+  gf_region_function multiply;
+
+  /// @brief Multiply several regions and sum them in a single pass on the destination.
+  gf_region_dot_function dot_product;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A set of region kernels for an instruction set.
+///
+/// Null kernels mean that the instruction set doesn't provide a specialized implementation for
+/// the corresponding field size.
+struct gf_region_kernels
+{
+  /// @brief The name of the instruction set.
+  const char* name;
+
+  /// @brief Kernels for GF(2^4), two elements per byte.
+  gf_region_kernel w4;
+
+  /// @brief Kernels for GF(2^8).
+  gf_region_kernel w8;
+
+  /// @brief Kernels for GF(2^16), native-endian 16 bits words.
+  gf_region_kernel w16;
+
+  /// @brief Kernels for GF(2^32), native-endian 32 bits words.
+  gf_region_kernel w32;
+
+  /// @brief Get the kernels of a field size.
+  const gf_region_kernel&
+  get(unsigned int w)
+  const noexcept
+  {
+    return w == 4 ? w4 : w == 8 ? w8 : w == 16 ? w16 : w32;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Get all sets of kernels supported by the running CPU, best first.
+std::vector<gf_region_kernels>
+gf_region_available();
+
+/// @internal
+/// @brief Get the best kernel of each field size for the running CPU.
+///
+/// The selection is made once, on first call, by querying CPUID. A null kernel means that no
+/// specialized implementation exists and that gf-complete should be used.
+const gf_region_kernels&
+gf_region_selected();
+
+/// @internal
+/// @brief Compute the constants needed by kernels to multiply by @p coeff in GF(2^@p w).
+/// @note Fields use the same polynomials as gf-complete's defaults.
+void
+gf_region_prepare(gf_region_coefficient& c, unsigned int w, std::uint32_t coeff)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
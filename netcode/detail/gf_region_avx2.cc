@@ -0,0 +1,46 @@
+// Compiled with -mavx2.
+
+#include <immintrin.h>
+
+#include "netcode/detail/gf_region_impl.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief 256 bits vectors.
+struct v256
+{
+  using type = __m256i;
+  static constexpr std::size_t size = 32;
+
+  static type load(const char* p) {return _mm256_loadu_si256(reinterpret_cast<const type*>(p));}
+  static void store(char* p, type x) {_mm256_storeu_si256(reinterpret_cast<type*>(p), x);}
+  static type zero() {return _mm256_setzero_si256();}
+  static type set1_8(char x) {return _mm256_set1_epi8(x);}
+  static type table(const std::uint8_t* t)
+  {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));
+  }
+  static type xor_(type a, type b) {return _mm256_xor_si256(a, b);}
+  static type and_(type a, type b) {return _mm256_and_si256(a, b);}
+  static type srli_16(type x, int n) {return _mm256_srli_epi16(x, n);}
+  static type shuffle_8(type t, type i) {return _mm256_shuffle_epi8(t, i);}
+};
+
+constexpr std::size_t v256::size;
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+extern const gf_region_kernels gf_region_avx2;
+const gf_region_kernels gf_region_avx2
+  = {"avx2", kernel<v256, split_table>(), kernel<v256, split_table>()
+  , {nullptr, nullptr}, {nullptr, nullptr}};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
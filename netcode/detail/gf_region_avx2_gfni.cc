@@ -0,0 +1,54 @@
+// Compiled with -mavx2 -mgfni -mvpclmulqdq.
+
+#include <immintrin.h>
+
+#include "netcode/detail/gf_region_impl.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief 256 bits vectors, with GFNI and VPCLMULQDQ.
+struct v256
+{
+  using type = __m256i;
+  static constexpr std::size_t size = 32;
+
+  static type load(const char* p) {return _mm256_loadu_si256(reinterpret_cast<const type*>(p));}
+  static void store(char* p, type x) {_mm256_storeu_si256(reinterpret_cast<type*>(p), x);}
+  static type zero() {return _mm256_setzero_si256();}
+  static type set1_64(std::uint64_t x) {return _mm256_set1_epi64x(static_cast<long long>(x));}
+  static type table(const std::uint8_t* t)
+  {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));
+  }
+  static type xor_(type a, type b) {return _mm256_xor_si256(a, b);}
+  static type srli_32(type x, int n) {return _mm256_srli_epi32(x, n);}
+  static type srli_64(type x, int n) {return _mm256_srli_epi64(x, n);}
+  static type shuffle_8(type t, type i) {return _mm256_shuffle_epi8(t, i);}
+  static type unpacklo_16(type a, type b) {return _mm256_unpacklo_epi16(a, b);}
+  static type unpackhi_16(type a, type b) {return _mm256_unpackhi_epi16(a, b);}
+  static type unpacklo_32(type a, type b) {return _mm256_unpacklo_epi32(a, b);}
+  static type unpackhi_32(type a, type b) {return _mm256_unpackhi_epi32(a, b);}
+  static type unpacklo_64(type a, type b) {return _mm256_unpacklo_epi64(a, b);}
+  static type shuffle_32_0202(type x) {return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 0, 2, 0));}
+  template <int Imm> static type clmul(type a, type b) {return _mm256_clmulepi64_epi128(a, b, Imm);}
+  static type affine(type x, type m) {return _mm256_gf2p8affine_epi64_epi8(x, m, 0);}
+};
+
+constexpr std::size_t v256::size;
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+extern const gf_region_kernels gf_region_avx2_gfni;
+const gf_region_kernels gf_region_avx2_gfni
+  = {"avx2-gfni", kernel<v256, affine>(), kernel<v256, affine>()
+  , kernel<v256, clmul_w16>(), kernel<v256, clmul_w32>()};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
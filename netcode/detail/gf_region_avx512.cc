@@ -0,0 +1,52 @@
+// Compiled with -mavx512f -mavx512bw.
+
+// GCC 12 wrongly warns about uninitialized variables in its AVX-512 headers.
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC diagnostic ignored "-Wuninitialized"
+# pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <immintrin.h>
+
+#include "netcode/detail/gf_region_impl.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief 512 bits vectors.
+struct v512
+{
+  using type = __m512i;
+  static constexpr std::size_t size = 64;
+
+  static type load(const char* p) {return _mm512_loadu_si512(p);}
+  static void store(char* p, type x) {_mm512_storeu_si512(p, x);}
+  static type zero() {return _mm512_setzero_si512();}
+  static type set1_8(char x) {return _mm512_set1_epi8(x);}
+  static type table(const std::uint8_t* t)
+  {
+    return _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));
+  }
+  static type xor_(type a, type b) {return _mm512_xor_si512(a, b);}
+  static type and_(type a, type b) {return _mm512_and_si512(a, b);}
+  static type srli_16(type x, unsigned int n) {return _mm512_srli_epi16(x, n);}
+  static type shuffle_8(type t, type i) {return _mm512_shuffle_epi8(t, i);}
+};
+
+constexpr std::size_t v512::size;
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+extern const gf_region_kernels gf_region_avx512;
+const gf_region_kernels gf_region_avx512
+  = {"avx512", kernel<v512, split_table>(), kernel<v512, split_table>()
+  , {nullptr, nullptr}, {nullptr, nullptr}};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
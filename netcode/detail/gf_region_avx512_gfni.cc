@@ -0,0 +1,60 @@
+// Compiled with -mavx512f -mavx512bw -mgfni -mvpclmulqdq.
+
+// GCC 12 wrongly warns about uninitialized variables in its AVX-512 headers.
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC diagnostic ignored "-Wuninitialized"
+# pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <immintrin.h>
+
+#include "netcode/detail/gf_region_impl.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief 512 bits vectors, with GFNI and VPCLMULQDQ.
+struct v512
+{
+  using type = __m512i;
+  static constexpr std::size_t size = 64;
+
+  static type load(const char* p) {return _mm512_loadu_si512(p);}
+  static void store(char* p, type x) {_mm512_storeu_si512(p, x);}
+  static type zero() {return _mm512_setzero_si512();}
+  static type set1_64(std::uint64_t x) {return _mm512_set1_epi64(static_cast<long long>(x));}
+  static type table(const std::uint8_t* t)
+  {
+    return _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));
+  }
+  static type xor_(type a, type b) {return _mm512_xor_si512(a, b);}
+  static type srli_32(type x, unsigned int n) {return _mm512_srli_epi32(x, n);}
+  static type srli_64(type x, unsigned int n) {return _mm512_srli_epi64(x, n);}
+  static type shuffle_8(type t, type i) {return _mm512_shuffle_epi8(t, i);}
+  static type unpacklo_16(type a, type b) {return _mm512_unpacklo_epi16(a, b);}
+  static type unpackhi_16(type a, type b) {return _mm512_unpackhi_epi16(a, b);}
+  static type unpacklo_32(type a, type b) {return _mm512_unpacklo_epi32(a, b);}
+  static type unpackhi_32(type a, type b) {return _mm512_unpackhi_epi32(a, b);}
+  static type unpacklo_64(type a, type b) {return _mm512_unpacklo_epi64(a, b);}
+  static type shuffle_32_0202(type x) {return _mm512_shuffle_epi32(x, _MM_PERM_CACA);}
+  template <int Imm> static type clmul(type a, type b) {return _mm512_clmulepi64_epi128(a, b, Imm);}
+  static type affine(type x, type m) {return _mm512_gf2p8affine_epi64_epi8(x, m, 0);}
+};
+
+constexpr std::size_t v512::size;
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+extern const gf_region_kernels gf_region_avx512_gfni;
+const gf_region_kernels gf_region_avx512_gfni
+  = {"avx512-gfni", kernel<v512, affine>(), kernel<v512, affine>()
+  , kernel<v512, clmul_w16>(), kernel<v512, clmul_w32>()};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,436 @@
+#pragma once
+
+// This file is meant to be included by the translation units compiled for a specific instruction
+// set. Everything must stay in the unnamed namespace, otherwise the linker could pick a version of
+// an inline function that uses instructions unavailable on the running CPU.
+
+#include <cstddef> // size_t
+#include <cstdint>
+
+#include "netcode/detail/gf_region.hh"
+
+namespace ntc { namespace detail { namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A vector type V must provide the following operations on its native type V::type. Operations
+// which are not 'full-width' act independently on each 128 bits lane.
+//   size, load, store, zero, set1_8, set1_64, table (broadcast 16 bytes to all lanes), xor_, and_,
+//   srli_16, srli_32, srli_64, shuffle_8, unpacklo_16, unpackhi_16, unpacklo_32, unpackhi_32,
+//   unpacklo_64, shuffle_32_0202, clmul<imm>, affine.
+// Only the operations used by the kernels of an instruction set are needed.
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Apply a vector operation on a region.
+///
+/// The tail of the region which doesn't fill a vector goes through a zero-padded buffer.
+template <typename V, bool Add, typename Fn>
+inline void
+region_loop(const char* src, char* dst, std::size_t len, Fn&& fn)
+{
+  auto i = std::size_t{0};
+  for (; i + 2 * V::size <= len; i += 2 * V::size)
+  {
+    auto r0 = fn(V::load(src + i));
+    auto r1 = fn(V::load(src + i + V::size));
+    if (Add)
+    {
+      r0 = V::xor_(r0, V::load(dst + i));
+      r1 = V::xor_(r1, V::load(dst + i + V::size));
+    }
+    V::store(dst + i, r0);
+    V::store(dst + i + V::size, r1);
+  }
+  for (; i + V::size <= len; i += V::size)
+  {
+    auto r = fn(V::load(src + i));
+    if (Add)
+    {
+      r = V::xor_(r, V::load(dst + i));
+    }
+    V::store(dst + i, r);
+  }
+  if (i != len)
+  {
+    alignas(64) char in[V::size] = {};
+    alignas(64) char out[V::size] = {};
+    for (auto j = std::size_t{0}; i + j < len; ++j)
+    {
+      in[j] = src[i + j];
+      out[j] = dst[i + j];
+    }
+    auto r = fn(V::load(in));
+    if (Add)
+    {
+      r = V::xor_(r, V::load(out));
+    }
+    V::store(out, r);
+    for (auto j = std::size_t{0}; i + j < len; ++j)
+    {
+      dst[i + j] = out[j];
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Dispatch on the 'add' flag.
+template <typename V, typename Fn>
+inline void
+region_loop(const char* src, char* dst, std::size_t len, bool add, Fn&& fn)
+{
+  if (add)
+  {
+    region_loop<V, true>(src, dst, len, fn);
+  }
+  else
+  {
+    region_loop<V, false>(src, dst, len, fn);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Load a vector from a region of @p avail bytes, padded with zeros if it's too short.
+template <typename V>
+inline typename V::type
+load_partial(const char* src, std::size_t avail)
+{
+  if (avail >= V::size)
+  {
+    return V::load(src);
+  }
+  alignas(64) char in[V::size] = {};
+  for (auto j = std::size_t{0}; j < avail; ++j)
+  {
+    in[j] = src[j];
+  }
+  return V::load(in);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Store the first @p avail bytes of a vector.
+template <typename V>
+inline void
+store_partial(char* dst, std::size_t avail, typename V::type x)
+{
+  if (avail >= V::size)
+  {
+    V::store(dst, x);
+    return;
+  }
+  alignas(64) char out[V::size];
+  V::store(out, x);
+  for (auto j = std::size_t{0}; j < avail; ++j)
+  {
+    dst[j] = out[j];
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Multiply a region by a coefficient with an operation Op.
+///
+/// An operation is constructed from a first coefficient, then set() switches to another
+/// coefficient of the same field, and operator() multiplies a vector.
+template <typename V, typename Op>
+void
+multiply(const gf_region_coefficient& c, const char* src, char* dst, std::size_t len, bool add)
+{
+  const auto op = Op{c};
+  region_loop<V>(src, dst, len, add, [&](typename V::type x){return op(x);});
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Compute a tile of a dot product, when some regions may not cover it.
+template <typename V, typename Op, std::size_t Tile>
+__attribute__((noinline)) void
+dot_product_partial_tile( Op& op, const gf_region_coefficient* c, const char* const* srcs
+                        , const std::size_t* lens, std::size_t n, char* dst, std::size_t len
+                        , bool add, std::size_t offset)
+{
+  typename V::type acc[Tile];
+  for (auto k = std::size_t{0}; k < Tile; ++k)
+  {
+    const auto pos = offset + k * V::size;
+    acc[k] = add and pos < len ? load_partial<V>(dst + pos, len - pos) : V::zero();
+  }
+  for (auto i = std::size_t{0}; i < n; ++i)
+  {
+    op.set(c[i]);
+    for (auto k = std::size_t{0}; k < Tile; ++k)
+    {
+      const auto pos = offset + k * V::size;
+      if (pos < lens[i] and pos < len)
+      {
+        const auto avail = (lens[i] < len ? lens[i] : len) - pos;
+        acc[k] = V::xor_(acc[k], op(load_partial<V>(srcs[i] + pos, avail)));
+      }
+    }
+  }
+  for (auto k = std::size_t{0}; k < Tile; ++k)
+  {
+    const auto pos = offset + k * V::size;
+    if (pos < len)
+    {
+      store_partial<V>(dst + pos, len - pos, acc[k]);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Multiply several regions by coefficients and sum them with an operation Op.
+///
+/// The destination is processed by tiles of several cache lines. The results of a tile are
+/// accumulated in registers and written only once, after all sources have been added. Tiles
+/// not covered by all regions go through a slower path.
+template <typename V, typename Op>
+void
+dot_product( const gf_region_coefficient* c, const char* const* srcs, const std::size_t* lens
+           , std::size_t n, char* dst, std::size_t len, bool add)
+{
+  static constexpr auto tile = std::size_t{4};
+  static constexpr auto tile_size = tile * V::size;
+
+  auto covered = len;
+  for (auto i = std::size_t{0}; i < n; ++i)
+  {
+    covered = lens[i] < covered ? lens[i] : covered;
+  }
+
+  auto op = Op{c[0]};
+  auto offset = std::size_t{0};
+  for (; offset + tile_size <= covered; offset += tile_size)
+  {
+    auto acc0 = add ? V::load(dst + offset) : V::zero();
+    auto acc1 = add ? V::load(dst + offset + V::size) : V::zero();
+    auto acc2 = add ? V::load(dst + offset + 2 * V::size) : V::zero();
+    auto acc3 = add ? V::load(dst + offset + 3 * V::size) : V::zero();
+    for (auto i = std::size_t{0}; i < n; ++i)
+    {
+      op.set(c[i]);
+      const auto src = srcs[i] + offset;
+      acc0 = V::xor_(acc0, op(V::load(src)));
+      acc1 = V::xor_(acc1, op(V::load(src + V::size)));
+      acc2 = V::xor_(acc2, op(V::load(src + 2 * V::size)));
+      acc3 = V::xor_(acc3, op(V::load(src + 3 * V::size)));
+    }
+    V::store(dst + offset, acc0);
+    V::store(dst + offset + V::size, acc1);
+    V::store(dst + offset + 2 * V::size, acc2);
+    V::store(dst + offset + 3 * V::size, acc3);
+  }
+  for (; offset < len; offset += tile_size)
+  {
+    dot_product_partial_tile<V, Op, tile>(op, c, srcs, lens, n, dst, len, add, offset);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Split tables multiplication in GF(2^4) and GF(2^8).
+///
+/// Each byte is looked up by nibbles in two 16 entries tables, which handles both field sizes.
+template <typename V>
+struct split_table
+{
+  using type = typename V::type;
+
+  type low;
+  type high;
+  type mask;
+
+  explicit split_table(const gf_region_coefficient& c)
+    : low(V::table(c.low)), high(V::table(c.high)), mask(V::set1_8(0x0f))
+  {}
+
+  void
+  set(const gf_region_coefficient& c)
+  {
+    low = V::table(c.low);
+    high = V::table(c.high);
+  }
+
+  type
+  operator()(type x)
+  const
+  {
+    const auto l = V::shuffle_8(low, V::and_(x, mask));
+    const auto h = V::shuffle_8(high, V::and_(V::srli_16(x, 4), mask));
+    return V::xor_(l, h);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Affine transformation multiplication in GF(2^4) and GF(2^8).
+///
+/// Multiplication by a constant is linear over GF(2), thus it's a bit matrix multiplication.
+/// GF2P8MULB can't be used, as it's hardwired to the AES polynomial.
+template <typename V>
+struct affine
+{
+  using type = typename V::type;
+
+  type matrix;
+
+  explicit affine(const gf_region_coefficient& c)
+    : matrix(V::set1_64(c.affine))
+  {}
+
+  void
+  set(const gf_region_coefficient& c)
+  {
+    matrix = V::set1_64(c.affine);
+  }
+
+  type
+  operator()(type x)
+  const
+  {
+    return V::affine(x, matrix);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Carry-less multiply each 64 bits half of lanes of @p a by the low half of @p b.
+template <typename V>
+inline typename V::type
+clmul_halves(typename V::type a, typename V::type b)
+{
+  return V::unpacklo_64(V::template clmul<0x00>(a, b), V::template clmul<0x01>(a, b));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Barrett reduction of products held in slots of 2w bits.
+template <typename V, unsigned int W>
+inline typename V::type
+reduce(typename V::type product, typename V::type mu, typename V::type polynomial)
+{
+  const auto high = W == 16 ? V::srli_32(product, 16) : V::srli_64(product, 32);
+  const auto t = clmul_halves<V>(high, mu);
+  const auto quotient = W == 16 ? V::srli_32(t, 16) : V::srli_64(t, 32);
+  // Bits above w are garbage, they are discarded when packing the results.
+  return V::xor_(product, clmul_halves<V>(quotient, polynomial));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Carry-less multiplication in GF(2^16).
+///
+/// Words are spread in 32 bits slots, two per 64 bits half, which can hold a full product.
+template <typename V>
+struct clmul_w16
+{
+  using type = typename V::type;
+
+  type coeff;
+  type mu;
+  type polynomial;
+  type zero;
+  type pack_low;
+  type pack_high;
+
+  explicit clmul_w16(const gf_region_coefficient& c)
+    : coeff(V::set1_64(c.coeff)), mu(V::set1_64(c.mu)), polynomial(V::set1_64(c.polynomial))
+    , zero(V::zero())
+    , pack_low(V::table(pack_bytes))
+    , pack_high(V::table(pack_bytes + 8))
+  {}
+
+  void
+  set(const gf_region_coefficient& c)
+  {
+    coeff = V::set1_64(c.coeff);
+  }
+
+  type
+  operator()(type x)
+  const
+  {
+    const auto low = clmul_halves<V>(V::unpacklo_16(x, zero), coeff);
+    const auto high = clmul_halves<V>(V::unpackhi_16(x, zero), coeff);
+    return V::xor_( V::shuffle_8(reduce<V, 16>(low, mu, polynomial), pack_low)
+                  , V::shuffle_8(reduce<V, 16>(high, mu, polynomial), pack_high));
+  }
+
+  // Gather the low 16 bits of each 32 bits slot, in the low half of a lane with the first 16
+  // bytes, in the high half with the last 16 bytes.
+  static constexpr std::uint8_t pack_bytes[24]
+    = { 0, 1, 4, 5, 8, 9, 12, 13, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+      , 0, 1, 4, 5, 8, 9, 12, 13};
+};
+
+template <typename V>
+constexpr std::uint8_t clmul_w16<V>::pack_bytes[24];
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Carry-less multiplication in GF(2^32).
+///
+/// Words are spread in 64 bits slots, which can hold a full product.
+template <typename V>
+struct clmul_w32
+{
+  using type = typename V::type;
+
+  type coeff;
+  type mu;
+  type polynomial;
+  type zero;
+
+  explicit clmul_w32(const gf_region_coefficient& c)
+    : coeff(V::set1_64(c.coeff)), mu(V::set1_64(c.mu)), polynomial(V::set1_64(c.polynomial))
+    , zero(V::zero())
+  {}
+
+  void
+  set(const gf_region_coefficient& c)
+  {
+    coeff = V::set1_64(c.coeff);
+  }
+
+  type
+  operator()(type x)
+  const
+  {
+    const auto low = clmul_halves<V>(V::unpacklo_32(x, zero), coeff);
+    const auto high = clmul_halves<V>(V::unpackhi_32(x, zero), coeff);
+    return V::unpacklo_64( V::shuffle_32_0202(reduce<V, 32>(low, mu, polynomial))
+                         , V::shuffle_32_0202(reduce<V, 32>(high, mu, polynomial)));
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The kernels of an operation.
+template <typename V, template <typename> class Op>
+constexpr gf_region_kernel
+kernel()
+{
+  return {&multiply<V, Op<V>>, &dot_product<V, Op<V>>};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}}} // namespace ntc::detail::unnamed
@@ -0,0 +1,53 @@
+// Compiled with -mssse3 -mpclmul.
+
+#include <immintrin.h>
+
+#include "netcode/detail/gf_region_impl.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief 128 bits vectors.
+struct v128
+{
+  using type = __m128i;
+  static constexpr std::size_t size = 16;
+
+  static type load(const char* p) {return _mm_loadu_si128(reinterpret_cast<const type*>(p));}
+  static void store(char* p, type x) {_mm_storeu_si128(reinterpret_cast<type*>(p), x);}
+  static type zero() {return _mm_setzero_si128();}
+  static type set1_8(char x) {return _mm_set1_epi8(x);}
+  static type set1_64(std::uint64_t x) {return _mm_set1_epi64x(static_cast<long long>(x));}
+  static type table(const std::uint8_t* t) {return _mm_loadu_si128(reinterpret_cast<const type*>(t));}
+  static type xor_(type a, type b) {return _mm_xor_si128(a, b);}
+  static type and_(type a, type b) {return _mm_and_si128(a, b);}
+  static type srli_16(type x, int n) {return _mm_srli_epi16(x, n);}
+  static type srli_32(type x, int n) {return _mm_srli_epi32(x, n);}
+  static type srli_64(type x, int n) {return _mm_srli_epi64(x, n);}
+  static type shuffle_8(type t, type i) {return _mm_shuffle_epi8(t, i);}
+  static type unpacklo_16(type a, type b) {return _mm_unpacklo_epi16(a, b);}
+  static type unpackhi_16(type a, type b) {return _mm_unpackhi_epi16(a, b);}
+  static type unpacklo_32(type a, type b) {return _mm_unpacklo_epi32(a, b);}
+  static type unpackhi_32(type a, type b) {return _mm_unpackhi_epi32(a, b);}
+  static type unpacklo_64(type a, type b) {return _mm_unpacklo_epi64(a, b);}
+  static type shuffle_32_0202(type x) {return _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 0, 2, 0));}
+  template <int Imm> static type clmul(type a, type b) {return _mm_clmulepi64_si128(a, b, Imm);}
+};
+
+constexpr std::size_t v128::size;
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+extern const gf_region_kernels gf_region_ssse3;
+const gf_region_kernels gf_region_ssse3
+  = {"ssse3", kernel<v128, split_table>(), kernel<v128, split_table>()
+  , kernel<v128, clmul_w16>(), kernel<v128, clmul_w32>()};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
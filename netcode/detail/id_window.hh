@@ -0,0 +1,469 @@
+#pragma once
+
+#include <algorithm> // max, min
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits> // numeric_limits
+#include <utility> // move
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A map from identifiers to values, for identifiers which are dense and mostly increasing.
+///
+/// Values are stored in a ring of slots indexed by identifier, a bitmap tells which slots hold a
+/// value. All identifiers are within [first, first + capacity), thus looking for a value is a bit
+/// test. Scans, like iterating on values or dropping all values below an identifier, skip 64 empty
+/// slots at once.
+///
+/// As the capacity follows the span of identifiers rather than the number of values, this span is
+/// bounded by max_span(). Users check with fits() that a new identifier keeps the span bounded.
+/// @attention Adding a value might move the other ones and invalidates iterators.
+template <typename T>
+class id_window final
+{
+public:
+
+  /// @brief An iterator on values, sorted by identifier.
+  template <typename Window, typename Value>
+  class basic_iterator final
+  {
+  public:
+
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    /// @brief Constructor.
+    basic_iterator(Window& w, std::uint32_t id)
+    noexcept
+      : m_w{&w}
+      , m_id{id}
+    {}
+
+    /// @brief Get the identifier of the current value.
+    std::uint32_t
+    id()
+    const noexcept
+    {
+      return m_id;
+    }
+
+    reference
+    operator*()
+    const noexcept
+    {
+      return *m_w->find(m_id);
+    }
+
+    pointer
+    operator->()
+    const noexcept
+    {
+      return m_w->find(m_id);
+    }
+
+    /// @note The current value can be erased before the iterator is incremented.
+    basic_iterator&
+    operator++()
+    noexcept
+    {
+      m_id = m_w->next(m_id + 1);
+      return *this;
+    }
+
+    basic_iterator
+    operator++(int)
+    noexcept
+    {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend
+    bool
+    operator==(const basic_iterator& lhs, const basic_iterator& rhs)
+    noexcept
+    {
+      return lhs.m_id == rhs.m_id;
+    }
+
+    friend
+    bool
+    operator!=(const basic_iterator& lhs, const basic_iterator& rhs)
+    noexcept
+    {
+      return lhs.m_id != rhs.m_id;
+    }
+
+  private:
+
+    /// @brief The iterated window.
+    Window* m_w;
+
+    /// @brief The identifier of the current value.
+    std::uint32_t m_id;
+  };
+
+  /// @brief An iterator on values.
+  using iterator = basic_iterator<id_window, T>;
+
+  /// @brief A const iterator on values.
+  using const_iterator = basic_iterator<const id_window, const T>;
+
+public:
+
+  /// @brief The default maximal span of identifiers of the values.
+  static constexpr std::uint32_t default_max_span = 1u << 16;
+
+public:
+
+  /// @brief Constructor.
+  id_window()
+    : m_values(min_capacity)
+    , m_bits(min_capacity / 64, 0)
+    , m_first{0}
+    , m_last{0}
+    , m_size{0}
+    , m_max_span{default_max_span}
+  {}
+
+  /// @brief Set the maximal span of identifiers of the values.
+  /// @note Only checked by fits(), current values are kept.
+  void
+  set_max_span(std::uint32_t span)
+  noexcept
+  {
+    assert(span != 0 && "Empty span");
+    m_max_span = span;
+  }
+
+  /// @brief Get the maximal span of identifiers of the values.
+  std::uint32_t
+  max_span()
+  const noexcept
+  {
+    return m_max_span;
+  }
+
+  /// @brief Tell if there is a value for @p id.
+  std::size_t
+  count(std::uint32_t id)
+  const noexcept
+  {
+    return in_range(id) and test(index(id)) ? 1 : 0;
+  }
+
+  /// @brief Tell if there is a value for each identifier of [first, last).
+  ///
+  /// Slots are tested 64 at a time.
+  bool
+  contains(std::uint32_t first, std::uint32_t last)
+  const noexcept
+  {
+    if (first >= last)
+    {
+      return true;
+    }
+    if (first < m_first or last > m_last)
+    {
+      return false;
+    }
+    while (first != last)
+    {
+      // The capacity is a multiple of 64, thus a word never wraps around the ring.
+      const auto idx = index(first);
+      const auto offset = idx % 64;
+      const auto nb = std::min(static_cast<std::uint32_t>(64 - offset), last - first);
+      const auto mask = nb == 64 ? ~std::uint64_t{0} : ((std::uint64_t{1} << nb) - 1) << offset;
+      if ((m_bits[idx / 64] & mask) != mask)
+      {
+        return false;
+      }
+      first += nb;
+    }
+    return true;
+  }
+
+  /// @brief Tell if a value for @p id can be added without exceeding max_span().
+  /// @note The greatest identifier can't be represented.
+  bool
+  fits(std::uint32_t id)
+  const noexcept
+  {
+    if (id == std::numeric_limits<std::uint32_t>::max())
+    {
+      return false;
+    }
+    if (m_size == 0)
+    {
+      return true;
+    }
+    return id < m_first ? m_last - id <= m_max_span : id + 1 - m_first <= m_max_span;
+  }
+
+  /// @brief Get the value of @p id, nullptr if there is none.
+  T*
+  find(std::uint32_t id)
+  noexcept
+  {
+    return count(id) ? m_values[index(id)].get_ptr() : nullptr;
+  }
+
+  /// @brief Get the value of @p id, nullptr if there is none.
+  const T*
+  find(std::uint32_t id)
+  const noexcept
+  {
+    return count(id) ? m_values[index(id)].get_ptr() : nullptr;
+  }
+
+  /// @brief Add a value for @p id.
+  /// @pre There is no value for @p id.
+  /// @pre fits(id)
+  /// @return A reference to the added value.
+  T&
+  emplace(std::uint32_t id, T&& value)
+  {
+    assert(not count(id) && "Identifier already present");
+    assert(fits(id) && "Span of identifiers too large");
+
+    if (m_size == 0)
+    {
+      m_first = id;
+      m_last = id + 1;
+    }
+    else
+    {
+      const auto first = std::min(m_first, id);
+      const auto last = std::max(m_last, id + 1);
+      if (last - first > m_values.size())
+      {
+        grow(last - first);
+      }
+      m_first = first;
+      m_last = last;
+    }
+
+    const auto idx = index(id);
+    m_values[idx] = std::move(value);
+    m_bits[idx / 64] |= std::uint64_t{1} << (idx % 64);
+    ++m_size;
+    return *m_values[idx];
+  }
+
+  /// @brief Remove the value of @p id, if any.
+  void
+  erase(std::uint32_t id)
+  noexcept
+  {
+    if (not count(id))
+    {
+      return;
+    }
+    reset(index(id));
+    if (id == m_first)
+    {
+      m_first = next(id);
+    }
+  }
+
+  /// @brief Remove all values with an identifier strictly smaller than @p id.
+  void
+  erase_before(std::uint32_t id)
+  noexcept
+  {
+    for (auto cur = next(m_first); cur < id and cur != m_last; cur = next(cur + 1))
+    {
+      reset(index(cur));
+    }
+    if (m_first < id)
+    {
+      m_first = next(std::min(id, m_last));
+    }
+  }
+
+  /// @brief Remove all values.
+  void
+  clear()
+  noexcept
+  {
+    erase_before(m_last);
+  }
+
+  /// @brief The number of values.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Tell if there is no value.
+  bool
+  empty()
+  const noexcept
+  {
+    return m_size == 0;
+  }
+
+  /// @brief Get the identifier which follows the greatest one ever added since the window was
+  /// last empty.
+  /// @pre not empty()
+  std::uint32_t
+  end_id()
+  const noexcept
+  {
+    assert(m_size != 0 && "Empty window");
+    return m_last;
+  }
+
+  /// @brief Get an iterator to the value with the smallest identifier.
+  iterator
+  begin()
+  noexcept
+  {
+    return {*this, next(m_first)};
+  }
+
+  /// @brief Get an iterator to the end of values.
+  iterator
+  end()
+  noexcept
+  {
+    return {*this, m_last};
+  }
+
+  /// @brief Get an iterator to the value with the smallest identifier.
+  const_iterator
+  begin()
+  const noexcept
+  {
+    return {*this, next(m_first)};
+  }
+
+  /// @brief Get an iterator to the end of values.
+  const_iterator
+  end()
+  const noexcept
+  {
+    return {*this, m_last};
+  }
+
+private:
+
+  /// @brief Tell if @p id is in the range covered by the ring.
+  bool
+  in_range(std::uint32_t id)
+  const noexcept
+  {
+    return id >= m_first and id < m_last;
+  }
+
+  /// @brief Get the slot of an identifier.
+  std::size_t
+  index(std::uint32_t id)
+  const noexcept
+  {
+    // The capacity is a power of 2.
+    return id & (m_values.size() - 1);
+  }
+
+  /// @brief Tell if a slot holds a value.
+  bool
+  test(std::size_t idx)
+  const noexcept
+  {
+    return (m_bits[idx / 64] >> (idx % 64)) & 1;
+  }
+
+  /// @brief Destroy the value of a slot.
+  void
+  reset(std::size_t idx)
+  noexcept
+  {
+    m_values[idx] = boost::none;
+    m_bits[idx / 64] &= ~(std::uint64_t{1} << (idx % 64));
+    --m_size;
+  }
+
+  /// @brief Get the smallest identifier greater or equal to @p id which has a value, or the end
+  /// of the range.
+  std::uint32_t
+  next(std::uint32_t id)
+  const noexcept
+  {
+    id = std::max(id, m_first);
+    while (id < m_last)
+    {
+      // The capacity is a multiple of 64, thus a word never wraps around the ring.
+      const auto idx = index(id);
+      const auto word = m_bits[idx / 64] >> (idx % 64);
+      if (word != 0)
+      {
+        const auto res = id + static_cast<std::uint32_t>(__builtin_ctzll(word));
+        return res < m_last ? res : m_last;
+      }
+      id += static_cast<std::uint32_t>(64 - idx % 64);
+    }
+    return m_last;
+  }
+
+  /// @brief Move all values to a ring of at least @p nb slots.
+  void
+  grow(std::size_t nb)
+  {
+    auto capacity = m_values.size();
+    while (capacity < nb)
+    {
+      capacity *= 2;
+    }
+
+    auto values = std::vector<boost::optional<T>>(capacity);
+    auto bits = std::vector<std::uint64_t>(capacity / 64, 0);
+    for (auto id = next(m_first); id != m_last; id = next(id + 1))
+    {
+      const auto idx = id & (capacity - 1);
+      values[idx] = std::move(m_values[index(id)]);
+      bits[idx / 64] |= std::uint64_t{1} << (idx % 64);
+    }
+    m_values.swap(values);
+    m_bits.swap(bits);
+  }
+
+private:
+
+  /// @brief The initial number of slots, a multiple of 64.
+  static constexpr std::size_t min_capacity = 64;
+
+  /// @brief The values, indexed by identifier.
+  std::vector<boost::optional<T>> m_values;
+
+  /// @brief Tell which slots hold a value.
+  std::vector<std::uint64_t> m_bits;
+
+  /// @brief No value has an identifier smaller than this one.
+  std::uint32_t m_first;
+
+  /// @brief No value has an identifier greater or equal to this one.
+  std::uint32_t m_last;
+
+  /// @brief The number of values.
+  std::size_t m_size;
+
+  /// @brief The maximal span of identifiers of the values.
+  std::uint32_t m_max_span;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,144 @@
+#include <algorithm> // copy
+#include <cassert>
+
+#include "netcode/detail/incremental_encoder.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+incremental_encoder::incremental_encoder( std::uint8_t galois_field_size
+                                        , std::size_t nb_accumulators)
+  : m_gf{galois_field_size}
+  , m_accumulators()
+{
+  reset(nb_accumulators);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+incremental_encoder::reset(std::size_t nb_accumulators)
+{
+  m_accumulators.resize(nb_accumulators);
+  for (auto& acc : m_accumulators)
+  {
+    acc.built = false;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+incremental_encoder::nb_accumulators()
+const noexcept
+{
+  return m_accumulators.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+incremental_encoder::add(const encoder_source& src)
+{
+  fold(src);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+incremental_encoder::remove(const encoder_source& src)
+{
+  // Addition and subtraction are the same operation in GF(2^w).
+  fold(src);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+incremental_encoder::operator()( encoder_repair& repair, const source_list& sources
+                               , bool allow_keyed)
+{
+  assert(sources.size() && "Empty source list");
+  assert(not m_accumulators.empty() && "No accumulators");
+
+  auto& acc = m_accumulators[repair.id() % m_accumulators.size()];
+
+  // A new key is needed when the last repair copied from this accumulator still shares sources
+  // with the window, as both repairs would have the same coefficients for these sources.
+  if ( not acc.built
+    or (acc.emitted and sources.cbegin()->id() <= acc.last_emitted)
+    or (not allow_keyed and acc.key != repair.id()))
+  {
+    rebuild(acc, repair.id(), sources);
+  }
+
+  // The decoder needs to know the key to find the coefficients.
+  repair.coefficient_id() = acc.key;
+  repair.keyed() = acc.key != repair.id();
+
+  // The repair encodes all sources of the window.
+  for (auto cit = sources.cbegin(), end = sources.cend(); cit != end; ++cit)
+  {
+    repair.source_ids().insert(repair.source_ids().end(), cit->id());
+    acc.last_emitted = cit->id();
+  }
+  acc.emitted = true;
+
+  repair.symbol().resize(acc.symbol.size());
+  std::copy(acc.symbol.begin(), acc.symbol.end(), repair.symbol().begin());
+  repair.encoded_size() = acc.encoded_size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+incremental_encoder::fold(const encoder_source& src)
+{
+  for (auto& acc : m_accumulators)
+  {
+    if (acc.built)
+    {
+      fold(acc, src);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+incremental_encoder::fold(accumulator& acc, const encoder_source& src)
+{
+  // The accumulator might be too small for the current source.
+  if (src.size() > acc.symbol.size())
+  {
+    acc.symbol.resize(src.size());
+  }
+
+  const auto c = m_gf.coefficient(acc.key, src.id());
+  m_gf.multiply_add(src.symbol(), acc.symbol.data(), src.size(), c);
+
+  // Cast is necessary to inhibit conversion warning as xor implicitly convert to a signed value.
+  acc.encoded_size
+    = static_cast<std::uint16_t>(m_gf.multiply_size(src.size(), c) ^ acc.encoded_size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+incremental_encoder::rebuild(accumulator& acc, std::uint32_t key, const source_list& sources)
+{
+  acc.symbol.clear();
+  acc.encoded_size = 0;
+  acc.key = key;
+  for (auto cit = sources.cbegin(), end = sources.cend(); cit != end; ++cit)
+  {
+    fold(acc, *cit);
+  }
+  acc.built = true;
+  acc.emitted = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
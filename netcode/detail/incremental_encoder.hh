@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+
+#include "netcode/detail/buffer.hh"
+#include "netcode/detail/galois_field.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source.hh"
+#include "netcode/detail/source_list.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The component responsible for the incremental encoding of detail::repair.
+///
+/// Instead of encoding the whole window each time a repair is needed, it keeps a fixed number of
+/// running linear combinations (accumulators) of all the sources of the window. A source is folded
+/// in every accumulator once, when it's added, and subtracted once, when it leaves the window.
+///
+/// Each accumulator combines sources with the coefficients of a repair identifier, its key, which
+/// repairs copied from it carry as their coefficient identifier. Two repairs with the same key
+/// which share sources can't rebuild more than one of them. Thus, once an accumulator has been
+/// emitted, it's only copied again after the window has slid past all the sources it encoded;
+/// otherwise, it's rebuilt from the window, keyed by the new repair's identifier. A repair then
+/// costs the copy of a symbol when repairs are sent less often than the window slides by, and the
+/// encoding of the window otherwise.
+class incremental_encoder final
+{
+public:
+
+  /// @brief Constructor.
+  incremental_encoder(std::uint8_t galois_field_size, std::size_t nb_accumulators);
+
+  /// @brief Change the number of accumulators.
+  /// @note Accumulators are rebuilt from the window the next time a repair is generated.
+  void
+  reset(std::size_t nb_accumulators);
+
+  /// @brief Get the number of accumulators.
+  std::size_t
+  nb_accumulators()
+  const noexcept;
+
+  /// @brief Fold a source that has just entered the window in all accumulators.
+  void
+  add(const encoder_source& src);
+
+  /// @brief Subtract a source that is leaving the window from all accumulators.
+  void
+  remove(const encoder_source& src);
+
+  /// @brief Fill a @ref detail::repair from the accumulators.
+  /// @param repair The repair to fill. Its identifier selects the accumulator.
+  /// @param sources The current window; all its sources shall have been given to add().
+  /// @param allow_keyed Tell if the repair can carry another key than its identifier, i.e. if the
+  /// decoder understands keyed repairs; otherwise, the accumulator is rebuilt.
+  void
+  operator()(encoder_repair& repair, const source_list& sources, bool allow_keyed = true);
+
+private:
+
+  /// @brief A running linear combination of sources.
+  struct accumulator
+  {
+    /// @brief The combined symbols.
+    zero_byte_buffer symbol;
+
+    /// @brief The combined sizes.
+    std::uint16_t encoded_size;
+
+    /// @brief The identifier used to generate the coefficients of the combined sources.
+    std::uint32_t key;
+
+    /// @brief Tell if this accumulator reflects the current window.
+    bool built;
+
+    /// @brief Tell if a repair was copied from this accumulator since it was built.
+    bool emitted;
+
+    /// @brief The identifier of the most recent source encoded by the last copied repair.
+    std::uint32_t last_emitted;
+  };
+
+  /// @brief Add or subtract a source to all built accumulators.
+  void
+  fold(const encoder_source& src);
+
+  /// @brief Add or subtract a source to an accumulator.
+  void
+  fold(accumulator& acc, const encoder_source& src);
+
+  /// @brief Rebuild an accumulator from a window, with a new key.
+  void
+  rebuild(accumulator& acc, std::uint32_t key, const source_list& sources);
+
+private:
+
+  /// @brief The implementation of a Galois field.
+  galois_field m_gf;
+
+  /// @brief The running combinations.
+  std::vector<accumulator> m_accumulators;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -1,3 +1,4 @@
+#include <algorithm> // swap_ranges
 #include <cassert>
 
 #include "netcode/detail/invert_matrix.hh"
@@ -23,6 +24,9 @@ noexcept
     }
   }
 
+  // Rows are stored in contiguous memory, thus they are scaled and added with region kernels.
+  const auto row = [cols](square_matrix& m, std::size_t i){return &m[i * cols];};
+
   // Convert into upper triangular
   for (auto i = 0ul; i < cols; ++i)
   {
@@ -43,29 +47,17 @@ noexcept
         return {j - 1};
       }
 
-      const auto row_start2 = j * cols;
-      for (auto k = 0ul; k < cols; ++k)
-      {
-        auto tmp = mat[row_start + k];
-        mat[row_start + k] = mat[row_start2 + k];
-        mat[row_start2 + k] = tmp;
-
-        tmp = inv[row_start + k];
-        inv[row_start + k] = inv[row_start2 + k];
-        inv[row_start2 + k] = tmp;
-      }
+      std::swap_ranges(row(mat, i), row(mat, i) + cols, row(mat, j));
+      std::swap_ranges(row(inv, i), row(inv, i) + cols, row(inv, j));
     }
- 
-    // Multiply the row by 1/element i,i
+
+    // Multiply the row by 1/element i,i. Elements before i are already 0.
     const auto tmp = mat[row_start + i];
     if (tmp != 1)
     {
       const auto inverse = gf.invert(tmp);
-      for (auto j = 0ul; j < cols; j++)
-      {
-        mat[row_start + j] = gf.multiply(mat[row_start + j], inverse);
-        inv[row_start + j] = gf.multiply(inv[row_start + j], inverse);
-      }
+      gf.multiply_row(row(mat, i) + i, row(mat, i) + i, cols - i, inverse);
+      gf.multiply_row(row(inv, i), row(inv, i), cols, inverse);
     }
 
     // Now for each j > i, add A_ji * Ai to Aj
@@ -78,21 +70,20 @@ noexcept
         if (mat[k] == 1)
         {
           const auto row_start2 = cols * j;
-          for (auto x = 0ul; x < cols; ++x)
+          for (auto x = i; x < cols; ++x)
           {
             mat[row_start2 + x] ^= mat[row_start + x];
+          }
+          for (auto x = 0ul; x < cols; ++x)
+          {
             inv[row_start2 + x] ^= inv[row_start + x];
           }
         }
         else
         {
           const auto mat_k = mat[k];
-          const auto rs2 = cols * j;
-          for (auto x = 0ul; x < cols; ++x)
-          {
-            mat[rs2 + x] ^= gf.multiply(mat_k, mat[row_start + x]);
-            inv[rs2 + x] ^= gf.multiply(mat_k, inv[row_start + x]);
-          }
+          gf.multiply_add_row(row(mat, i) + i, row(mat, j) + i, cols - i, mat_k);
+          gf.multiply_add_row(row(inv, i), row(inv, j), cols, mat_k);
         }
       }
     }
@@ -101,7 +92,6 @@ noexcept
   // Now the matrix is upper triangular. Start at the top and multiply down.
   for (auto i = rows - 1; ; --i)
   {
-    auto row_start = i * cols;
     for (auto j = 0ul; j < i; ++j)
     {
       const auto rs2 = j * cols;
@@ -109,10 +99,7 @@ noexcept
       {
         const auto tmp = mat[rs2+i];
         mat[rs2 + i] = 0;
-        for (auto k = 0ul; k < cols; ++k)
-        {
-          inv[rs2 + k] ^= gf.multiply(tmp, inv[row_start + k]);
-        }
+        gf.multiply_add_row(row(inv, i), row(inv, j), cols, tmp);
       }
     }
 
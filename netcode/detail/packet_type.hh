@@ -2,23 +2,97 @@
 
 #include "netcode/errors.hh"
 #include "netcode/packet.hh"
+#include "netcode/wire_version.hh"
 
 namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
 /// @brief Describe possible packet types.
-enum class packet_type : std::uint8_t {ack = 0, repair = 1, source = 2};
+///
+/// A keyed_repair is a repair whose coefficients were not generated from its own identifier, but
+/// from an identifier it carries (see encoder::set_nb_accumulators).
+enum class packet_type : std::uint8_t {ack = 0, repair = 1, source = 2, keyed_repair = 3};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The bit of the first byte which marks the repairs sent at the end of a block, from v5.
+///
+/// No later repair encodes the sources of such a repair.
+static constexpr std::uint8_t block_end_mark = 0x08;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Get the version of the wire format of a raw packet by looking at its first byte.
+///
+/// The 4 upper bits of the first byte hold the version minus one, thus v1 packets are unchanged.
+/// Only repairs and cumulative acks are marked, as other packets are the same in all versions.
+/// @throw packet_type_error if the version is unknown.
+inline
+wire_version
+get_wire_version(const packet& p)
+{
+  const auto version = *reinterpret_cast<const std::uint8_t*>(p.data()) >> 4;
+  switch (version)
+  {
+    case 0:
+      return wire_version::v1;
+
+    case 1:
+      return wire_version::v2;
+
+    case 2:
+      return wire_version::v3;
+
+    case 3:
+      return wire_version::v4;
+
+    case 4:
+      return wire_version::v5;
+
+    default:
+      throw packet_type_error{p};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Mark the first byte of a packet with a version of the wire format.
+inline
+std::uint8_t
+mark_wire_version(packet_type ty, wire_version version)
+noexcept
+{
+  return static_cast<std::uint8_t>( static_cast<std::uint8_t>(ty)
+                                  | ((static_cast<std::uint8_t>(version) - 1) << 4));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell if a raw repair is one of the repairs sent at the end of a block.
+inline
+bool
+ends_block(const packet& p)
+noexcept
+{
+  return (*reinterpret_cast<const std::uint8_t*>(p.data()) & block_end_mark) != 0;
+}
 
 /*------------------------------------------------------------------------------------------------*/
 
 /// @brief Get the type of a raw packet by looking at its first byte.
-/// @throw packet_type_error if the type could not have been read.
+/// @throw packet_type_error if the type or the wire format version could not have been read.
 inline
 packet_type
 get_packet_type(const packet& p)
 {
-  const auto ty = *reinterpret_cast<const std::uint8_t*>(p.data());
+  const auto version = get_wire_version(p);
+  const auto ty = *reinterpret_cast<const std::uint8_t*>(p.data()) & 0x07;
+  if (ends_block(p) and (version < wire_version::v5 or (ty != 1 and ty != 3)))
+  {
+    // Only repairs can end a block.
+    throw packet_type_error{p};
+  }
   switch (ty)
   {
     case 0:
@@ -30,6 +104,9 @@ get_packet_type(const packet& p)
     case 2:
       return packet_type::source;
 
+    case 3:
+      return packet_type::keyed_repair;
+
     default:
       throw packet_type_error{p};
   }
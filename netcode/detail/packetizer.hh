@@ -1,14 +1,16 @@
 #pragma once
 
-#include <algorithm> // copy_n
+#include <algorithm> // copy_n, min
 #include <cassert>
 #include <iterator>  // back_inserter
 #include <limits>
-#include <numeric>   // adjacent_difference, partial_sum
-#include <utility>   // declval, pair
+#include <numeric>   // adjacent_difference
+#include <type_traits>
+#include <utility>   // pair
 #include <vector>
 
 #include <boost/endian/conversion.hpp>
+#include <boost/optional.hpp>
 
 #include "netcode/detail/ack.hh"
 #include "netcode/detail/buffer.hh"
@@ -16,6 +18,7 @@
 #include "netcode/detail/source.hh"
 #include "netcode/detail/source_id_list.hh"
 #include "netcode/detail/repair.hh"
+#include "netcode/detail/traits.hh"
 #include "netcode/errors.hh"
 
 namespace ntc { namespace detail {
@@ -31,6 +34,15 @@ namespace ntc { namespace detail {
 /// is, in combination with @ref packet, to have the symbol aligned on a 16-bytes boundary directly
 /// when received from the network by putting a fixed-size padding in @ref packet in front of the
 /// symbol.
+///
+/// A packet is first described as a list of segments: small fields are serialized in a scratch
+/// buffer, while symbols are referenced in place. It's then given to the user's handler, depending
+/// on the concept it models:
+/// - @code handler(iov, iovcnt) @endcode, called once with the whole packet as an array of iovec
+///   (see is_gather_packet_handler);
+/// - @code char* buf = handler(len) @endcode, then @code handler() @endcode once the packet has
+///   been serialized in @p buf (see is_buffer_packet_handler);
+/// - otherwise, @code handler(data, len) @endcode for each segment, then @code handler() @endcode.
 template <typename PacketHandler>
 class packetizer final
 {
@@ -41,11 +53,37 @@ public:
     : m_packet_handler(h)
     , m_difference_buffer(32)
     , m_rle_buffer(32)
-  {}
+    , m_ranges()
+    , m_scratch()
+    , m_segments()
+    , m_iovecs()
+    , m_size{0}
+  {
+    m_ranges.reserve(8);
+    m_scratch.reserve(256);
+    m_segments.reserve(8);
+    m_iovecs.reserve(8);
+  }
 
+  /// @param a The ack to write.
+  /// @param version The version of the wire format understood by the encoder, only used by
+  /// cumulative acks.
+  ///
+  /// Legacy: [type | nb packets | ids | version]
+  /// Cumulative, v3: [type marked v3 | nb packets | version | first missing | nb ranges | ranges]
+  /// Cumulative, v4: the same, with variable-length integers for the first missing source and
+  /// ranges.
   void
-  write_ack(const ack& a)
+  write_ack(const ack& a, wire_version version = wire_version::v3)
   {
+    if (a.cumulative())
+    {
+      write_cumulative_ack(a, version);
+      return;
+    }
+
+    start_packet();
+
     // Write packet type.
     static const auto packet_ty = static_cast<std::uint8_t>(packet_type::ack);
     write<std::uint8_t>(packet_ty);
@@ -56,6 +94,10 @@ public:
     // Write source identifiers.
     write(a.source_ids());
 
+    // Write the highest version of the wire format understood by the decoder. Encoders which don't
+    // know about versions ignore it.
+    write<std::uint8_t>(static_cast<std::uint8_t>(a.version()));
+
     // End of data.
     mark_end();
   }
@@ -74,6 +116,12 @@ public:
     // Keep the initial memory location.
     const auto begin = reinterpret_cast<std::size_t>(data);
 
+    if (get_wire_version(p) >= wire_version::v3)
+    {
+      auto a = read_cumulative_ack(data, max_len, get_wire_version(p));
+      return std::make_pair(std::move(a), reinterpret_cast<std::size_t>(data) - begin);
+    }
+
     // Skip packet type
     read<std::uint8_t>(data, max_len);
 
@@ -83,18 +131,39 @@ public:
     // Read source identifiers
     auto ids = read_ids(data, max_len);
 
-    return std::make_pair( ack{std::move(ids), nb_packets}
+    // Read the highest version of the wire format understood by the decoder, absent from acks sent
+    // by decoders which only know v1.
+    const auto version = max_len > 0 ? advertised_version(read<std::uint8_t>(data, max_len))
+                                     : wire_version::v1;
+
+    return std::make_pair( ack{std::move(ids), nb_packets, version}
                          , reinterpret_cast<std::size_t>(data) - begin); // Number of read bytes.
   }
 
+  /// @param r The repair to write.
+  /// @param version The version of the wire format to use.
+  /// @param block_end Tell if it's one of the repairs sent at the end of a block, only written from
+  /// v5.
+  ///
+  /// v1: [header | symbol | ids | encoded size | symbol size | symbol]
+  /// v2 and v3: [header | symbol | ids | encoded size]
+  /// v4: [header | symbol | ranges of ids | encoded size]
+  /// Keyed repairs, from v2: [header | symbol | ids | encoded size | coefficient id]
   void
-  write_repair(const encoder_repair& r)
+  write_repair( const encoder_repair& r, wire_version version = wire_version::v1
+              , bool block_end = false)
   {
     assert(r.symbol().size() > 0 && "A repair's symbol shall not be empty");
+    start_packet();
 
-    // Write packet type.
-    static const auto packet_ty = static_cast<std::uint8_t>(packet_type::repair);
-    write<std::uint8_t>(packet_ty);
+    // Only repairs produced by an incremental encoder need to carry their coefficient identifier.
+    const auto keyed = r.keyed();
+    assert((not keyed or version >= wire_version::v2) && "Keyed repairs are not understood by v1");
+
+    // Write packet type, marked with the version and the end of a block.
+    const auto ty = mark_wire_version( keyed ? packet_type::keyed_repair : packet_type::repair
+                                     , version);
+    write<std::uint8_t>(block_end and version >= wire_version::v5 ? ty | block_end_mark : ty);
 
     // Write packet identifier.
     write<std::uint32_t>(r.id());
@@ -106,27 +175,60 @@ public:
     write(r.symbol().data(), r.symbol().size());
 
     // Write source identifiers.
-    write(r.source_ids());
+    if (version >= wire_version::v4)
+    {
+      write_ranges(r.source_ids());
+    }
+    else
+    {
+      write(r.source_ids());
+    }
 
     // Write encoded size.
     write<std::uint16_t>(r.encoded_size());
 
-    // Write size of the repair symbol.
-    write<std::uint16_t>(r.symbol().size());
+    if (keyed)
+    {
+      // Write the identifier used to generate coefficients.
+      write<std::uint32_t>(r.coefficient_id());
+    }
+    else if (version == wire_version::v1)
+    {
+      // Write size of the repair symbol, again.
+      write<std::uint16_t>(r.symbol().size());
 
-    // Write repair symbol.
-    write(r.symbol().data(), r.symbol().size());
+      // Write repair symbol, again. Decoders don't read it.
+      write(r.symbol().data(), r.symbol().size());
+    }
 
     // End of data.
     mark_end();
   }
 
+  /// @brief Read a repair of any version of the wire format.
   /// @throw overflow_error
   std::pair<decoder_repair, std::size_t>
   read_repair(packet&& p)
+  {
+    auto res = read_repair( std::move(p)
+                          , [](std::uint32_t, const std::vector<source_id_range>&){return false;});
+    return std::make_pair(std::move(*res.first), res.second);
+  }
+
+  /// @brief Read a repair of any version of the wire format, unless @p drop tells it's not needed.
+  ///
+  /// @p drop is given the repair's identifier and the sorted ranges of the sources it encodes
+  /// before their list is built, thus a dropped repair costs no allocation.
+  /// @return The repair if it was not dropped, and the number of read bytes.
+  /// @throw overflow_error
+  template <typename Drop>
+  std::pair<boost::optional<decoder_repair>, std::size_t>
+  read_repair(packet&& p, Drop&& drop)
   {
     // Packet type should have been verified by the caller.
-    assert(get_packet_type(p) == packet_type::repair);
+    assert( get_packet_type(p) == packet_type::repair
+         or get_packet_type(p) == packet_type::keyed_repair);
+    const auto keyed = get_packet_type(p) == packet_type::keyed_repair;
 
     const char* data = p.data();
     // To prevent overrun
@@ -152,19 +254,46 @@ public:
     max_len -= symbol_size;
     data += symbol_size;
 
-    // Read source identifiers
-    auto ids = read_ids(data, max_len);
+    // Read source identifiers, as ranges.
+    read_ranges(data, max_len, get_wire_version(p));
 
     // Read encoded size.
     const auto encoded_sz = read<std::uint16_t>(data, max_len);
 
-    return std::make_pair( decoder_repair{id, encoded_sz, std::move(ids), std::move(p), symbol_size}
-                         , reinterpret_cast<std::size_t>(data) - begin); // Number of read bytes.
+    // Read the identifier used to generate coefficients, if any.
+    const auto coefficient_id = keyed ? read<std::uint32_t>(data, max_len) : id;
+
+    // Number of read bytes.
+    const auto nb_read = reinterpret_cast<std::size_t>(data) - begin;
+
+    if (drop(id, static_cast<const std::vector<source_id_range>&>(m_ranges)))
+    {
+      return std::make_pair(boost::optional<decoder_repair>{}, nb_read);
+    }
+
+    source_id_list ids;
+    for (const auto& r : m_ranges)
+    {
+      for (auto src_id = r.first; src_id != r.last; ++src_id)
+      {
+        // Identifiers are sorted, inserting at the end is constant.
+        ids.insert(ids.end(), src_id);
+      }
+    }
+
+    return std::make_pair( boost::optional<decoder_repair>{decoder_repair{ id, coefficient_id
+                                                                         , encoded_sz
+                                                                         , std::move(ids)
+                                                                         , std::move(p)
+                                                                         , symbol_size}}
+                         , nb_read);
   }
 
   void
   write_source(const encoder_source& src)
   {
+    start_packet();
+
     // Write packet type.
     static const auto packet_ty = static_cast<std::uint8_t>(packet_type::source);
     write<std::uint8_t>(packet_ty);
@@ -173,10 +302,10 @@ public:
     write<std::uint32_t>(src.id());
 
     // Write user size of the repair symbol.
-    write<std::uint16_t>(src.symbol().size());
+    write<std::uint16_t>(src.size());
 
     // Write source symbol.
-    write(src.symbol().data(), src.symbol().size());
+    write(src.symbol(), src.size());
 
     // End of data.
     mark_end();
@@ -219,6 +348,38 @@ public:
 
 private:
 
+  /// @brief A part of a packet.
+  struct segment
+  {
+    /// @brief The bytes of this part, nullptr if they are in the scratch buffer.
+    const char* data;
+
+    /// @brief Where the bytes of this part are in the scratch buffer.
+    std::size_t offset;
+
+    /// @brief The number of bytes of this part.
+    std::size_t len;
+  };
+
+  /// @brief Tag for handlers which take a packet as an array of iovec.
+  struct gather_tag {};
+
+  /// @brief Tag for handlers which provide a buffer to serialize a packet into.
+  struct buffer_tag {};
+
+  /// @brief Tag for handlers which take a packet piece by piece.
+  struct stream_tag {};
+
+  /// @brief The concept modeled by the user's handler.
+  using handler_kind
+    = typename std::conditional<
+        is_gather_packet_handler<PacketHandler>::value
+      , gather_tag
+      , typename std::conditional< is_buffer_packet_handler<PacketHandler>::value
+                                 , buffer_tag
+                                 , stream_tag>::type
+      >::type;
+
   /// @brief Convenient method to read data and verify the size of read data.
   /// @throw overflow_error
   template <typename T>
@@ -239,22 +400,56 @@ private:
     return res;
   }
 
-  /// @brief Convenient method to write data using user's handler.
+  /// @brief Forget the segments of the previous packet.
+  void
+  start_packet()
+  noexcept
+  {
+    m_scratch.clear();
+    m_segments.clear();
+    m_size = 0;
+  }
+
+  /// @brief Convenient method to reference data in the packet, without copying it.
+  /// @attention @p data shall be valid until mark_end() is called.
   void
   write(const char* data, std::size_t len)
-  noexcept(noexcept(std::declval<PacketHandler>()(nullptr, 0ul)))
   {
-    m_packet_handler(reinterpret_cast<const char*>(data), len);
+    if (len != 0)
+    {
+      m_segments.push_back(segment{data, 0, len});
+      m_size += len;
+    }
   }
 
-  /// @brief Convenient method to write data using user's handler.
+  /// @brief Convenient method to serialize a field in the packet.
   template <typename T, typename U>
   void
   write(const U& data)
-  noexcept(noexcept(std::declval<PacketHandler>()(nullptr, 0ul)))
   {
     const auto big = boost::endian::native_to_big(static_cast<T>(data));
-    m_packet_handler(reinterpret_cast<const char*>(&big), sizeof(T));
+    const auto offset = m_scratch.size();
+    m_scratch.insert( m_scratch.end(), reinterpret_cast<const char*>(&big)
+                    , reinterpret_cast<const char*>(&big) + sizeof(T));
+    if (    not m_segments.empty() and m_segments.back().data == nullptr
+        and m_segments.back().offset + m_segments.back().len == offset)
+    {
+      // Extend the previous field.
+      m_segments.back().len += sizeof(T);
+    }
+    else
+    {
+      m_segments.push_back(segment{nullptr, offset, sizeof(T)});
+    }
+    m_size += sizeof(T);
+  }
+
+  /// @brief Get the bytes of a segment.
+  const char*
+  bytes(const segment& s)
+  const noexcept
+  {
+    return s.data != nullptr ? s.data : m_scratch.data() + s.offset;
   }
 
   /// @brief Serialize a list of source identifiers.
@@ -308,59 +503,354 @@ private:
     }
   }
 
-  /// @brief Deserialize a list of source identifiers.
-  source_id_list
-  read_ids(const char*& data, std::size_t& max_len)
+  /// @brief Serialize a list of source identifiers as ranges of consecutive identifiers.
+  ///
+  /// [nb ranges | (gap, length)*], all variable-length integers. The gap of a range is its
+  /// distance to the end of the previous range, or to 0 for the first one.
+  void
+  write_ranges(const source_id_list& ids)
   {
-    source_id_list ids;
+    auto nb_ranges = std::uint32_t{0};
+    for (auto cit = ids.begin(); cit != ids.end(); ++cit)
+    {
+      if (cit == ids.begin() or *cit != *std::prev(cit) + 1)
+      {
+        ++nb_ranges;
+      }
+    }
+    write_varint(nb_ranges);
 
-    m_difference_buffer.clear();
-    m_rle_buffer.clear();
+    auto end = std::uint32_t{0};
+    for (auto cit = ids.begin(); cit != ids.end();)
+    {
+      const auto first = *cit;
+      auto last = first + 1;
+      for (++cit; cit != ids.end() and *cit == last; ++cit)
+      {
+        ++last;
+      }
+      write_varint(first - end);
+      write_varint(last - first);
+      end = last;
+    }
+  }
+
+  /// @brief Deserialize a list of source identifiers as sorted ranges, in m_ranges.
+  ///
+  /// Lists of all versions are read, without building the list itself.
+  /// @throw overflow_error
+  void
+  read_ranges(const char*& data, std::size_t& max_len, wire_version version)
+  {
+    m_ranges.clear();
 
+    if (version >= wire_version::v4)
+    {
+      const auto nb_ranges = read_varint(data, max_len);
+      auto end = std::uint32_t{0};
+      auto nb_ids = std::size_t{0};
+      for (auto i = 0u; i < nb_ranges; ++i)
+      {
+        const auto first = end + read_varint(data, max_len);
+        const auto length = read_varint(data, max_len);
+        nb_ids += length;
+        if (first < end or first + length < first or nb_ids > max_nb_ids)
+        {
+          throw overflow_error{};
+        }
+        end = first + length;
+        add_range(first, end);
+      }
+      return;
+    }
+
+    // Reverse the running length encoding of adjacent differences on the fly.
     const auto nb_elements = read<std::uint16_t>(data, max_len);
     if (nb_elements == 0)
     {
-      return ids;
+      return;
     }
-    // Uncomment the following when the undefined behavior spotted by GCC 5.1 -fsanitize=undefined
-    // is fixed. In the meantime, it's not a real problem,it will just cost a few initial
-    // allocations before the source ids list grows to a suitable size.
-    // ids.reserve(nb_elements);
-
-    // Read first identifier.
-    const auto first_id = read<std::uint32_t>(data, max_len);
-    m_difference_buffer.push_back(first_id);
-
-    // Reverse running length encoding on the fly.
+    auto id = read<std::uint32_t>(data, max_len);
+    add_range(id, id + 1);
     const auto nb_pairs = nb_elements - 1u; // Remove the first identifier.
     for (auto i = 0ul; i < nb_pairs; ++i)
     {
       const auto run_length = read<std::uint8_t>(data, max_len);
       const auto value = read<std::uint16_t>(data, max_len);
-
       for (auto j = 0u; j < run_length; ++j)
       {
-        m_difference_buffer.push_back(value);
+        id += value;
+        add_range(id, id + 1);
       }
     }
+  }
 
-    // Revert to list of source identifiers.
-    std::partial_sum( m_difference_buffer.begin(), m_difference_buffer.end()
-                    , std::inserter(ids, ids.end()));
+  /// @brief Add a range of identifiers after the ones of m_ranges.
+  void
+  add_range(std::uint32_t first, std::uint32_t last)
+  {
+    if (first == last)
+    {
+      return;
+    }
+    if (not m_ranges.empty() and first <= m_ranges.back().last)
+    {
+      // Contiguous to, or overlapping, the previous range.
+      m_ranges.back().last = std::max(m_ranges.back().last, last);
+    }
+    else
+    {
+      m_ranges.push_back(source_id_range{first, last});
+    }
+  }
 
+  /// @brief Deserialize a list of source identifiers.
+  /// @throw overflow_error
+  source_id_list
+  read_ids(const char*& data, std::size_t& max_len)
+  {
+    read_ranges(data, max_len, wire_version::v1);
+    source_id_list ids;
+    for (const auto& r : m_ranges)
+    {
+      for (auto id = r.first; id != r.last; ++id)
+      {
+        ids.insert(ids.end(), id);
+      }
+    }
     return ids;
   }
 
-  /// @brief Convenient method to indicate end of data to user's handler.
+  /// @brief Serialize an unsigned integer with 7 bits per byte, least significant bits first.
+  ///
+  /// The most significant bit of a byte tells if another byte follows.
+  void
+  write_varint(std::uint32_t value)
+  {
+    while (value >= 0x80)
+    {
+      write<std::uint8_t>((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    write<std::uint8_t>(value);
+  }
+
+  /// @brief Deserialize an unsigned integer written by write_varint().
+  /// @throw overflow_error
+  static
+  std::uint32_t
+  read_varint(const char*& data, std::size_t& max_len)
+  {
+    auto res = std::uint32_t{0};
+    for (auto shift = 0u; shift < 32; shift += 7)
+    {
+      const auto byte = read<std::uint8_t>(data, max_len);
+      res |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return res;
+      }
+    }
+    throw overflow_error{};
+  }
+
+  /// @brief Map the version advertised by a decoder to the highest one known here.
+  static
+  wire_version
+  advertised_version(std::uint8_t advertised)
+  noexcept
+  {
+    return advertised >= static_cast<std::uint8_t>(wire_version::v5) ? wire_version::v5
+         : advertised >= static_cast<std::uint8_t>(wire_version::v4) ? wire_version::v4
+         : advertised >= static_cast<std::uint8_t>(wire_version::v3) ? wire_version::v3
+         : advertised >= static_cast<std::uint8_t>(wire_version::v2) ? wire_version::v2
+         : wire_version::v1;
+  }
+
+  /// @brief Serialize a cumulative ack.
+  ///
+  /// In v3, each range is written as its first identifier and its length on 16 bits, longer ranges
+  /// are split. In v4, each range is written as its gap to the end of the previous range (or to
+  /// the first missing source) and its length, as variable-length integers.
+  void
+  write_cumulative_ack(const ack& a, wire_version version)
+  {
+    start_packet();
+
+    // Write packet type, marked with the version understood by the encoder, at least v3 which
+    // introduced cumulative acks.
+    version = std::max(version, wire_version::v3);
+    write<std::uint8_t>(mark_wire_version(packet_type::ack, version));
+
+    // Write the number of packets received since last ack.
+    write<std::uint16_t>(a.nb_packets());
+
+    // Write the highest version of the wire format understood by the decoder.
+    write<std::uint8_t>(static_cast<std::uint8_t>(a.version()));
+
+    if (version >= wire_version::v4)
+    {
+      write_varint(a.first_missing());
+      write_varint(static_cast<std::uint32_t>(a.ranges().size()));
+      auto end = a.first_missing();
+      for (const auto& r : a.ranges())
+      {
+        assert(r.first >= end && "Ranges of an ack are not sorted");
+        write_varint(r.first - end);
+        write_varint(r.last - r.first);
+        end = r.last;
+      }
+      mark_end();
+      return;
+    }
+
+    // Write the first missing source.
+    write<std::uint32_t>(a.first_missing());
+
+    // Write ranges.
+    static constexpr auto max_length = std::uint32_t{std::numeric_limits<std::uint16_t>::max()};
+    auto nb_ranges = std::size_t{0};
+    for (const auto& r : a.ranges())
+    {
+      nb_ranges += (r.last - r.first + max_length - 1) / max_length;
+    }
+    // The newest ranges which don't fit are left out, their sources are not acknowledged yet.
+    nb_ranges = std::min(nb_ranges, std::size_t{max_length});
+    write<std::uint16_t>(nb_ranges);
+    for (auto cit = a.ranges().begin(); nb_ranges != 0; ++cit)
+    {
+      for (auto first = cit->first; first != cit->last and nb_ranges != 0; --nb_ranges)
+      {
+        const auto length = std::min(cit->last - first, max_length);
+        write<std::uint32_t>(first);
+        write<std::uint16_t>(length);
+        first += length;
+      }
+    }
+
+    // End of data.
+    mark_end();
+  }
+
+  /// @brief Deserialize a cumulative ack.
+  ///
+  /// Ranges shall be sorted, disjoint and after the first missing source.
+  /// @throw overflow_error
+  ack
+  read_cumulative_ack(const char*& data, std::size_t& max_len, wire_version version)
+  {
+    // Skip packet type.
+    read<std::uint8_t>(data, max_len);
+
+    // Read the number of packets received since last ack.
+    const auto nb_packets = read<std::uint16_t>(data, max_len);
+
+    // Read the highest version of the wire format understood by the decoder, at least the one of
+    // this ack.
+    const auto advertised
+      = std::max(advertised_version(read<std::uint8_t>(data, max_len)), version);
+
+    if (version >= wire_version::v4)
+    {
+      const auto first_missing = read_varint(data, max_len);
+      const auto nb_ranges = read_varint(data, max_len);
+      auto ranges = std::vector<source_id_range>{};
+      auto end = first_missing;
+      for (auto i = 0u; i < nb_ranges; ++i)
+      {
+        const auto first = end + read_varint(data, max_len);
+        const auto length = read_varint(data, max_len);
+        add_ack_range(ranges, end, first, length);
+      }
+      return ack{first_missing, std::move(ranges), nb_packets, advertised};
+    }
+
+    // Read the first missing source.
+    const auto first_missing = read<std::uint32_t>(data, max_len);
+
+    // Read ranges.
+    const auto nb_ranges = read<std::uint16_t>(data, max_len);
+    auto ranges = std::vector<source_id_range>{};
+    ranges.reserve(nb_ranges);
+    auto end = first_missing;
+    for (auto i = 0u; i < nb_ranges; ++i)
+    {
+      const auto first = read<std::uint32_t>(data, max_len);
+      const auto length = read<std::uint16_t>(data, max_len);
+      add_ack_range(ranges, end, first, length);
+    }
+
+    return ack{first_missing, std::move(ranges), nb_packets, advertised};
+  }
+
+  /// @brief Add the range of @p length identifiers from @p first to the ranges of an ack.
+  /// @param end The end of the previous range, updated to the end of this one.
+  /// @throw overflow_error if the range is before @p end or wraps around.
+  static
+  void
+  add_ack_range( std::vector<source_id_range>& ranges, std::uint32_t& end, std::uint32_t first
+               , std::uint32_t length)
+  {
+    if (first < end or first + length < first)
+    {
+      throw overflow_error{};
+    }
+    end = first + length;
+    if (length != 0)
+    {
+      ranges.push_back(source_id_range{first, end});
+    }
+  }
+
+  /// @brief Give the packet to the user's handler.
   void
   mark_end()
-  noexcept(noexcept(std::declval<PacketHandler>()()))
   {
+    emit(handler_kind{});
+  }
+
+  /// @brief Give the whole packet as an array of iovec.
+  void
+  emit(gather_tag)
+  {
+    m_iovecs.clear();
+    for (const auto& s : m_segments)
+    {
+      m_iovecs.push_back(::iovec{const_cast<char*>(bytes(s)), s.len});
+    }
+    m_packet_handler(static_cast<const ::iovec*>(m_iovecs.data()), m_iovecs.size());
+  }
+
+  /// @brief Serialize the packet in a buffer given by the user's handler.
+  void
+  emit(buffer_tag)
+  {
+    char* buffer = m_packet_handler(m_size);
+    for (const auto& s : m_segments)
+    {
+      buffer = std::copy_n(bytes(s), s.len, buffer);
+    }
+    m_packet_handler();
+  }
+
+  /// @brief Give the packet segment by segment.
+  void
+  emit(stream_tag)
+  {
+    for (const auto& s : m_segments)
+    {
+      m_packet_handler(bytes(s), s.len);
+    }
     m_packet_handler();
   }
 
 private:
 
+  /// @brief The maximal number of identifiers in a list, as many as the legacy encoding can carry.
+  static constexpr std::size_t max_nb_ids
+    = 1 + std::size_t{std::numeric_limits<std::uint16_t>::max()}
+        * std::numeric_limits<std::uint8_t>::max();
+
   /// @brief The handler which serializes packets.
   PacketHandler& m_packet_handler;
 
@@ -371,6 +861,21 @@ private:
 
   /// @brief A pre-allocated buffer to re-use when performing the running length encoding.
   std::vector<std::pair<std::uint8_t, std::uint16_t>> m_rle_buffer;
+
+  /// @brief A pre-allocated buffer to re-use when reading lists of source identifiers.
+  std::vector<source_id_range> m_ranges;
+
+  /// @brief Where fields of the current packet are serialized.
+  std::vector<char> m_scratch;
+
+  /// @brief The segments of the current packet.
+  std::vector<segment> m_segments;
+
+  /// @brief Re-use the same memory to give a packet as an array of iovec.
+  std::vector<::iovec> m_iovecs;
+
+  /// @brief The size of the current packet.
+  std::size_t m_size;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -29,6 +29,8 @@ public:
   /// @brief Construct a default repair, with a given identifier.
   explicit encoder_repair(std::uint32_t id)
     : m_id{id}
+    , m_coefficient_id{id}
+    , m_keyed{false}
     , m_sources_ids{}
     , m_encoded_size{}
     , m_buffer{}
@@ -39,6 +41,8 @@ public:
   encoder_repair( std::uint32_t id, std::uint16_t encoded_size, source_id_list&& ids
                 , detail::zero_byte_buffer&& buffer)
     : m_id{id}
+    , m_coefficient_id{id}
+    , m_keyed{false}
     , m_sources_ids{std::move(ids)}
     , m_encoded_size{encoded_size}
     , m_buffer{std::move(buffer)}
@@ -60,6 +64,43 @@ public:
     return m_id;
   }
 
+  /// @brief The identifier used to generate this repair's coefficients.
+  ///
+  /// It's the repair's own identifier, unless the repair was produced by an incremental encoder.
+  std::uint32_t
+  coefficient_id()
+  const noexcept
+  {
+    return m_coefficient_id;
+  }
+
+  /// @brief The identifier used to generate this repair's coefficients (mutable).
+  std::uint32_t&
+  coefficient_id()
+  noexcept
+  {
+    return m_coefficient_id;
+  }
+
+  /// @brief Tell if this repair must be sent with its coefficient identifier.
+  ///
+  /// Set by the incremental encoder, whose repairs don't use their own identifier to generate
+  /// their coefficients. Only understood by decoders from v2.
+  bool
+  keyed()
+  const noexcept
+  {
+    return m_keyed;
+  }
+
+  /// @brief Tell if this repair must be sent with its coefficient identifier (mutable).
+  bool&
+  keyed()
+  noexcept
+  {
+    return m_keyed;
+  }
+
   /// @brief This repair's list of source identifiers.
   const source_id_list&
   source_ids()
@@ -124,6 +165,12 @@ private:
   /// @brief This repair's unique identifier.
   std::uint32_t m_id;
 
+  /// @brief The identifier used to generate this repair's coefficients.
+  std::uint32_t m_coefficient_id;
+
+  /// @brief Tell if this repair must be sent with its coefficient identifier.
+  bool m_keyed;
+
   /// @brief The list of source identifiers.
   source_id_list m_sources_ids;
 
@@ -160,7 +207,14 @@ public:
   /// @brief Construct with an existing list of source identifiers and a symbol.
   decoder_repair( std::uint32_t id, std::uint16_t encoded_size, source_id_list&& ids
                 , packet&& p, std::size_t symbol_size)
+    : decoder_repair{id, id, encoded_size, std::move(ids), std::move(p), symbol_size}
+  {}
+
+  /// @brief Construct a repair whose coefficients were not generated from its own identifier.
+  decoder_repair( std::uint32_t id, std::uint32_t coefficient_id, std::uint16_t encoded_size
+                , source_id_list&& ids, packet&& p, std::size_t symbol_size)
     : m_id{id}
+    , m_coefficient_id{coefficient_id}
     , m_sources_ids{std::move(ids)}
     , m_encoded_size{encoded_size}
     , m_symbol_buffer{std::move(p)}
@@ -183,6 +237,24 @@ public:
     return m_id;
   }
 
+  /// @brief The identifier used to generate this repair's coefficients.
+  ///
+  /// It's the repair's own identifier, unless the repair was produced by an incremental encoder.
+  std::uint32_t
+  coefficient_id()
+  const noexcept
+  {
+    return m_coefficient_id;
+  }
+
+  /// @brief The identifier used to generate this repair's coefficients (mutable).
+  std::uint32_t&
+  coefficient_id()
+  noexcept
+  {
+    return m_coefficient_id;
+  }
+
   /// @brief This repair's list of source identifiers.
   const source_id_list&
   source_ids()
@@ -244,6 +316,9 @@ private:
   /// @brief This repair's unique identifier.
   std::uint32_t m_id;
 
+  /// @brief The identifier used to generate this repair's coefficients.
+  std::uint32_t m_coefficient_id;
+
   /// @brief The list of source identifiers.
   source_id_list m_sources_ids;
 
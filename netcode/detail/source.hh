@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "netcode/packet.hh"
 
 namespace ntc { namespace detail {
@@ -7,27 +9,22 @@ namespace ntc { namespace detail {
 /*------------------------------------------------------------------------------------------------*/
 
 /// @internal
-/// @brief An encoder's source packet holding a user's symbol
+/// @brief An encoder's source packet, a view on a user's symbol stored by a @ref source_list
 class encoder_source final
 {
 public:
 
-  /// @brief Can't copy-construct a source
-  encoder_source(const encoder_source&) = delete;
-
-  /// @brief Can't copy a source
-  encoder_source& operator=(const encoder_source&) = delete;
-
-  /// @brief Can move-construct a source
-  encoder_source(encoder_source&&) = default;
-
-  /// @brief Can move a source
-  encoder_source& operator=(encoder_source&&) = default;
+  /// @brief The clock used to date sources
+  using clock_type = std::chrono::steady_clock;
 
   /// @brief Constructor
-  encoder_source(std::uint32_t id, detail::byte_buffer&& p)
+  encoder_source( std::uint32_t id, const char* symbol, std::uint16_t size
+                , clock_type::time_point date = clock_type::time_point{})
+  noexcept
     : m_id{id}
-    , m_symbol_buffer{std::move(p)}
+    , m_symbol{symbol}
+    , m_size{size}
+    , m_date{date}
   {}
 
   /// @brief Get this source's identifier
@@ -39,19 +36,11 @@ public:
   }
 
   /// @brief Get the bytes of the symbol
-  const detail::byte_buffer&
+  const char*
   symbol()
   const noexcept
   {
-    return m_symbol_buffer;
-  }
-
-  /// @brief Get the bytes of the symbol
-  detail::byte_buffer&
-  symbol()
-  noexcept
-  {
-    return m_symbol_buffer;
+    return m_symbol;
   }
 
   /// @brief Get the number of bytes in the user's symbol
@@ -59,7 +48,15 @@ public:
   size()
   const noexcept
   {
-    return static_cast<std::uint16_t>(m_symbol_buffer.size());
+    return m_size;
+  }
+
+  /// @brief Get the date at which this source was added
+  clock_type::time_point
+  date()
+  const noexcept
+  {
+    return m_date;
   }
 
 private:
@@ -68,7 +65,13 @@ private:
   std::uint32_t m_id;
 
   /// @brief This source's symbol
-  detail::byte_buffer m_symbol_buffer;
+  const char* m_symbol;
+
+  /// @brief The number of bytes in this source's symbol
+  std::uint16_t m_size;
+
+  /// @brief The date at which this source was added
+  clock_type::time_point m_date;
 };
 
 /*------------------------------------------------------------------------------------------------*/
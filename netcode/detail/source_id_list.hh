@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include <boost/container/flat_set.hpp>
 
 namespace ntc { namespace detail {
@@ -12,4 +14,14 @@ using source_id_list = boost::container::flat_set<std::uint32_t>;
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief The identifiers [first, last) of consecutive sources.
+struct source_id_range
+{
+  std::uint32_t first;
+  std::uint32_t last;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace ntc::detail
@@ -1,9 +1,14 @@
 #pragma once
 
-#include <list>
+#include <algorithm> // copy_n, max
+#include <cassert>
+#include <iterator>
+#include <vector>
 
+#include "netcode/detail/buffer.hh"
 #include "netcode/detail/source.hh"
 #include "netcode/detail/source_id_list.hh"
+#include "netcode/detail/symbol_alignment.hh"
 
 namespace ntc { namespace detail {
 
@@ -11,22 +16,178 @@ namespace ntc { namespace detail {
 
 /// @internal
 /// @brief Hold a list of @ref encoder_source.
+///
+/// Symbols are copied in a ring of fixed-size slots, allocated in a single contiguous buffer. Each
+/// slot is aligned on symbol_alignment. Dropping the first source only advances the ring, erasing
+/// any other source clears its bit in a bitmap of live slots. Memory is allocated only when the
+/// ring is too small, or when a symbol doesn't fit in a slot. Thus, there is no allocation once
+/// the ring has reached its steady state size.
+///
+/// A symbol can also be written directly in its slot with prepare(), then added with commit().
+///
+/// Sources shall be added with increasing identifiers.
+/// @attention Adding a source might move the symbols of other sources.
 class source_list final
 {
 public:
 
-  /// @brief An iterator on sources.
-  using const_iterator = std::list<encoder_source>::const_iterator;
+  /// @brief An iterator on sources, which skips erased slots.
+  class const_iterator final
+  {
+  public:
+
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = encoder_source;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const encoder_source*;
+    using reference = const encoder_source&;
+
+    /// @brief Constructor.
+    const_iterator(const source_list& sl, std::size_t pos)
+    noexcept
+      : m_sl{&sl}
+      , m_pos{pos}
+    {}
+
+    reference
+    operator*()
+    const noexcept
+    {
+      return m_sl->m_slots[m_sl->index(m_pos)];
+    }
+
+    pointer
+    operator->()
+    const noexcept
+    {
+      return &**this;
+    }
+
+    const_iterator&
+    operator++()
+    noexcept
+    {
+      do
+      {
+        ++m_pos;
+      } while (m_pos < m_sl->m_span and not m_sl->m_live[m_sl->index(m_pos)]);
+      return *this;
+    }
+
+    const_iterator
+    operator++(int)
+    noexcept
+    {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend
+    bool
+    operator==(const const_iterator& lhs, const const_iterator& rhs)
+    noexcept
+    {
+      return lhs.m_pos == rhs.m_pos;
+    }
+
+    friend
+    bool
+    operator!=(const const_iterator& lhs, const const_iterator& rhs)
+    noexcept
+    {
+      return lhs.m_pos != rhs.m_pos;
+    }
+
+  private:
+
+    /// @brief The iterated list.
+    const source_list* m_sl;
+
+    /// @brief The position in the ring, relatively to the first slot.
+    std::size_t m_pos;
+  };
 
 public:
 
-  /// @brief Add a source packet in-place.
+  /// @brief Constructor.
+  source_list()
+    : m_min_capacity{min_capacity}
+    , m_slot_size{0}
+    , m_symbols{}
+    , m_slots{}
+    , m_live{}
+    , m_head{0}
+    , m_span{0}
+    , m_size{0}
+  {}
+
+  /// @brief Prepare the ring to hold @p nb sources without any allocation.
+  /// @note The memory is effectively allocated the next time the ring has to grow.
+  void
+  reserve(std::size_t nb)
+  noexcept
+  {
+    // Twice the number of sources, so that a compaction of erased slots always frees at least half
+    // of the ring.
+    auto capacity = min_capacity;
+    while (capacity / 2 < nb and capacity < max_reserved_capacity)
+    {
+      capacity *= 2;
+    }
+    m_min_capacity = capacity;
+  }
+
+  /// @brief Add a source packet, its symbol is copied in the ring.
   /// @return A reference to the added source.
   const encoder_source&
-  emplace(std::uint32_t id, byte_buffer&& symbol)
+  emplace(std::uint32_t id, const char* symbol, std::size_t size)
   {
-    m_sources.emplace_back(id, std::move(symbol));
-    return m_sources.back();
+    std::copy_n(symbol, size, prepare(size));
+    return commit(id, size);
+  }
+
+  /// @brief Get the slot of the next source, so that its symbol can be written in place.
+  /// @return A buffer of at least @p size bytes, aligned on symbol_alignment.
+  /// @attention The buffer is valid until the next call to prepare() or emplace().
+  char*
+  prepare(std::size_t size)
+  {
+    assert(size <= 0xffff && "Symbol too large");
+
+    if (size > m_slot_size or m_span == m_slots.size())
+    {
+      make_room(size);
+    }
+    return slot(index(m_span));
+  }
+
+  /// @brief Add the source packet whose symbol was written in the buffer given by prepare().
+  /// @param size The size of the symbol, at most the size given to prepare().
+  /// @param date The date of the source, used to expire it.
+  /// @return A reference to the added source.
+  const encoder_source&
+  commit( std::uint32_t id, std::size_t size
+        , encoder_source::clock_type::time_point date = encoder_source::clock_type::time_point{})
+  noexcept
+  {
+    assert(size <= m_slot_size && "Symbol larger than its slot");
+    assert((m_span == 0 or m_slots[index(m_span - 1)].id() < id) && "Decreasing identifiers");
+
+    const auto idx = index(m_span);
+    m_slots[idx] = encoder_source{id, slot(idx), static_cast<std::uint16_t>(size), date};
+    m_live[idx] = true;
+    ++m_span;
+    ++m_size;
+    return m_slots[idx];
+  }
+
+  /// @brief Add a source packet, its symbol is copied in the ring.
+  /// @return A reference to the added source.
+  const encoder_source&
+  emplace(std::uint32_t id, const byte_buffer& symbol)
+  {
+    return emplace(id, symbol.data(), symbol.size());
   }
 
   /// @brief Remove source packets from a list of identifiers.
@@ -34,29 +195,114 @@ public:
   erase(source_id_list::const_iterator id_cit, source_id_list::const_iterator id_end)
   noexcept
   {
-    // m_sources is sorted by insertion (and thus by identifier).
-    auto source_it = m_sources.begin();
-    const auto source_end = m_sources.end();
-    while (source_it != source_end and id_cit != id_end)
+    erase(id_cit, id_end, [](const encoder_source&) noexcept {});
+  }
+
+  /// @brief Remove source packets from a list of identifiers.
+  /// @param fn Called with each source right before it's removed.
+  template <typename Fn>
+  void
+  erase(source_id_list::const_iterator id_cit, source_id_list::const_iterator id_end, Fn&& fn)
+  {
+    // Slots are sorted by identifier, even erased ones. As identifiers to erase are sorted too,
+    // each search can start where the previous one stopped.
+    auto first = std::size_t{0};
+    for (; id_cit != id_end and m_size != 0; ++id_cit)
     {
-      if (source_it->id() == *id_cit)
+      auto last = m_span;
+      while (first < last)
       {
-        // We found an identifier to erase.
-        source_it = m_sources.erase(source_it);
-        ++id_cit;
+        const auto mid = first + (last - first) / 2;
+        if (m_slots[index(mid)].id() < *id_cit)
+        {
+          first = mid + 1;
+        }
+        else
+        {
+          last = mid;
+        }
       }
-      else if (source_it->id() > *id_cit)
+
+      if (first == m_span)
+      {
+        // All remaining identifiers are greater than the last source.
+        break;
+      }
+
+      const auto idx = index(first);
+      if (m_slots[idx].id() == *id_cit and m_live[idx])
+      {
+        fn(m_slots[idx]);
+        m_live[idx] = false;
+        --m_size;
+      }
+      // Otherwise, this id was already removed in a previous call to erase(). We can safely
+      // ignore it.
+    }
+
+    // Give back erased slots at the beginning of the ring. Erased slots at the end are left to the
+    // next compaction, so that the slot given by prepare() doesn't move.
+    while (m_span != 0 and not m_live[m_head])
+    {
+      m_head = index(1);
+      --m_span;
+    }
+  }
+
+  /// @brief Remove source packets with identifiers in [first, last).
+  /// @param fn Called with each source right before it's removed.
+  template <typename Fn>
+  void
+  erase(std::uint32_t first, std::uint32_t last, Fn&& fn)
+  {
+    // Find the first slot which is not before first.
+    auto pos = std::size_t{0};
+    auto end = m_span;
+    while (pos < end)
+    {
+      const auto mid = pos + (end - pos) / 2;
+      if (m_slots[index(mid)].id() < first)
       {
-        // The current source has an identifier greater than the current id to erase.
-        // This means that this id was already removed in a previous call to erase().
-        // We can safely ignore it.
-        ++id_cit;
+        pos = mid + 1;
       }
       else
       {
-        ++source_it;
+        end = mid;
       }
     }
+
+    // Slots are sorted by identifier, the range is a run of slots.
+    for (; pos < m_span and m_slots[index(pos)].id() < last; ++pos)
+    {
+      const auto idx = index(pos);
+      if (m_live[idx])
+      {
+        fn(m_slots[idx]);
+        m_live[idx] = false;
+        --m_size;
+      }
+    }
+
+    while (m_span != 0 and not m_live[m_head])
+    {
+      m_head = index(1);
+      --m_span;
+    }
+  }
+
+  /// @brief Remove all source packets with an identifier smaller than @p id.
+  /// @param fn Called with each source right before it's removed.
+  ///
+  /// It only drops the front of the ring, without any search.
+  template <typename Fn>
+  void
+  erase_before(std::uint32_t id, Fn&& fn)
+  {
+    while (m_size != 0 and front().id() < id)
+    {
+      fn(front());
+      pop_front();
+    }
   }
 
   /// @brief The number of source packets.
@@ -64,7 +310,7 @@ public:
   size()
   const noexcept
   {
-    return m_sources.size();
+    return m_size;
   }
 
   /// @brief Get an iterator to the first source.
@@ -72,7 +318,8 @@ public:
   cbegin()
   const noexcept
   {
-    return m_sources.cbegin();
+    // The first slot of the ring is always a live one.
+    return const_iterator{*this, 0};
   }
 
   /// @brief Get an iterator to the end of sources.
@@ -80,7 +327,17 @@ public:
   cend()
   const noexcept
   {
-    return m_sources.cend();
+    return const_iterator{*this, m_span};
+  }
+
+  /// @brief Get the first source.
+  /// @pre The list is not empty.
+  const encoder_source&
+  front()
+  const noexcept
+  {
+    assert(m_size != 0);
+    return m_slots[m_head];
   }
 
   /// @brief Drop the first source.
@@ -88,13 +345,150 @@ public:
   pop_front()
   noexcept
   {
-    m_sources.pop_front();
+    assert(m_size != 0);
+    m_live[m_head] = false;
+    --m_size;
+    while (m_span != 0 and not m_live[m_head])
+    {
+      m_head = index(1);
+      --m_span;
+    }
+  }
+
+private:
+
+  /// @brief Get the index of a slot from its position relatively to the first slot.
+  std::size_t
+  index(std::size_t pos)
+  const noexcept
+  {
+    // The capacity is a power of 2.
+    return (m_head + pos) & (m_slots.size() - 1);
+  }
+
+  /// @brief Get the memory of a slot.
+  char*
+  slot(std::size_t idx)
+  noexcept
+  {
+    return m_symbols.data() + idx * m_slot_size;
+  }
+
+  /// @brief Make sure the next slot exists and is large enough for a symbol of @p size bytes.
+  void
+  make_room(std::size_t size)
+  {
+    auto aligned_size
+      = std::max(symbol_alignment, (size + symbol_alignment - 1) / symbol_alignment * symbol_alignment);
+    if (aligned_size % 512 == 0)
+    {
+      // Symbols which are read together should not map to the same cache sets.
+      aligned_size += 64;
+    }
+    const auto slot_size = std::max(m_slot_size, aligned_size);
+
+    // Keep at least half of the ring free, so that compactions are rare.
+    auto capacity = std::max(m_slots.size(), m_min_capacity);
+    while (capacity < 2 * (m_size + 1))
+    {
+      capacity *= 2;
+    }
+
+    if (slot_size == m_slot_size and capacity == m_slots.size())
+    {
+      compact();
+    }
+    else
+    {
+      relayout(capacity, slot_size);
+    }
+  }
+
+  /// @brief Move live slots next to each other, in place.
+  void
+  compact()
+  noexcept
+  {
+    auto to_pos = std::size_t{0};
+    for (auto pos = std::size_t{0}; pos < m_span; ++pos)
+    {
+      const auto from = index(pos);
+      if (not m_live[from])
+      {
+        continue;
+      }
+      if (pos != to_pos)
+      {
+        // The destination slot is either erased or was already moved.
+        const auto to = index(to_pos);
+        const auto& src = m_slots[from];
+        std::copy_n(src.symbol(), src.size(), slot(to));
+        m_slots[to] = encoder_source{src.id(), slot(to), src.size(), src.date()};
+        m_live[to] = true;
+        m_live[from] = false;
+      }
+      ++to_pos;
+    }
+    m_span = to_pos;
+  }
+
+  /// @brief Move live slots to a new ring.
+  void
+  relayout(std::size_t capacity, std::size_t slot_size)
+  {
+    auto symbols = byte_buffer(capacity * slot_size);
+    auto slots = std::vector<encoder_source>(capacity, encoder_source{0, nullptr, 0});
+    auto live = std::vector<bool>(capacity, false);
+
+    auto to = std::size_t{0};
+    for (auto cit = cbegin(), end = cend(); cit != end; ++cit)
+    {
+      const auto dst = symbols.data() + to * slot_size;
+      std::copy_n(cit->symbol(), cit->size(), dst);
+      slots[to] = encoder_source{cit->id(), dst, cit->size(), cit->date()};
+      live[to] = true;
+      ++to;
+    }
+
+    m_symbols.swap(symbols);
+    m_slots.swap(slots);
+    m_live.swap(live);
+    m_slot_size = slot_size;
+    m_head = 0;
+    m_span = to;
   }
 
 private:
 
-  /// @brief The real container of source packets.
-  std::list<encoder_source> m_sources;
+  /// @brief The initial number of slots.
+  static constexpr std::size_t min_capacity = 16;
+
+  /// @brief Don't reserve more slots than this.
+  static constexpr std::size_t max_reserved_capacity = 1 << 16;
+
+  /// @brief The number of slots to allocate the next time the ring grows.
+  std::size_t m_min_capacity;
+
+  /// @brief The size of each slot.
+  std::size_t m_slot_size;
+
+  /// @brief The memory of all slots.
+  byte_buffer m_symbols;
+
+  /// @brief The sources of all slots.
+  std::vector<encoder_source> m_slots;
+
+  /// @brief Tell which slots hold a source.
+  std::vector<bool> m_live;
+
+  /// @brief The index of the first slot.
+  std::size_t m_head;
+
+  /// @brief The number of slots from the first slot to the last one, erased slots included.
+  std::size_t m_span;
+
+  /// @brief The number of sources.
+  std::size_t m_size;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,125 @@
+#include <cassert>
+
+#include "netcode/detail/thread_pool.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+thread_pool::thread_pool(std::size_t nb_threads)
+  : m_threads{}
+  , m_mutex{}
+  , m_start{}
+  , m_done{}
+  , m_task{nullptr}
+  , m_nb_tasks{0}
+  , m_next{0}
+  , m_nb_busy{0}
+  , m_generation{0}
+  , m_stop{false}
+{
+  assert(nb_threads != 0);
+  // The caller of run() is the thread of slot 0.
+  for (auto slot = 1ul; slot < nb_threads; ++slot)
+  {
+    m_threads.emplace_back([this, slot]{loop(slot);});
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+thread_pool::~thread_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+  m_start.notify_all();
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+thread_pool::run(std::size_t nb_tasks, const task_type& task)
+{
+  if (m_threads.empty() or nb_tasks < 2)
+  {
+    for (auto i = 0ul; i < nb_tasks; ++i)
+    {
+      task(i, 0);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_task = &task;
+    m_nb_tasks = nb_tasks;
+    m_next = 0;
+    m_nb_busy = m_threads.size();
+    ++m_generation;
+  }
+  m_start.notify_all();
+
+  work(0);
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+  m_done.wait(lock, [this]{return m_nb_busy == 0;});
+  m_task = nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+thread_pool::size()
+const noexcept
+{
+  return m_threads.size() + 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+thread_pool::loop(std::size_t slot)
+{
+  auto generation = std::uint64_t{0};
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_start.wait(lock, [&]{return m_stop or m_generation != generation;});
+      if (m_stop)
+      {
+        return;
+      }
+      generation = m_generation;
+    }
+
+    work(slot);
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (--m_nb_busy == 0)
+    {
+      m_done.notify_one();
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+thread_pool::work(std::size_t slot)
+{
+  for (auto i = m_next++; i < m_nb_tasks; i = m_next++)
+  {
+    (*m_task)(i, slot);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
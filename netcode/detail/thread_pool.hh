@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A small pool of threads to run independent tasks in parallel.
+///
+/// Tasks are not assigned to threads beforehand: each thread, the caller included, claims the next
+/// task as soon as it's done with the previous one. Thus, a thread which is given short tasks
+/// takes over the remaining work of the others.
+class thread_pool final
+{
+public:
+
+  /// @brief The type of a task: it's given its index and the slot of the thread which runs it.
+  ///
+  /// A slot is in [0, size()), two tasks running at the same time never have the same slot. It
+  /// can be used to give each thread its own scratch space.
+  using task_type = std::function<void (std::size_t, std::size_t)>;
+
+  /// @brief Can't copy-construct a pool.
+  thread_pool(const thread_pool&) = delete;
+
+  /// @brief Can't copy a pool.
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  /// @brief Constructor.
+  /// @param nb_threads The number of threads running tasks, including the caller of run().
+  explicit thread_pool(std::size_t nb_threads);
+
+  /// @brief Destructor.
+  ~thread_pool();
+
+  /// @brief Run tasks 0 to @p nb_tasks - 1, return when all of them are completed.
+  /// @attention Shall not be called concurrently.
+  void
+  run(std::size_t nb_tasks, const task_type& task);
+
+  /// @brief Get the number of threads running tasks, including the caller of run().
+  std::size_t
+  size()
+  const noexcept;
+
+private:
+
+  /// @brief The loop of a thread of the pool.
+  void
+  loop(std::size_t slot);
+
+  /// @brief Claim and run tasks until there is none left.
+  void
+  work(std::size_t slot);
+
+private:
+
+  /// @brief The threads of the pool.
+  std::vector<std::thread> m_threads;
+
+  /// @brief Protects the state shared with the threads of the pool.
+  std::mutex m_mutex;
+
+  /// @brief Wakes up the threads of the pool when tasks are given.
+  std::condition_variable m_start;
+
+  /// @brief Wakes up the caller of run() when all threads are done.
+  std::condition_variable m_done;
+
+  /// @brief The tasks to run.
+  const task_type* m_task;
+
+  /// @brief The number of tasks to run.
+  std::size_t m_nb_tasks;
+
+  /// @brief The index of the next task to claim.
+  std::atomic<std::size_t> m_next;
+
+  /// @brief The number of threads of the pool still running tasks.
+  std::size_t m_nb_busy;
+
+  /// @brief Incremented each time tasks are given to the threads.
+  std::uint64_t m_generation;
+
+  /// @brief Tell the threads of the pool to stop.
+  bool m_stop;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <sys/uio.h> // iovec
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>   // declval
+
 #include "netcode/decoder_fwd.hh"
 #include "netcode/encoder_fwd.hh"
 
@@ -41,4 +47,74 @@ struct is_decoder<ntc::decoder<PacketHandler, DataHandler>>
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief Trait to detect if a packet handler accepts a complete packet as an array of iovec.
+///
+/// Such a handler is called once per packet with @code handler(iov, iovcnt) @endcode.
+/// A handler which also accepts @code handler(const char*, std::size_t) @endcode, like one which
+/// takes a @c const @c void* or a generic one, is a stream handler rather than a gather handler.
+template <typename PacketHandler>
+struct is_gather_packet_handler
+{
+private:
+
+  template <typename T>
+  static
+  auto
+  test(int)
+  -> decltype( std::declval<T&>()(std::declval<const ::iovec*>(), std::declval<std::size_t>())
+             , std::true_type{});
+
+  template <typename>
+  static
+  std::false_type
+  test(...);
+
+  template <typename T>
+  static
+  auto
+  test_stream(int)
+  -> decltype( std::declval<T&>()(std::declval<const char*>(), std::declval<std::size_t>())
+             , std::true_type{});
+
+  template <typename>
+  static
+  std::false_type
+  test_stream(...);
+
+public:
+
+  static constexpr auto value = decltype(test<PacketHandler>(0))::value
+                            and not decltype(test_stream<PacketHandler>(0))::value;
+};
+
+/// @internal
+/// @brief Trait to detect if a packet handler provides a buffer in which a packet is serialized.
+///
+/// Such a handler is called with @code char* buffer = handler(len) @endcode to obtain a buffer of
+/// @p len bytes, then with @code handler() @endcode once the packet is serialized in this buffer.
+template <typename PacketHandler>
+struct is_buffer_packet_handler
+{
+private:
+
+  template <typename T>
+  static
+  auto
+  test(int)
+  -> typename std::is_same< decltype(std::declval<T&>()(std::declval<std::size_t>()))
+                          , char*>::type;
+
+  template <typename>
+  static
+  std::false_type
+  test(...);
+
+public:
+
+  static constexpr auto value = decltype(test<PacketHandler>(0))::value;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace ntc::detail
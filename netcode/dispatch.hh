@@ -30,6 +30,7 @@ dispatch(Encoder& encoder, Decoder& decoder, packet&& p)
     }
 
     case ntc::detail::packet_type::repair:
+    case ntc::detail::packet_type::keyed_repair:
     case ntc::detail::packet_type::source:
     {
       return decoder(std::move(p));
@@ -4,9 +4,11 @@
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <iterator> // begin, end
 #include <limits> // numeric_limits
 
 #include "netcode/detail/encoder.hh"
+#include "netcode/detail/incremental_encoder.hh"
 #include "netcode/detail/packet_type.hh"
 #include "netcode/detail/packetizer.hh"
 #include "netcode/detail/repair.hh"
@@ -17,6 +19,7 @@
 #include "netcode/errors.hh"
 #include "netcode/packet.hh"
 #include "netcode/systematic.hh"
+#include "netcode/wire_version.hh"
 
 namespace ntc {
 
@@ -24,6 +27,15 @@ namespace ntc {
 
 /// @brief The class to interact with on the sender side
 /// @ingroup ntc_encoder
+///
+/// @p PacketHandler is given each packet ready to be sent on the network, in one of these ways,
+/// the first one it supports being used:
+/// - @code handler(const iovec* iov, std::size_t iovcnt) @endcode is called once with the whole
+///   packet, ready for @c sendmsg();
+/// - @code char* buffer = handler(std::size_t len) @endcode is called to get a buffer of @p len
+///   bytes, then @code handler() @endcode once the packet is serialized in @p buffer;
+/// - @code handler(const char* data, std::size_t len) @endcode is called for each part of the
+///   packet, then @code handler() @endcode at the end of the packet.
 template <typename PacketHandler>
 class NTC_PUBLIC encoder final
 {
@@ -53,18 +65,26 @@ public:
     , m_code_type{systematic::yes}
     , m_rate{5}
     , m_window_size{std::numeric_limits<std::size_t>::max()}
+    , m_max_age{0}
     , m_adaptive{false}
+    , m_band_width{0}
+    , m_block_size{0}
+    , m_block_nb_repairs{0}
+    , m_block_first{0}
     , m_current_source_id{0}
     , m_current_repair_id{0}
     , m_sources{}
     , m_repair{m_current_repair_id}
     , m_packet_handler(std::forward<PacketHandler_>(packet_handler))
     , m_encoder{m_galois_field_size}
+    , m_incremental_encoder{m_galois_field_size, 0 /* disabled */}
     , m_packetizer{m_packet_handler}
     , m_nb_sent_repairs{0ul}
     , m_nb_acks{0ul}
     , m_nb_sent_sources{0ul}
     , m_nb_sent_packets{0}
+    , m_wire_version{ntc::wire_version::v1}
+    , m_nb_pending_repairs{0}
   {
     // Let's reserve some memory for the repair, it will most likely avoid initial memory
     // allocations.
@@ -80,19 +100,67 @@ public:
   void
   operator()(const data& d)
   {
-    operator()(data{d});
+    commit_impl(d);
   }
 
   /// @brief Give the encoder a new data
   void
   operator()(data&& d)
   {
-    assert(d.size() != 0 && "empty data");
-    assert( m_galois_field_size != 16
-            or (m_galois_field_size == 16 and d.size() % (16/8) == 0));
-    assert( m_galois_field_size != 32
-            or (m_galois_field_size == 32 and d.size() % (32/8) == 0));
-    commit_impl(std::move(d));
+    commit_impl(d);
+  }
+
+  /// @brief Get a buffer to write the next data in place
+  ///
+  /// The buffer belongs to the encoder's window, thus a data written in it, then given with
+  /// commit_reserved(), is never copied. It makes possible to receive data from a socket directly
+  /// in the window. The buffer is aligned on 16 bytes.
+  /// @param size The maximal size of the next data
+  /// @note If the window is full, the oldest source is dropped right away.
+  /// @attention The buffer is invalidated when another data is given to the encoder.
+  char*
+  reserve_source(std::size_t size)
+  {
+    assert(size != 0 && "empty data");
+    make_room_in_window();
+    return m_sources.prepare(size);
+  }
+
+  /// @brief Give the encoder the data written in the buffer returned by reserve_source()
+  /// @param size The size of the data, at most the size given to reserve_source()
+  void
+  commit_reserved(std::size_t size)
+  {
+    generate_repairs(add_reserved_source(size));
+  }
+
+  /// @brief Give the encoder several data at once
+  ///
+  /// Sources are sent as they are added, but the repairs which come due in the meantime are
+  /// generated together once the last source is added, or before a source leaves the window or
+  /// the band, whether it's full or the source expired. Thus, they are computed in a row and each
+  /// of them protects the whole burst.
+  template <typename InputIterator>
+  void
+  commit(InputIterator first, InputIterator last)
+  {
+    for (; first != last; ++first)
+    {
+      // Pending repairs are generated by add_source() before a source is evicted.
+      m_nb_pending_repairs += add_source(*first);
+    }
+    generate_pending_repairs();
+  }
+
+  /// @brief Give the encoder several data at once
+  /// @see commit(InputIterator, InputIterator)
+  template <typename Range>
+  void
+  commit(const Range& r)
+  {
+    using std::begin;
+    using std::end;
+    commit(begin(r), end(r));
   }
 
   /// @brief Notify the decoder of an incoming packet
@@ -165,7 +233,7 @@ public:
     m_repair.reset();
     mk_repair();
     ++m_nb_sent_packets;
-    m_packetizer.write_repair(m_repair);
+    m_packetizer.write_repair(m_repair, m_wire_version, block_complete());
   }
 
   /// @brief Get the Galois's field size
@@ -220,6 +288,7 @@ public:
   {
     assert(sz > 0);
     m_window_size = sz;
+    m_sources.reserve(sz);
     return *this;
   }
 
@@ -231,6 +300,42 @@ public:
     return m_window_size;
   }
 
+  /// @brief Set how long a source is kept in the encoder's window
+  ///
+  /// Sources older than @p age are dropped before a new source is added, or when expire() is
+  /// called, whether they were acknowledged or not. It bounds the window when no acks are received,
+  /// as in a one-way operation, and repairs don't encode sources that a decoder would give up on.
+  /// When @p age == 0 (the default), sources are only dropped by acks or by the window size.
+  encoder&
+  set_max_age(std::chrono::milliseconds age)
+  noexcept
+  {
+    m_max_age = age;
+    return *this;
+  }
+
+  /// @brief Get how long a source is kept in the encoder's window, 0 if sources don't expire
+  std::chrono::milliseconds
+  max_age()
+  const noexcept
+  {
+    return m_max_age;
+  }
+
+  /// @brief Drop the sources older than max_age()
+  /// @return The number of dropped sources
+  ///
+  /// Should be called periodically when no data are given to the encoder for a while.
+  std::size_t
+  expire()
+  {
+    if (m_max_age.count() == 0)
+    {
+      return 0;
+    }
+    return drop_older_than(detail::encoder_source::clock_type::now() - m_max_age);
+  }
+
   /// @brief Set the adaptive mode of the code
   encoder&
   set_adaptive(bool adaptive)
@@ -248,21 +353,154 @@ public:
     return m_adaptive;
   }
 
+  /// @brief Set the number of accumulators used to generate repairs incrementally
+  ///
+  /// When @p nb > 0, each source is folded once in @p nb running repairs when it's given to the
+  /// encoder and subtracted from them when it's acknowledged or evicted from the window. Generating
+  /// a repair then costs the copy of a symbol, whatever the window size, as long as the window has
+  /// slid past the sources of the last repair copied from the same accumulator. Otherwise, the
+  /// accumulator is rebuilt from the window with new coefficients, so that repairs stay
+  /// independent. Copied repairs carry the identifier of their coefficients, which decoders only
+  /// understand from v2: until the decoder advertises v2 or later, accumulators are always rebuilt.
+  /// When @p nb == 0 (the default), each repair encodes the whole window from scratch.
+  encoder&
+  set_nb_accumulators(std::size_t nb)
+  {
+    m_incremental_encoder.reset(nb);
+    return *this;
+  }
+
+  /// @brief Get the number of accumulators used to generate repairs incrementally
+  std::size_t
+  nb_accumulators()
+  const noexcept
+  {
+    return m_incremental_encoder.nb_accumulators();
+  }
+
+  /// @brief Set the number of most recent sources encoded by each repair
+  ///
+  /// When @p nb > 0, each repair encodes only the @p nb most recent sources of the window, so that
+  /// the cost of a repair is bounded whatever the window size. Bands of successive repairs overlap
+  /// when @p nb is greater than the rate, thus a burst of losses is still rebuilt from several
+  /// repairs by a decoder, which solves the oldest missing sources first. As encoded sources are
+  /// consecutive, the list of their identifiers is still sent as a single range.
+  /// Sources which are left behind the band are dropped from the window.
+  /// When @p nb == 0 (the default), each repair encodes the whole window.
+  /// @note Not used when repairs are generated from accumulators.
+  encoder&
+  set_band_width(std::size_t nb)
+  noexcept
+  {
+    m_band_width = nb;
+    return *this;
+  }
+
+  /// @brief Get the number of most recent sources encoded by each repair
+  std::size_t
+  band_width()
+  const noexcept
+  {
+    return m_band_width;
+  }
+
+  /// @brief Set the number of sources of a block, and the number of repairs sent for each block
+  ///
+  /// When @p nb_sources > 0, sources are grouped in blocks of @p nb_sources consecutive sources,
+  /// the first block starting with the next source. Once the last source of a block is sent,
+  /// @p nb_repairs repairs which encode the whole block are generated and the block is dropped from
+  /// the window. Thus, the window never holds more than a block and a decoder never rebuilds more
+  /// than @p nb_sources sources at once, whether acks are received or not. The rate is not used.
+  /// From v5, the repairs of a block are marked, so that a decoder releases a block as soon as all
+  /// its sources are known.
+  /// When @p nb_sources == 0 (the default), the window slides with acks.
+  /// @note A non-systematic code still sends a repair for each source of a block.
+  encoder&
+  set_block(std::size_t nb_sources, std::size_t nb_repairs)
+  noexcept
+  {
+    m_block_size = nb_sources;
+    m_block_nb_repairs = nb_repairs;
+    m_block_first = m_current_source_id;
+    return *this;
+  }
+
+  /// @brief Get the number of sources of a block, 0 if blocks are not used
+  std::size_t
+  block_size()
+  const noexcept
+  {
+    return m_block_size;
+  }
+
+  /// @brief Get the number of repairs sent for each block
+  std::size_t
+  block_nb_repairs()
+  const noexcept
+  {
+    return m_block_nb_repairs;
+  }
+
+  /// @brief Set the version of the wire format used until the decoder advertises its own
+  ///
+  /// Upon reception of an ack, the encoder switches to the highest version understood by the
+  /// decoder.
+  encoder&
+  set_wire_version(ntc::wire_version version)
+  noexcept
+  {
+    m_wire_version = version;
+    return *this;
+  }
+
+  /// @brief Get the version of the wire format currently used
+  ntc::wire_version
+  wire_version()
+  const noexcept
+  {
+    return m_wire_version;
+  }
+
 private:
 
   /// @brief Create a source from the given data and generate a repair if needed
   /// @param d The data to add
   void
-  commit_impl(data&& d)
+  commit_impl(const data& d)
   {
-    if (m_sources.size() == m_window_size)
-    {
-      m_sources.pop_front();
-    }
+    generate_repairs(add_source(d));
+  }
 
-    // Create a new source in-place at the end of the list of sources.
-    const auto& insertion = m_sources.emplace(m_current_source_id, std::move(d));
+  /// @brief Create a source from the given data
+  /// @param d The data to add
+  /// @return The number of repairs to generate for this source
+  std::size_t
+  add_source(const data& d)
+  {
+    assert(d.size() != 0 && "empty data");
+    make_room_in_window();
+
+    // Copy the new source at the end of the list of sources.
+    std::copy_n(d.data(), d.size(), m_sources.prepare(d.size()));
+    return add_reserved_source(d.size());
+  }
+
+  /// @brief Create a source from the data written in the next slot of the list of sources
+  /// @param size The size of the data
+  /// @return The number of repairs to generate for this source
+  std::size_t
+  add_reserved_source(std::size_t size)
+  {
+    assert(size != 0 && "empty data");
+    assert(m_galois_field_size != 16 or size % (16/8) == 0);
+    assert(m_galois_field_size != 32 or size % (32/8) == 0);
 
+    // Sources are always dated, so that an age set later applies from their commit.
+    const auto& insertion
+      = m_sources.commit(m_current_source_id, size, detail::encoder_source::clock_type::now());
+    m_incremental_encoder.add(insertion);
+
+    auto nb_repairs = std::size_t{0};
     if (m_code_type == systematic::yes)
     {
       ++m_nb_sent_sources;
@@ -272,16 +510,110 @@ private:
     }
     else // non_systematic code
     {
-      generate_repair();
+      ++nb_repairs;
     }
 
+    ++m_current_source_id;
+
+    if (m_block_size != 0)
+    {
+      if (block_complete())
+      {
+        nb_repairs += m_block_nb_repairs;
+      }
+    }
     /// @todo Should we generate a repair if window_size() == 1?
-    if ((m_current_source_id + 1) % m_rate == 0)
+    else if (m_current_source_id % m_rate == 0)
     {
-      generate_repair();
+      ++nb_repairs;
     }
 
-    ++m_current_source_id;
+    return nb_repairs;
+  }
+
+  /// @brief Tell if all the sources of the current block have been added
+  bool
+  block_complete()
+  const noexcept
+  {
+    return m_block_size != 0 and m_current_source_id - m_block_first == m_block_size;
+  }
+
+  /// @brief Drop the sources of the current block, once its repairs have been sent
+  void
+  end_block()
+  {
+    m_sources.erase_before(m_current_source_id, [](const detail::encoder_source&){});
+    // Accumulators are rebuilt from the next block.
+    m_incremental_encoder.reset(m_incremental_encoder.nb_accumulators());
+    m_block_first = m_current_source_id;
+  }
+
+  /// @brief Drop the expired sources and the oldest source if the window is full
+  ///
+  /// The pending repairs of a batch are generated before any source is dropped, they must encode
+  /// it. So are they when the band is full, as the next repair drops the source behind it.
+  void
+  make_room_in_window()
+  {
+    const auto oldest = m_max_age.count() == 0
+                      ? detail::encoder_source::clock_type::time_point{}
+                      : detail::encoder_source::clock_type::now() - m_max_age;
+    if ( m_nb_pending_repairs != 0
+        and (  block_complete() or m_sources.size() == m_window_size
+            or (m_band_width != 0 and m_sources.size() >= m_band_width)
+            or (m_sources.size() != 0 and m_sources.front().date() < oldest)))
+    {
+      generate_pending_repairs();
+    }
+    if (block_complete())
+    {
+      end_block();
+    }
+    drop_older_than(oldest);
+    if (m_sources.size() == m_window_size)
+    {
+      m_incremental_encoder.remove(m_sources.front());
+      m_sources.pop_front();
+    }
+  }
+
+  /// @brief Drop the sources committed before @p oldest
+  /// @return The number of dropped sources
+  std::size_t
+  drop_older_than(detail::encoder_source::clock_type::time_point oldest)
+  {
+    auto nb = std::size_t{0};
+    while (m_sources.size() != 0 and m_sources.front().date() < oldest)
+    {
+      m_incremental_encoder.remove(m_sources.front());
+      m_sources.pop_front();
+      ++nb;
+    }
+    return nb;
+  }
+
+  /// @brief Generate the repairs which came due during a batch
+  void
+  generate_pending_repairs()
+  {
+    const auto nb = m_nb_pending_repairs;
+    m_nb_pending_repairs = 0;
+    generate_repairs(nb);
+  }
+
+  /// @brief Generate @p nb repairs
+  void
+  generate_repairs(std::size_t nb)
+  {
+    for (; nb != 0; --nb)
+    {
+      generate_repair();
+    }
+    if (block_complete())
+    {
+      end_block();
+    }
   }
 
   /// @brief Notify the encoder that some packet has been received (should be an ack)
@@ -312,7 +644,24 @@ private:
         }
       }
       m_nb_sent_packets = 0;
-      m_sources.erase(begin(res.first.source_ids()), end(res.first.source_ids()));
+      m_wire_version = res.first.version();
+      const auto remove = [this](const detail::encoder_source& src)
+                          {
+                            m_incremental_encoder.remove(src);
+                          };
+      if (res.first.cumulative())
+      {
+        // Only what changed since the previous ack is searched for.
+        m_sources.erase_before(res.first.first_missing(), remove);
+        for (const auto& r : res.first.ranges())
+        {
+          m_sources.erase(r.first, r.last, remove);
+        }
+      }
+      else
+      {
+        m_sources.erase(begin(res.first.source_ids()), end(res.first.source_ids()), remove);
+      }
       return res.second;
     }
   }
@@ -326,7 +675,20 @@ private:
 
     // Create the repair packet from the list of sources.
     assert(m_sources.size() > 0 && "Empty source list");
-    m_encoder(m_repair, m_sources);
+    if (m_incremental_encoder.nb_accumulators() == 0)
+    {
+      // Sources older than the band will never be encoded again, no need to keep them.
+      while (m_band_width != 0 and m_sources.size() > m_band_width)
+      {
+        m_sources.pop_front();
+      }
+      m_encoder(m_repair, m_sources);
+    }
+    else
+    {
+      // Decoders which only know v1 don't understand keyed repairs.
+      m_incremental_encoder(m_repair, m_sources, m_wire_version >= ntc::wire_version::v2);
+    }
 
     ++m_current_repair_id;
     ++m_nb_sent_repairs;
@@ -357,9 +719,24 @@ private:
   /// @brief The maximal number of sources to keep on the encoder side before discarding them
   std::size_t m_window_size;
 
+  /// @brief How long sources are kept on the encoder side, 0 to keep them until acknowledged
+  std::chrono::milliseconds m_max_age;
+
   /// @brief Tell if the code is adaptive
   bool m_adaptive;
 
+  /// @brief How many of the most recent sources a repair encodes, 0 for all of them
+  std::size_t m_band_width;
+
+  /// @brief The number of sources of a block, 0 if blocks are not used
+  std::size_t m_block_size;
+
+  /// @brief The number of repairs sent for each block
+  std::size_t m_block_nb_repairs;
+
+  /// @brief The identifier of the first source of the current block
+  std::uint32_t m_block_first;
+
   /// @brief The counter for source packets identifiers
   std::uint32_t m_current_source_id;
 
@@ -378,6 +755,9 @@ private:
   /// @brief The component that handles the coding process
   detail::encoder m_encoder;
 
+  /// @brief The component that handles the coding process when accumulators are used
+  detail::incremental_encoder m_incremental_encoder;
+
   /// @brief How to read and write packets
   detail::packetizer<packet_handler_type> m_packetizer;
 
@@ -392,6 +772,12 @@ private:
 
   /// @brief The number of sent packets since last ack
   std::uint16_t m_nb_sent_packets;
+
+  /// @brief The version of the wire format of sent packets
+  ntc::wire_version m_wire_version;
+
+  /// @brief The number of repairs which came due during the current batch
+  std::size_t m_nb_pending_repairs;
 };
 
 /*------------------------------------------------------------------------------------------------*/
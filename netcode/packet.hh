@@ -1,12 +1,13 @@
 #pragma once
 
-#include <algorithm> // copy
+#include <algorithm> // copy, fill
 #include <initializer_list>
 
 #include "netcode/detail/buffer.hh"
 #include "netcode/detail/serialize_packet_fwd.hh"
 #include "netcode/detail/symbol_alignment.hh"
 #include "netcode/detail/visibility.hh"
+#include "netcode/packet_pool.hh"
 
 namespace ntc {
 
@@ -59,27 +60,72 @@ public:
   packet(packet&&) = default;
 
   /// @brief Move assignement operator
-  packet& operator=(packet&&) = default;
+  /// @note The previous buffer is given back to its pool, if any.
+  packet&
+  operator=(packet&& other)
+  noexcept
+  {
+    if (this != &other)
+    {
+      if (m_pool)
+      {
+        m_pool->give(std::move(m_buffer));
+      }
+      m_buffer = std::move(other.m_buffer);
+      m_pool = other.m_pool;
+    }
+    return *this;
+  }
+
+  /// @brief Destructor; gives back the buffer to its pool, if any
+  ~packet()
+  {
+    if (m_pool)
+    {
+      m_pool->give(std::move(m_buffer));
+    }
+  }
 
   /// @brief Default constructor; constructs an empty packet
   packet()
     : m_buffer(shift)
+    , m_pool{nullptr}
   {}
 
   /// @brief Constructs a packet of size @p size; the packet is uninitialized
   explicit packet(size_type size)
     : m_buffer(size + shift)
+    , m_pool{nullptr}
   {}
 
   /// @brief Constructs the packet with @p count copies of @p value
   packet(size_type count, char value)
     : m_buffer(count + shift, value)
+    , m_pool{nullptr}
   {}
 
+  /// @brief Constructs a packet of size @p size with a buffer of @p pool; the packet is
+  /// uninitialized
+  /// @note The buffer is given back to @p pool when the packet is destroyed.
+  packet(packet_pool& pool, size_type size)
+    : m_buffer(pool.take(size + shift))
+    , m_pool{&pool}
+  {}
+
+  /// @brief Constructs the packet with @p count copies of @p value, with a buffer of @p pool
+  /// @note The buffer is given back to @p pool when the packet is destroyed.
+  packet(packet_pool& pool, size_type count, char value)
+    : m_buffer(pool.take(count + shift))
+    , m_pool{&pool}
+  {
+    std::fill(m_buffer.begin() + shift, m_buffer.end(), value);
+  }
+
   /// @brief Constructs the packet with the contents of the range [@p first, @p last)
   template <typename InputIterator>
   packet(InputIterator first, InputIterator last)
     : m_buffer(static_cast<size_type>(std::distance(first, last)) + shift)
+    , m_pool{nullptr}
   {
     std::copy(first, last, m_buffer.begin() + shift);
   }
@@ -87,6 +133,7 @@ public:
   /// @brief Constructs the packet with an initializer list
   packet(std::initializer_list<char> init)
     : m_buffer(init.size() + shift)
+    , m_pool{nullptr}
   {
     std::copy(std::begin(init), std::end(init), m_buffer.begin() + shift);
   }
@@ -95,6 +142,7 @@ public:
   /// @note For testing purposes only
   packet(const detail::byte_buffer& symbol)
     : m_buffer(symbol.size() + alignment)
+    , m_pool{nullptr}
   {
     std::copy(symbol.begin(), symbol.end(), m_buffer.begin() + alignment);
   }
@@ -103,6 +151,7 @@ public:
   /// @note For testing purposes only
   packet(const detail::zero_byte_buffer& symbol)
     : m_buffer(symbol.size() + alignment)
+    , m_pool{nullptr}
   {
     std::copy(symbol.begin(), symbol.end(), m_buffer.begin() + alignment);
   }
@@ -339,6 +388,9 @@ private:
   friend struct detail::serialize_packet;
 
   detail::byte_buffer m_buffer;
+
+  /// @brief The pool which gave the buffer, if any.
+  packet_pool* m_pool;
 };
 
 /*------------------------------------------------------------------------------------------------*/
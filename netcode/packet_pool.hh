@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <utility> // move
+#include <vector>
+
+#include "netcode/detail/buffer.hh"
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+class packet;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup ntc_packets
+/// @brief A pool of buffers to construct packets without allocation
+///
+/// A packet constructed from a pool takes one of its idle buffers, and gives it back when it's
+/// destroyed. Thus, once the pool holds enough buffers, packets are created and dropped without
+/// any call to the memory allocator.
+/// @attention A pool is not thread-safe, and shall outlive the packets constructed from it.
+class NTC_PUBLIC packet_pool final
+{
+public:
+
+  /// @brief Can't copy-construct a pool.
+  packet_pool(const packet_pool&) = delete;
+
+  /// @brief Can't copy a pool.
+  packet_pool& operator=(const packet_pool&) = delete;
+
+  /// @brief Constructor
+  /// @param max_size The maximal number of idle buffers kept by the pool, the others are freed.
+  explicit packet_pool(std::size_t max_size = 1024)
+    : m_buffers()
+    , m_max_size{max_size}
+    , m_nb_allocations{0}
+  {
+    // Giving back a buffer never allocates.
+    m_buffers.reserve(m_max_size);
+  }
+
+  /// @brief Get the number of idle buffers.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_buffers.size();
+  }
+
+  /// @brief Get the maximal number of idle buffers.
+  std::size_t
+  max_size()
+  const noexcept
+  {
+    return m_max_size;
+  }
+
+  /// @brief Get the number of buffers which had to be allocated as the pool had none.
+  std::size_t
+  nb_allocations()
+  const noexcept
+  {
+    return m_nb_allocations;
+  }
+
+private:
+
+  friend class packet;
+
+  /// @brief Get a buffer of @p size bytes, left uninitialized.
+  detail::byte_buffer
+  take(std::size_t size)
+  {
+    if (m_buffers.empty())
+    {
+      ++m_nb_allocations;
+      return detail::byte_buffer(size);
+    }
+    auto buffer = std::move(m_buffers.back());
+    m_buffers.pop_back();
+    buffer.resize(size);
+    return buffer;
+  }
+
+  /// @brief Give back a buffer.
+  void
+  give(detail::byte_buffer&& buffer)
+  noexcept
+  {
+    // An empty buffer has been moved from.
+    if (buffer.capacity() != 0 and m_buffers.size() < m_max_size)
+    {
+      m_buffers.push_back(std::move(buffer));
+    }
+  }
+
+private:
+
+  /// @brief The idle buffers.
+  std::vector<detail::byte_buffer> m_buffers;
+
+  /// @brief The maximal number of idle buffers.
+  const std::size_t m_max_size;
+
+  /// @brief The number of buffers allocated by take().
+  std::size_t m_nb_allocations;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
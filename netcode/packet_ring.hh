@@ -0,0 +1,331 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef> // size_t
+#include <iterator> // distance
+#include <utility> // swap
+#include <vector>
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup ntc_packets
+/// @brief A lock-free ring of packets, between a single producer thread and a single consumer
+/// thread.
+///
+/// The packets of the ring are allocated once for all, with a reserved size. They are exchanged
+/// with the packets of the producer and of the consumer rather than copied: a packet given back
+/// with its buffer is reused by the next packets, without any allocation.
+///
+/// The producer fills the ring with push(), or with a writer given as a @p PacketHandler to an
+/// encoder or to a decoder (see make_writer()). The consumer drains it with pop(). Both sides move
+/// several packets at once with a single synchronization.
+class NTC_PUBLIC packet_ring final
+{
+public:
+
+  /// @brief A packet handler which serializes packets in the ring.
+  ///
+  /// When the ring is full, the packet is dropped.
+  /// @see nb_dropped()
+  class writer final
+  {
+  public:
+
+    /// @brief Constructor.
+    explicit writer(packet_ring& ring)
+      : m_ring(&ring)
+    {}
+
+    /// @brief Get a buffer of @p len bytes for the next packet.
+    char*
+    operator()(std::size_t len)
+    {
+      return m_ring->prepare(len);
+    }
+
+    /// @brief Publish the packet serialized in the last buffer.
+    void
+    operator()()
+    {
+      m_ring->commit();
+    }
+
+  private:
+
+    /// @brief The ring to fill.
+    packet_ring* m_ring;
+  };
+
+public:
+
+  /// @brief Can't copy-construct a ring.
+  packet_ring(const packet_ring&) = delete;
+
+  /// @brief Can't copy a ring.
+  packet_ring& operator=(const packet_ring&) = delete;
+
+  /// @brief Constructor.
+  /// @param capacity The maximal number of packets in the ring, rounded up to a power of 2.
+  /// @param packet_size The number of bytes reserved beforehand in each packet.
+  packet_ring(std::size_t capacity, std::size_t packet_size)
+    : m_slots(round_up(capacity))
+    , m_mask{m_slots.size() - 1}
+    , m_head{0}
+    , m_cached_tail{0}
+    , m_consumer_padding()
+    , m_tail{0}
+    , m_cached_head{0}
+    , m_reserved{false}
+    , m_nb_dropped{0}
+    , m_scratch()
+  {
+    for (auto& p : m_slots)
+    {
+      p.reserve(packet_size);
+    }
+    m_scratch.reserve(packet_size);
+  }
+
+  /// @brief Get a writer which serializes packets in this ring.
+  /// @attention Only the producer thread shall use it.
+  writer
+  make_writer()
+  noexcept
+  {
+    return writer{*this};
+  }
+
+  /// @brief Give a packet to the consumer.
+  ///
+  /// @p p is exchanged with a packet of the ring, which can be reused by the producer.
+  /// @return false if the ring is full, @p p is left untouched.
+  /// @attention Only the producer thread shall call it.
+  bool
+  push(packet& p)
+  noexcept
+  {
+    if (room(1) == 0)
+    {
+      return false;
+    }
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    std::swap(m_slots[tail & m_mask], p);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Give packets to the consumer, as many as possible from the start of [first, last).
+  ///
+  /// Given packets are exchanged with packets of the ring, which can be reused by the producer.
+  /// @return The number of given packets.
+  /// @attention Only the producer thread shall call it.
+  template <typename ForwardIterator>
+  std::size_t
+  push(ForwardIterator first, ForwardIterator last)
+  noexcept
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    const auto free = room(static_cast<std::size_t>(std::distance(first, last)));
+    auto nb = std::size_t{0};
+    for (; first != last and nb < free; ++first, ++nb)
+    {
+      std::swap(m_slots[(tail + nb) & m_mask], *first);
+    }
+    m_tail.store(tail + nb, std::memory_order_release);
+    return nb;
+  }
+
+  /// @brief Take the oldest packet given by the producer.
+  ///
+  /// @p p is exchanged with the packet of the ring. Its buffer will be reused by the producer.
+  /// @return false if the ring is empty, @p p is left untouched.
+  /// @attention Only the consumer thread shall call it.
+  bool
+  pop(packet& p)
+  noexcept
+  {
+    if (available(1) == 0)
+    {
+      return false;
+    }
+    const auto head = m_head.load(std::memory_order_relaxed);
+    std::swap(m_slots[head & m_mask], p);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Take the oldest packets given by the producer, as many as possible to fill
+  /// [first, last).
+  ///
+  /// Packets of [first, last) are exchanged with packets of the ring. Their buffers will be
+  /// reused by the producer.
+  /// @return The number of taken packets, at the start of [first, last).
+  /// @attention Only the consumer thread shall call it.
+  template <typename ForwardIterator>
+  std::size_t
+  pop(ForwardIterator first, ForwardIterator last)
+  noexcept
+  {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    const auto ready = available(static_cast<std::size_t>(std::distance(first, last)));
+    auto nb = std::size_t{0};
+    for (; first != last and nb < ready; ++first, ++nb)
+    {
+      std::swap(m_slots[(head + nb) & m_mask], *first);
+    }
+    m_head.store(head + nb, std::memory_order_release);
+    return nb;
+  }
+
+  /// @brief Get the number of packets in the ring.
+  /// @note It's only a snapshot when the other thread is running.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+
+  /// @brief Tell if the ring is empty.
+  /// @note It's only a snapshot when the other thread is running.
+  bool
+  empty()
+  const noexcept
+  {
+    return size() == 0;
+  }
+
+  /// @brief Get the maximal number of packets in the ring.
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_slots.size();
+  }
+
+  /// @brief Get the number of packets dropped by writers because the ring was full.
+  std::size_t
+  nb_dropped()
+  const noexcept
+  {
+    return m_nb_dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+
+  /// @brief Get the number of free slots, from the producer's point of view.
+  /// @param wanted The consumer's progress is only read if there are less free slots.
+  std::size_t
+  room(std::size_t wanted)
+  noexcept
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (m_slots.size() - (tail - m_cached_head) < wanted)
+    {
+      // See if the consumer made some room since last time.
+      m_cached_head = m_head.load(std::memory_order_acquire);
+    }
+    return m_slots.size() - (tail - m_cached_head);
+  }
+
+  /// @brief Get the number of ready packets, from the consumer's point of view.
+  /// @param wanted The producer's progress is only read if there are less ready packets.
+  std::size_t
+  available(std::size_t wanted)
+  noexcept
+  {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (m_cached_tail - head < wanted)
+    {
+      // See if the producer gave some packets since last time.
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+    }
+    return m_cached_tail - head;
+  }
+
+  /// @brief Get a buffer for the next packet of a writer.
+  char*
+  prepare(std::size_t len)
+  {
+    m_reserved = room(1) != 0;
+    auto& p = m_reserved ? m_slots[m_tail.load(std::memory_order_relaxed) & m_mask] : m_scratch;
+    p.resize(len);
+    return p.data();
+  }
+
+  /// @brief Publish the packet of a writer.
+  void
+  commit()
+  noexcept
+  {
+    if (m_reserved)
+    {
+      m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    else
+    {
+      m_nb_dropped.store(m_nb_dropped.load(std::memory_order_relaxed) + 1
+                        , std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Round up to the next power of 2.
+  static
+  std::size_t
+  round_up(std::size_t n)
+  noexcept
+  {
+    assert(n != 0 && "empty ring");
+    auto res = std::size_t{1};
+    while (res < n)
+    {
+      res <<= 1;
+    }
+    return res;
+  }
+
+private:
+
+  /// @brief The size of a cache line, to keep the state of each side on its own.
+  static constexpr std::size_t cache_line_size = 64;
+
+  /// @brief The packets of the ring.
+  std::vector<packet> m_slots;
+
+  /// @brief To get the slot of an index.
+  const std::size_t m_mask;
+
+  /// @brief The index of the next packet to pop, written by the consumer.
+  std::atomic<std::size_t> m_head;
+
+  /// @brief The last index of the producer seen by the consumer.
+  std::size_t m_cached_tail;
+
+  /// @brief Keep the producer's state away from the consumer's one.
+  char m_consumer_padding[cache_line_size];
+
+  /// @brief The index of the next packet to push, written by the producer.
+  std::atomic<std::size_t> m_tail;
+
+  /// @brief The last index of the consumer seen by the producer.
+  std::size_t m_cached_head;
+
+  /// @brief Tell if the writer's current packet is in the ring.
+  bool m_reserved;
+
+  /// @brief The number of packets dropped by writers.
+  std::atomic<std::size_t> m_nb_dropped;
+
+  /// @brief Where a writer's packet goes when the ring is full.
+  packet m_scratch;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,518 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>   // memcpy
+#include <functional>
+#include <memory>    // unique_ptr
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>   // move
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/data.hh"
+#include "netcode/decoder.hh"
+#include "netcode/dispatch.hh"
+#include "netcode/encoder.hh"
+#include "netcode/errors.hh"
+#include "netcode/in_order.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Demultiplex many flows, each with its own encoder and decoder, over a set of threads.
+/// @ingroup ntc
+///
+/// Each flow is identified by a 32 bits identifier, carried by all its packets. Flows are sharded
+/// on @p nb_shards worker threads: a flow always lives on the shard
+/// @code flow % nb_shards @endcode, which owns its encoder and decoder. Thus, the state of a flow
+/// is only touched by one thread and shards never share a lock. Work is given to a shard through
+/// its own lock-free queue, on which producers only contend for a compare-and-swap. A shard's
+/// mutex is only taken to wait for work when its queue is empty, and by the producer which finds
+/// it empty, to wake up the worker.
+///
+/// An exception thrown while processing some work, e.g. by a handler or by a configuration
+/// function, doesn't stop the shard: the work is abandoned and counted (see nb_failed()).
+///
+/// The flow identifier is appended to the codec's packet, in big endian, rather than prepended: it
+/// can be stripped by shrinking the packet, which keeps the symbol of a received packet aligned
+/// for zero-copy decoding (see @ref packet).
+///
+/// Each shard owns a copy of the handlers, which is only called from the shard's thread:
+/// - @code packet_handler(const char* data, std::size_t len) @endcode is given each packet, flow
+///   identifier included, ready to be sent on the network;
+/// - @code data_handler(std::uint32_t flow, const char* data, std::size_t len) @endcode is given
+///   the data decoded or received for @p flow.
+template <typename PacketHandler, typename DataHandler>
+class NTC_PUBLIC session_table final
+{
+private:
+
+  struct shard;
+
+  /// @brief The packet handler of the encoder and decoder of a flow.
+  ///
+  /// Serializes a packet in its shard's buffer, then gives it to the user with the flow
+  /// identifier.
+  struct flow_packet_handler
+  {
+    shard* m_shard;
+    std::uint32_t m_flow;
+
+    char*
+    operator()(std::size_t len)
+    {
+      m_shard->m_buffer.resize(len + flow_id_size);
+      return m_shard->m_buffer.data();
+    }
+
+    void
+    operator()()
+    {
+      const auto big = boost::endian::native_to_big(m_flow);
+      auto& buffer = m_shard->m_buffer;
+      std::memcpy(buffer.data() + buffer.size() - flow_id_size, &big, flow_id_size);
+      m_shard->m_packet_handler(static_cast<const char*>(buffer.data()), buffer.size());
+    }
+  };
+
+  /// @brief The data handler of the decoder of a flow.
+  struct flow_data_handler
+  {
+    shard* m_shard;
+    std::uint32_t m_flow;
+
+    void
+    operator()(const char* data, std::size_t len)
+    {
+      m_shard->m_data_handler(m_flow, data, len);
+    }
+  };
+
+public:
+
+  /// @brief The type of the encoder of a flow.
+  using encoder_type = encoder<flow_packet_handler>;
+
+  /// @brief The type of the decoder of a flow.
+  using decoder_type = decoder<flow_packet_handler, flow_data_handler>;
+
+  /// @brief The type of the functions which configure the encoder and the decoder of a new flow.
+  using configuration_type = std::function<void (encoder_type&, decoder_type&)>;
+
+  /// @brief The number of bytes of the flow identifier appended to each packet.
+  static constexpr std::size_t flow_id_size = sizeof(std::uint32_t);
+
+public:
+
+  /// @brief Can't copy-construct a session table.
+  session_table(const session_table&) = delete;
+
+  /// @brief Can't copy a session table.
+  session_table& operator=(const session_table&) = delete;
+
+  /// @brief Constructor.
+  ///
+  /// Starts one worker thread per shard.
+  /// @param nb_shards The number of shards, at least 1.
+  session_table( std::size_t nb_shards, std::uint8_t galois_field_size, in_order ordered
+               , const PacketHandler& packet_handler, const DataHandler& data_handler)
+    : m_galois_field_size{galois_field_size}
+    , m_ordered{ordered}
+    , m_shards{}
+  {
+    assert(nb_shards != 0 && "no shard");
+    m_shards.reserve(nb_shards);
+    for (auto i = 0ul; i < nb_shards; ++i)
+    {
+      m_shards.emplace_back(new shard{packet_handler, data_handler});
+    }
+    // Shards are all constructed before the first thread starts.
+    for (auto& s : m_shards)
+    {
+      s->m_worker = std::thread{[this, &s]{run(*s);}};
+    }
+  }
+
+  /// @brief Destructor.
+  ///
+  /// Waits for each shard to process the work given so far, then stops its thread.
+  ~session_table()
+  {
+    for (auto& s : m_shards)
+    {
+      {
+        std::lock_guard<std::mutex> lock{s->m_mutex};
+        s->m_stop = true;
+      }
+      s->m_cv.notify_one();
+    }
+    for (auto& s : m_shards)
+    {
+      s->m_worker.join();
+    }
+  }
+
+  /// @brief Register a flow with the default configuration of its encoder and decoder.
+  /// @note Does nothing if the flow is already registered.
+  void
+  add_flow(std::uint32_t flow)
+  {
+    add_flow(flow, configuration_type{});
+  }
+
+  /// @brief Register a flow.
+  /// @param configure Called on the shard's thread with the new encoder and decoder of @p flow.
+  /// @note Does nothing if the flow is already registered.
+  void
+  add_flow(std::uint32_t flow, configuration_type configure)
+  {
+    command c{command::type::add, flow};
+    c.m_configure = std::move(configure);
+    push(std::move(c));
+  }
+
+  /// @brief Unregister a flow, its encoder and decoder are destroyed.
+  void
+  remove_flow(std::uint32_t flow)
+  {
+    push(command{command::type::remove, flow});
+  }
+
+  /// @brief Give a new data to the encoder of a flow.
+  /// @note The data is dropped if the flow is not registered.
+  void
+  send(std::uint32_t flow, data&& d)
+  {
+    command c{command::type::send, flow};
+    c.m_data = std::move(d);
+    push(std::move(c));
+  }
+
+  /// @brief Steer an incoming packet to the shard of its flow.
+  ///
+  /// The flow identifier is removed from the packet, which is then given to the encoder or the
+  /// decoder of the flow.
+  /// @throw packet_type_error if the packet is too small to carry a flow identifier.
+  /// @note The packet is dropped if its flow is not registered or if it's invalid.
+  void
+  operator()(packet&& p)
+  {
+    if (p.size() <= flow_id_size)
+    {
+      throw packet_type_error{std::move(p)};
+    }
+    const auto flow = flow_of(p);
+    p.resize(p.size() - flow_id_size);
+    command c{command::type::receive, flow};
+    c.m_packet = std::move(p);
+    push(std::move(c));
+  }
+
+  /// @brief Get the flow identifier of a packet received from the network.
+  /// @pre @p p is larger than flow_id_size.
+  static
+  std::uint32_t
+  flow_of(const packet& p)
+  noexcept
+  {
+    assert(p.size() > flow_id_size);
+    auto big = std::uint32_t{0};
+    std::memcpy(&big, p.data() + p.size() - flow_id_size, flow_id_size);
+    return boost::endian::big_to_native(big);
+  }
+
+  /// @brief Get the shard which owns a flow.
+  std::size_t
+  shard_of(std::uint32_t flow)
+  const noexcept
+  {
+    return flow % m_shards.size();
+  }
+
+  /// @brief Get the number of shards.
+  std::size_t
+  nb_shards()
+  const noexcept
+  {
+    return m_shards.size();
+  }
+
+  /// @brief Get the number of packets and data dropped so far because their flow is not registered
+  /// or because they are invalid.
+  std::size_t
+  nb_dropped()
+  const noexcept
+  {
+    auto res = std::size_t{0};
+    for (const auto& s : m_shards)
+    {
+      res += s->m_nb_dropped.load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+
+  /// @brief Get the number of commands abandoned so far because processing them threw an
+  /// exception, e.g. from a handler, from a configuration function or on a lack of memory.
+  /// @note The flow of a configuration function which threw is not registered.
+  std::size_t
+  nb_failed()
+  const noexcept
+  {
+    auto res = std::size_t{0};
+    for (const auto& s : m_shards)
+    {
+      res += s->m_nb_failed.load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+
+private:
+
+  /// @brief The encoder and the decoder of a flow.
+  struct session
+  {
+    session(shard& s, std::uint32_t flow, std::uint8_t galois_field_size, in_order ordered)
+      : m_encoder{galois_field_size, flow_packet_handler{&s, flow}}
+      , m_decoder{ galois_field_size, ordered, flow_packet_handler{&s, flow}
+                 , flow_data_handler{&s, flow}}
+    {}
+
+    encoder_type m_encoder;
+    decoder_type m_decoder;
+  };
+
+  /// @brief Some work given to a shard.
+  struct command
+  {
+    enum class type {add, remove, send, receive};
+
+    command(type t, std::uint32_t flow)
+      : m_type{t}, m_flow{flow}, m_packet{}, m_data{}, m_configure{}, m_next{nullptr}
+    {}
+
+    type m_type;
+    std::uint32_t m_flow;
+    packet m_packet;
+    data m_data;
+    configuration_type m_configure;
+
+    /// @brief The next command of the queue, i.e. the previously pushed one.
+    command* m_next;
+  };
+
+  /// @brief The state owned by a worker thread.
+  struct shard
+  {
+    shard(const PacketHandler& packet_handler, const DataHandler& data_handler)
+      : m_packet_handler(packet_handler)
+      , m_data_handler(data_handler)
+      , m_buffer()
+      , m_sessions()
+      , m_queue{nullptr}
+      , m_mutex()
+      , m_cv()
+      , m_stop{false}
+      , m_nb_dropped{0}
+      , m_nb_failed{0}
+      , m_worker()
+    {}
+
+    /// @brief This shard's copy of the user's packet handler.
+    PacketHandler m_packet_handler;
+
+    /// @brief This shard's copy of the user's data handler.
+    DataHandler m_data_handler;
+
+    /// @brief Where outgoing packets are serialized.
+    std::vector<char> m_buffer;
+
+    /// @brief The flows owned by this shard.
+    std::unordered_map<std::uint32_t, std::unique_ptr<session>> m_sessions;
+
+    /// @brief The work not yet taken by the worker, most recent first.
+    std::atomic<command*> m_queue;
+
+    /// @brief Protects the stop flag and the worker's sleep.
+    std::mutex m_mutex;
+
+    /// @brief Wakes up the worker when some work is queued in its empty queue.
+    std::condition_variable m_cv;
+
+    /// @brief Tell the worker to stop once the queue is empty.
+    bool m_stop;
+
+    /// @brief The number of packets and data dropped by this shard.
+    std::atomic<std::size_t> m_nb_dropped;
+
+    /// @brief The number of commands abandoned by this shard because of an exception.
+    std::atomic<std::size_t> m_nb_failed;
+
+    /// @brief The thread which processes this shard's work.
+    std::thread m_worker;
+  };
+
+private:
+
+  /// @brief Queue some work on the shard of its flow.
+  ///
+  /// The worker is only woken up when its queue was empty, it might be waiting.
+  void
+  push(command&& c)
+  {
+    auto& s = *m_shards[shard_of(c.m_flow)];
+    auto* node = new command{std::move(c)};
+    auto* next = s.m_queue.load(std::memory_order_relaxed);
+    do
+    {
+      node->m_next = next;
+    } while (not s.m_queue.compare_exchange_weak( next, node, std::memory_order_release
+                                                , std::memory_order_relaxed));
+    if (next == nullptr)
+    {
+      // The worker checks its queue under the lock before waiting: taking it here ensures the
+      // notification can't be sent between this check and the wait.
+      {
+        std::lock_guard<std::mutex> lock{s.m_mutex};
+      }
+      s.m_cv.notify_one();
+    }
+  }
+
+  /// @brief The loop of a worker thread.
+  ///
+  /// The whole queue is taken at once with an atomic exchange, and the lock is only taken to wait
+  /// for work when the queue is empty.
+  void
+  run(shard& s)
+  {
+    while (true)
+    {
+      auto* queue = s.m_queue.exchange(nullptr, std::memory_order_acquire);
+      if (queue == nullptr)
+      {
+        std::unique_lock<std::mutex> lock{s.m_mutex};
+        s.m_cv.wait( lock
+                   , [&]{return s.m_stop or s.m_queue.load(std::memory_order_relaxed) != nullptr;});
+        if (s.m_queue.load(std::memory_order_relaxed) == nullptr)
+        {
+          return;
+        }
+        continue;
+      }
+
+      // Commands are queued most recent first, restore their order.
+      auto* batch = static_cast<command*>(nullptr);
+      while (queue != nullptr)
+      {
+        auto* next = queue->m_next;
+        queue->m_next = batch;
+        batch = queue;
+        queue = next;
+      }
+
+      auto nb_dropped = std::size_t{0};
+      auto nb_failed = std::size_t{0};
+      while (batch != nullptr)
+      {
+        const auto c = std::unique_ptr<command>{batch};
+        batch = c->m_next;
+        // Some work which can't be done must not stop the shard.
+        try
+        {
+          nb_dropped += process(s, *c) ? 0 : 1;
+        }
+        catch (...)
+        {
+          ++nb_failed;
+        }
+      }
+      s.m_nb_dropped.fetch_add(nb_dropped, std::memory_order_relaxed);
+      s.m_nb_failed.fetch_add(nb_failed, std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Process some work on the shard's thread.
+  /// @return false if the work was dropped.
+  /// @throw Whatever the handlers, the configuration function or the allocator throw.
+  bool
+  process(shard& s, command& c)
+  {
+    if (c.m_type == command::type::add)
+    {
+      auto& ptr = s.m_sessions[c.m_flow];
+      if (not ptr)
+      {
+        try
+        {
+          ptr.reset(new session{s, c.m_flow, m_galois_field_size, m_ordered});
+          if (c.m_configure)
+          {
+            c.m_configure(ptr->m_encoder, ptr->m_decoder);
+          }
+        }
+        catch (...)
+        {
+          // Don't keep a flow which is not configured as asked.
+          s.m_sessions.erase(c.m_flow);
+          throw;
+        }
+      }
+      return true;
+    }
+    if (c.m_type == command::type::remove)
+    {
+      s.m_sessions.erase(c.m_flow);
+      return true;
+    }
+
+    const auto search = s.m_sessions.find(c.m_flow);
+    if (search == s.m_sessions.end())
+    {
+      return false;
+    }
+    auto& state = *search->second;
+    if (c.m_type == command::type::send)
+    {
+      state.m_encoder(std::move(c.m_data));
+      return true;
+    }
+    // A packet from the network can't be trusted, an invalid one must not stop the shard.
+    try
+    {
+      dispatch(state.m_encoder, state.m_decoder, std::move(c.m_packet));
+      return true;
+    }
+    catch (const packet_type_error&)
+    {
+      return false;
+    }
+    catch (const overflow_error&)
+    {
+      return false;
+    }
+  }
+
+private:
+
+  /// @brief The Galois field size of all flows.
+  const std::uint8_t m_galois_field_size;
+
+  /// @brief Tell if the decoders of all flows give data in order.
+  const in_order m_ordered;
+
+  /// @brief The shards, which don't move once the threads are started.
+  std::vector<std::unique_ptr<shard>> m_shards;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
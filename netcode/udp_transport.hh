@@ -0,0 +1,621 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <netinet/in.h>
+#include <netinet/udp.h> // UDP_SEGMENT, UDP_GRO
+#include <sys/socket.h>  // recvmmsg, sendmmsg
+
+#include <algorithm>     // min
+#include <cassert>
+#include <cerrno>
+#include <cstddef>       // size_t
+#include <cstdint>
+#include <cstring>       // memcpy, memset
+#include <system_error>
+#include <vector>
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/decoder.hh"
+#include "netcode/packet.hh"
+
+// Older headers don't know about UDP segmentation offload (Linux 4.18) and UDP receive offload
+// (Linux 5.0). The kernel rejects them if it doesn't support them either.
+#ifndef UDP_SEGMENT
+# define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+# define UDP_GRO 104
+#endif
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup ntc_packets
+/// @brief Send and receive packets on a UDP socket by batches, with a single system call for each.
+///
+/// Packets written by an encoder or a decoder (see make_writer()) are serialized one after the
+/// other in a buffer, then sent with @c sendmmsg() by flush(). When the kernel supports UDP
+/// segmentation offload, consecutive packets of the same size are even sent as a single datagram,
+/// which the kernel splits as late as possible.
+///
+/// Packets are received with @c recvmmsg(), and given to a decoder with receive(). When UDP receive
+/// offload is enabled with set_receive_offload(), several packets of the same flow may come as a
+/// single datagram, which is split back in packets.
+///
+/// The socket is not owned, it should either be connected or be given a destination with
+/// set_destination(). Whether it's blocking or not is up to the user. It's only configured by
+/// set_receive_offload(), which sets its @c UDP_GRO option.
+/// @note Only available on Linux.
+class NTC_PUBLIC udp_transport final
+{
+public:
+
+  /// @brief A packet handler which serializes packets in the send buffer of a transport.
+  ///
+  /// Packets are only sent by batches, when the buffer is full or when flush() is called.
+  class writer final
+  {
+  public:
+
+    /// @brief Constructor.
+    explicit writer(udp_transport& transport)
+      : m_transport(&transport)
+    {}
+
+    /// @brief Get a buffer of @p len bytes for the next packet.
+    char*
+    operator()(std::size_t len)
+    {
+      return m_transport->prepare(len);
+    }
+
+    /// @brief Queue the packet serialized in the last buffer.
+    void
+    operator()()
+    {
+      m_transport->commit();
+    }
+
+  private:
+
+    /// @brief The transport to send packets with.
+    udp_transport* m_transport;
+  };
+
+public:
+
+  /// @brief Can't copy-construct a transport.
+  udp_transport(const udp_transport&) = delete;
+
+  /// @brief Can't copy a transport.
+  udp_transport& operator=(const udp_transport&) = delete;
+
+  /// @brief Constructor.
+  /// @param fd The UDP socket.
+  /// @param batch_size The maximal number of packets sent or received with one system call.
+  /// @param packet_size The maximal size of a packet.
+  ///
+  /// Segmentation offload is enabled if the kernel supports it, receive offload is disabled as it
+  /// has to be enabled on the socket.
+  explicit udp_transport(int fd, std::size_t batch_size = 32, std::size_t packet_size = 2048)
+    : m_fd{fd}
+    , m_batch_size{batch_size}
+    , m_packet_size{packet_size}
+    , m_destination()
+    , m_destination_len{0}
+    , m_gso{false}
+    , m_gro{false}
+    , m_tx_buffer(batch_size * packet_size)
+    , m_tx_used{0}
+    , m_tx_pending{0}
+    , m_tx_sizes()
+    , m_tx_firsts(batch_size)
+    , m_tx_iovecs(batch_size)
+    , m_tx_controls(batch_size)
+    , m_tx_messages(batch_size)
+    , m_rx_slot_size{packet_size}
+    , m_rx_buffer(batch_size * packet_size)
+    , m_rx_iovecs(batch_size)
+    , m_rx_controls(batch_size)
+    , m_rx_messages(batch_size)
+    , m_segments()
+    , m_next_segment{0}
+    , m_packets()
+    , m_nb_sent_packets{0}
+    , m_nb_send_calls{0}
+    , m_nb_received_packets{0}
+    , m_nb_receive_calls{0}
+    , m_nb_dropped{0}
+  {
+    m_tx_sizes.reserve(batch_size);
+    m_segments.reserve(batch_size);
+    m_packets.reserve(batch_size);
+    set_segmentation_offload(true);
+  }
+
+  /// @brief Destructor. Send the pending packets, if possible.
+  ~udp_transport()
+  {
+    try
+    {
+      flush();
+    }
+    catch (...)
+    {}
+  }
+
+  /// @brief Get a writer which serializes packets to send in this transport.
+  writer
+  make_writer()
+  noexcept
+  {
+    return writer{*this};
+  }
+
+  /// @brief Set the destination of packets, for a socket which is not connected.
+  void
+  set_destination(const ::sockaddr* addr, ::socklen_t len)
+  {
+    assert(len <= sizeof(m_destination));
+    std::memcpy(&m_destination, addr, len);
+    m_destination_len = len;
+  }
+
+  /// @brief Send all packets serialized by writers.
+  /// @throw std::system_error if the socket can't send them.
+  /// @note Packets which don't fit in the socket's buffer are dropped.
+  void
+  flush()
+  {
+    if (not m_tx_sizes.empty())
+    {
+      send_from(0);
+      m_tx_sizes.clear();
+      m_tx_used = 0;
+    }
+  }
+
+  /// @brief Receive packets and give them to a decoder, all at once.
+  ///
+  /// Packets are allocated from the decoder's pool. Waits for at least one datagram if the socket
+  /// is blocking.
+  /// @return The number of packets given to the decoder.
+  /// @throw std::system_error if the socket can't receive packets.
+  /// @throw packet_type_error if an invalid packet is received, following packets of the batch
+  /// are lost.
+  template <typename PacketHandler, typename DataHandler>
+  std::size_t
+  receive(decoder<PacketHandler, DataHandler>& dec)
+  {
+    if (m_next_segment == m_segments.size())
+    {
+      read_batch();
+    }
+    m_packets.clear();
+    for (; m_next_segment < m_segments.size(); ++m_next_segment)
+    {
+      const auto& s = m_segments[m_next_segment];
+      m_packets.emplace_back(dec.pool(), s.len);
+      std::memcpy(m_packets.back().data(), s.data, s.len);
+    }
+    m_nb_received_packets += m_packets.size();
+    dec.receive(m_packets);
+    return m_packets.size();
+  }
+
+  /// @brief Receive packets, as many as possible to fill [first, last).
+  ///
+  /// Packets of [first, last) are resized and overwritten. Waits for at least one datagram if the
+  /// socket is blocking and if no packet was left by a previous call.
+  /// @return The number of received packets, at the start of [first, last).
+  /// @throw std::system_error if the socket can't receive packets.
+  template <typename ForwardIterator>
+  std::size_t
+  receive(ForwardIterator first, ForwardIterator last)
+  {
+    if (m_next_segment == m_segments.size())
+    {
+      read_batch();
+    }
+    auto nb = std::size_t{0};
+    for (; first != last and m_next_segment < m_segments.size(); ++first, ++nb, ++m_next_segment)
+    {
+      const auto& s = m_segments[m_next_segment];
+      first->resize(s.len);
+      std::memcpy(first->data(), s.data, s.len);
+    }
+    m_nb_received_packets += nb;
+    return nb;
+  }
+
+  /// @brief Enable or disable UDP segmentation offload.
+  /// @return true if it is enabled, false if disabled or not supported.
+  bool
+  set_segmentation_offload(bool enable)
+  noexcept
+  {
+    auto size = 0;
+    auto len = static_cast<::socklen_t>(sizeof(size));
+    m_gso = enable and ::getsockopt(m_fd, SOL_UDP, UDP_SEGMENT, &size, &len) == 0;
+    return m_gso;
+  }
+
+  /// @brief Tell if UDP segmentation offload is enabled.
+  bool
+  segmentation_offload()
+  const noexcept
+  {
+    return m_gso;
+  }
+
+  /// @brief Enable or disable UDP receive offload.
+  ///
+  /// The @c UDP_GRO option of the socket is set accordingly.
+  /// @return true if it is enabled, false if disabled or not supported.
+  /// @attention Packets received but not yet returned by receive() are lost.
+  bool
+  set_receive_offload(bool enable)
+  {
+    const auto value = enable ? 1 : 0;
+    const auto ok = ::setsockopt(m_fd, SOL_UDP, UDP_GRO, &value, sizeof(value)) == 0;
+    m_gro = enable and ok;
+    // A datagram received with offload is made of several packets.
+    m_rx_slot_size = m_gro ? max_offload_size : m_packet_size;
+    m_rx_buffer.resize(m_batch_size * m_rx_slot_size);
+    m_segments.clear();
+    m_next_segment = 0;
+    return m_gro;
+  }
+
+  /// @brief Tell if UDP receive offload is enabled.
+  bool
+  receive_offload()
+  const noexcept
+  {
+    return m_gro;
+  }
+
+  /// @brief Get the number of packets given to the socket.
+  std::size_t
+  nb_sent_packets()
+  const noexcept
+  {
+    return m_nb_sent_packets;
+  }
+
+  /// @brief Get the number of system calls made to send packets.
+  std::size_t
+  nb_send_calls()
+  const noexcept
+  {
+    return m_nb_send_calls;
+  }
+
+  /// @brief Get the number of received packets.
+  std::size_t
+  nb_received_packets()
+  const noexcept
+  {
+    return m_nb_received_packets;
+  }
+
+  /// @brief Get the number of system calls made to receive packets.
+  std::size_t
+  nb_receive_calls()
+  const noexcept
+  {
+    return m_nb_receive_calls;
+  }
+
+  /// @brief Get the number of dropped packets.
+  ///
+  /// Either the socket's buffer was full when sending them, or they were received truncated
+  /// because larger than the maximal size of a packet.
+  std::size_t
+  nb_dropped()
+  const noexcept
+  {
+    return m_nb_dropped;
+  }
+
+private:
+
+  /// @brief A packet in the receive buffer.
+  struct segment
+  {
+    const char* data;
+    std::size_t len;
+  };
+
+  /// @brief Room for the ancillary data of a message, which carries the size of segments.
+  union control
+  {
+    ::cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int))];
+  };
+
+  /// @brief Get a buffer for the next packet of a writer.
+  char*
+  prepare(std::size_t len)
+  {
+    if (m_tx_sizes.size() == m_batch_size or m_tx_used + len > m_tx_buffer.size())
+    {
+      flush();
+    }
+    if (len > m_tx_buffer.size())
+    {
+      m_tx_buffer.resize(len);
+    }
+    m_tx_pending = len;
+    return m_tx_buffer.data() + m_tx_used;
+  }
+
+  /// @brief Queue the packet of a writer.
+  void
+  commit()
+  {
+    m_tx_sizes.push_back(m_tx_pending);
+    m_tx_used += m_tx_pending;
+    if (m_tx_sizes.size() == m_batch_size)
+    {
+      flush();
+    }
+  }
+
+  /// @brief Send the queued packets, starting from the @p first one.
+  void
+  send_from(std::size_t first)
+  {
+    // Group packets in messages.
+    auto offset = std::size_t{0};
+    for (auto i = std::size_t{0}; i < first; ++i)
+    {
+      offset += m_tx_sizes[i];
+    }
+    auto nb_messages = std::size_t{0};
+    for (auto i = first; i < m_tx_sizes.size(); ++nb_messages)
+    {
+      const auto segment_size = m_tx_sizes[i];
+      auto len = segment_size;
+      auto nb = std::size_t{1};
+      if (m_gso)
+      {
+        // All segments have the same size, but the last one which can be smaller.
+        while (i + nb < m_tx_sizes.size() and nb < max_segments
+               and m_tx_sizes[i + nb] <= segment_size
+               and len + m_tx_sizes[i + nb] <= max_offload_size)
+        {
+          len += m_tx_sizes[i + nb];
+          ++nb;
+          if (m_tx_sizes[i + nb - 1] != segment_size)
+          {
+            break;
+          }
+        }
+      }
+      prepare_message(nb_messages, offset, len, nb > 1 ? segment_size : 0);
+      m_tx_firsts[nb_messages] = i;
+      offset += len;
+      i += nb;
+    }
+
+    auto nb_sent = std::size_t{0};
+    while (nb_sent < nb_messages)
+    {
+      const auto res = ::sendmmsg( m_fd, m_tx_messages.data() + nb_sent
+                                 , static_cast<unsigned int>(nb_messages - nb_sent), 0);
+      ++m_nb_send_calls;
+      if (res >= 0)
+      {
+        nb_sent += static_cast<std::size_t>(res);
+      }
+      else if (errno == EINTR)
+      {
+        continue;
+      }
+      else if ( (errno == EIO or errno == EINVAL)
+               and m_tx_messages[nb_sent].msg_hdr.msg_controllen != 0)
+      {
+        // The route doesn't support segmentation offload, send packets one by one.
+        m_nb_sent_packets += m_tx_firsts[nb_sent] - first;
+        m_gso = false;
+        send_from(m_tx_firsts[nb_sent]);
+        return;
+      }
+      else if (errno == EAGAIN or errno == EWOULDBLOCK or errno == ENOBUFS)
+      {
+        m_nb_sent_packets += m_tx_firsts[nb_sent] - first;
+        m_nb_dropped += m_tx_sizes.size() - m_tx_firsts[nb_sent];
+        return;
+      }
+      else
+      {
+        throw std::system_error{errno, std::system_category(), "sendmmsg"};
+      }
+    }
+    m_nb_sent_packets += m_tx_sizes.size() - first;
+  }
+
+  /// @brief Describe a datagram of @p len bytes to send, made of segments of @p segment_size bytes
+  /// if not 0.
+  void
+  prepare_message(std::size_t i, std::size_t offset, std::size_t len, std::size_t segment_size)
+  noexcept
+  {
+    m_tx_iovecs[i] = ::iovec{m_tx_buffer.data() + offset, len};
+    auto& hdr = m_tx_messages[i].msg_hdr;
+    hdr = ::msghdr();
+    hdr.msg_name = m_destination_len != 0 ? &m_destination : nullptr;
+    hdr.msg_namelen = m_destination_len;
+    hdr.msg_iov = &m_tx_iovecs[i];
+    hdr.msg_iovlen = 1;
+    if (segment_size != 0)
+    {
+      hdr.msg_control = m_tx_controls[i].buffer;
+      hdr.msg_controllen = CMSG_SPACE(sizeof(std::uint16_t));
+      auto cmsg = CMSG_FIRSTHDR(&hdr);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+      const auto size = static_cast<std::uint16_t>(segment_size);
+      std::memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+    }
+  }
+
+  /// @brief Read a batch of datagrams and split them in packets.
+  void
+  read_batch()
+  {
+    m_segments.clear();
+    m_next_segment = 0;
+    for (auto i = 0ul; i < m_batch_size; ++i)
+    {
+      m_rx_iovecs[i] = ::iovec{m_rx_buffer.data() + i * m_rx_slot_size, m_rx_slot_size};
+      auto& hdr = m_rx_messages[i].msg_hdr;
+      hdr = ::msghdr();
+      hdr.msg_iov = &m_rx_iovecs[i];
+      hdr.msg_iovlen = 1;
+      hdr.msg_control = m_rx_controls[i].buffer;
+      hdr.msg_controllen = sizeof(control);
+    }
+
+    const auto res = ::recvmmsg( m_fd, m_rx_messages.data(), static_cast<unsigned int>(m_batch_size)
+                               , MSG_WAITFORONE, nullptr);
+    ++m_nb_receive_calls;
+    if (res < 0)
+    {
+      if (errno == EAGAIN or errno == EWOULDBLOCK or errno == EINTR)
+      {
+        return;
+      }
+      throw std::system_error{errno, std::system_category(), "recvmmsg"};
+    }
+
+    for (auto i = 0ul; i < static_cast<std::size_t>(res); ++i)
+    {
+      const auto& msg = m_rx_messages[i];
+      if (msg.msg_hdr.msg_flags & MSG_TRUNC)
+      {
+        ++m_nb_dropped;
+        continue;
+      }
+      const auto len = static_cast<std::size_t>(msg.msg_len);
+      auto segment_size = len;
+      for (auto cmsg = CMSG_FIRSTHDR(&msg.msg_hdr); cmsg != nullptr
+          ; cmsg = CMSG_NXTHDR(const_cast<::msghdr*>(&msg.msg_hdr), cmsg))
+      {
+        if (cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO)
+        {
+          auto size = 0;
+          std::memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+          segment_size = static_cast<std::size_t>(size);
+        }
+      }
+      const auto data = static_cast<const char*>(m_rx_iovecs[i].iov_base);
+      for (auto offset = std::size_t{0}; offset < len and segment_size != 0; offset += segment_size)
+      {
+        m_segments.push_back(segment{data + offset, std::min(segment_size, len - offset)});
+      }
+    }
+  }
+
+private:
+
+  /// @brief The maximal number of segments in a datagram sent with segmentation offload.
+  static constexpr std::size_t max_segments = 64;
+
+  /// @brief The maximal size of a datagram sent or received with offload.
+  static constexpr std::size_t max_offload_size = 65507;
+
+  /// @brief The socket.
+  const int m_fd;
+
+  /// @brief The maximal number of packets sent or received with one system call.
+  const std::size_t m_batch_size;
+
+  /// @brief The maximal size of a packet.
+  const std::size_t m_packet_size;
+
+  /// @brief The destination of packets, if the socket is not connected.
+  ::sockaddr_storage m_destination;
+
+  /// @brief The size of the destination, 0 if the socket is connected.
+  ::socklen_t m_destination_len;
+
+  /// @brief Tell if segmentation offload is enabled.
+  bool m_gso;
+
+  /// @brief Tell if receive offload is enabled.
+  bool m_gro;
+
+  /// @brief Where writers serialize packets, one after the other.
+  detail::byte_buffer m_tx_buffer;
+
+  /// @brief The number of bytes used in the send buffer.
+  std::size_t m_tx_used;
+
+  /// @brief The size of the packet a writer is serializing.
+  std::size_t m_tx_pending;
+
+  /// @brief The size of each packet in the send buffer.
+  std::vector<std::size_t> m_tx_sizes;
+
+  /// @brief The first packet of each message.
+  std::vector<std::size_t> m_tx_firsts;
+
+  /// @brief The buffer of each message to send.
+  std::vector<::iovec> m_tx_iovecs;
+
+  /// @brief The ancillary data of each message to send.
+  std::vector<control> m_tx_controls;
+
+  /// @brief The messages to send.
+  std::vector<::mmsghdr> m_tx_messages;
+
+  /// @brief The space reserved for each received datagram.
+  std::size_t m_rx_slot_size;
+
+  /// @brief Where datagrams are received.
+  detail::byte_buffer m_rx_buffer;
+
+  /// @brief The buffer of each message to receive.
+  std::vector<::iovec> m_rx_iovecs;
+
+  /// @brief The ancillary data of each message to receive.
+  std::vector<control> m_rx_controls;
+
+  /// @brief The messages to receive.
+  std::vector<::mmsghdr> m_rx_messages;
+
+  /// @brief The received packets.
+  std::vector<segment> m_segments;
+
+  /// @brief The next received packet to give.
+  std::size_t m_next_segment;
+
+  /// @brief Re-use the same memory to give packets to a decoder.
+  std::vector<packet> m_packets;
+
+  /// @brief The number of packets given to the socket.
+  std::size_t m_nb_sent_packets;
+
+  /// @brief The number of calls to sendmmsg().
+  std::size_t m_nb_send_calls;
+
+  /// @brief The number of received packets.
+  std::size_t m_nb_received_packets;
+
+  /// @brief The number of calls to recvmmsg().
+  std::size_t m_nb_receive_calls;
+
+  /// @brief The number of dropped packets.
+  std::size_t m_nb_dropped;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
+
+#endif // defined(__linux__)
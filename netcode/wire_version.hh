@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Describe the version of the wire format of packets.
+///
+/// - v1: repairs carry their symbol twice.
+/// - v2: repairs carry their symbol once.
+/// - v3: like v2, and the decoder answers with cumulative acks.
+/// - v4: like v3, and sets of source identifiers are written as ranges of variable-length
+///   integers.
+/// - v5: like v4, and the repairs sent at the end of a block are marked (see encoder::set_block).
+///
+/// A decoder understands all versions and tells in its acks the highest one it understands. An
+/// encoder starts with the version given by encoder::set_wire_version (v1 by default, understood by
+/// all decoders) and then uses the version advertised by the acks it receives. A decoder sends
+/// cumulative acks once it has received a v3 repair, as only an encoder which knows v3 can read
+/// them, and writes them with the version of the last repair it has received.
+/// @see encoder::set_wire_version
+/// @see encoder::wire_version
+/// @ingroup ntc_encoder
+enum class wire_version : std::uint8_t {v1 = 1, v2 = 2, v3 = 3, v4 = 4, v5 = 5};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
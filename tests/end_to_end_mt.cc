@@ -2,59 +2,59 @@
 #include <functional>
 #include <iostream>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
 #include <netcode/decoder.hh>
 #include <netcode/encoder.hh>
+#include <netcode/packet_ring.hh>
 
 #include "tools/loss/burst.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
 static constexpr auto buffer_sz = 4096ul;
-using queue_type = std::queue<std::vector<char>>;
+static constexpr auto ring_sz = 1024ul;
+static constexpr auto batch_sz = 32ul;
+
+// To serialize output.
+static std::mutex output_mutex;
 
 /*------------------------------------------------------------------------------------------------*/
 
 struct packet_handler
 {
-  std::vector<char> buffer;
+  ntc::packet_ring::writer writer;
   loss::burst& loss;
   bool lost_current_packet;
   std::size_t nb_loss;
-  queue_type& queue;
-  std::mutex& mutex;
+  ntc::packet lost;
 
-  packet_handler(loss::burst& l, queue_type& q, std::mutex& m)
-    : buffer(), loss(l), lost_current_packet(loss()), nb_loss(lost_current_packet ? 1u : 0u)
-    , queue(q), mutex(m)
+  packet_handler(loss::burst& l, ntc::packet_ring& ring)
+    : writer(ring.make_writer()), loss(l), lost_current_packet(loss())
+    , nb_loss(lost_current_packet ? 1u : 0u), lost()
   {
-    buffer.reserve(buffer_sz);
+    lost.reserve(buffer_sz);
   }
 
-  void
-  operator()(const char* src, std::size_t len)
+  char*
+  operator()(std::size_t len)
   {
-    if (not lost_current_packet)
+    if (lost_current_packet)
     {
-      std::copy_n(src, len, std::back_inserter(buffer));
+      lost.resize(len);
+      return lost.data();
     }
+    return writer(len);
   }
 
   void
   operator()()
   {
+    if (not lost_current_packet)
     {
-      std::lock_guard<std::mutex> lock{mutex};
-      if (not lost_current_packet)
-      {
-        queue.push(std::move(buffer));
-      }
+      writer();
     }
-    buffer.clear();
-    buffer.reserve(buffer_sz);
     lost_current_packet = loss();
     nb_loss += lost_current_packet ? 1u : 0u;
   }
@@ -113,68 +113,74 @@ generate_data(std::uint32_t id, std::uint16_t packet_size)
 /*------------------------------------------------------------------------------------------------*/
 
 void
-encoder( queue_type& to_dec, std::mutex& to_dec_mutex, queue_type& to_enc, std::mutex& to_enc_mutex
-       , const bool* run, std::uint16_t packet_size)
+encoder( ntc::packet_ring& to_dec, ntc::packet_ring& to_enc, const bool* run
+       , std::uint16_t packet_size)
 {
   loss::burst loss{85, 15};
-  ntc::encoder<packet_handler> enc{8, packet_handler{loss, to_dec, to_dec_mutex}};
+  ntc::encoder<packet_handler> enc{8, packet_handler{loss, to_dec}};
   std::uint32_t id = 0;
+  std::vector<ntc::packet> acks(batch_sz);
 
   while (*run)
   {
-    enc(generate_data(id++, packet_size));
+    // Wait for the decoder when there's no room left for a source and a repair.
+    if (to_dec.capacity() - to_dec.size() >= 2)
+    {
+      enc(generate_data(id++, packet_size));
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
 
-    // Read ack if any.
+    // Read acks if any.
+    const auto nb = to_enc.pop(acks.begin(), acks.end());
+    for (auto i = 0ul; i < nb; ++i)
     {
-      std::lock_guard<std::mutex> lock{to_enc_mutex};
-      if (not to_enc.empty())
-      {
-        ntc::packet pkt{to_enc.front().data(), to_enc.front().data() + to_enc.front().size()};
-        enc(std::move(pkt));
-        to_enc.pop();
-      }
+      enc(std::move(acks[i]));
     }
   }
 
-  std::lock_guard<std::mutex> out_lock{to_enc_mutex}; // to serialize output
+  std::lock_guard<std::mutex> out_lock{output_mutex};
   std::cout << "Encoder\n";
   std::cout << "Sent " << (id + 1) << '\n';
   std::cout << "Lost " << enc.packet_handler().nb_loss << '\n';
+  std::cout << "Dropped " << to_dec.nb_dropped() << '\n';
   std::cout << '\n';
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-decoder( queue_type& to_dec, std::mutex& to_dec_mutex, queue_type& to_enc, std::mutex& to_enc_mutex
-       , const bool* run, std::uint16_t packet_size)
+decoder( ntc::packet_ring& to_dec, ntc::packet_ring& to_enc, const bool* run
+       , std::uint16_t packet_size)
 {
   loss::burst loss{85, 15};
   ntc::decoder<packet_handler, in_order_data_handler>
-    dec{ 8, ntc::in_order::yes, packet_handler{loss, to_enc, to_enc_mutex}
+    dec{ 8, ntc::in_order::yes, packet_handler{loss, to_enc}
        , in_order_data_handler{packet_size}};
+  std::vector<ntc::packet> packets(batch_sz);
 
   while (*run)
   {
-    // Read source or repair if any.
+    // Read sources and repairs if any.
+    const auto nb = to_dec.pop(packets.begin(), packets.end());
+    if (nb == 0)
     {
-      std::lock_guard<std::mutex> lock{to_dec_mutex};
-      if (not to_dec.empty())
-      {
-        ntc::packet pkt{to_dec.front().data(), to_dec.front().data() + to_dec.front().size()};
-        dec(std::move(pkt));
-        to_dec.pop();
-      }
+      std::this_thread::yield();
+      continue;
     }
+    dec.receive(packets.begin(), packets.begin() + static_cast<std::ptrdiff_t>(nb));
   }
 
-  std::lock_guard<std::mutex> out_lock{to_enc_mutex}; // to serialize output
+  std::lock_guard<std::mutex> out_lock{output_mutex};
   std::cout << "Decoder\n";
   std::cout << "Handled data " << dec.data_handler().nb_received << '\n';
   std::cout << "Received repairs " << dec.nb_received_repairs() << '\n';
   std::cout << "Received sources " << dec.nb_received_sources() << '\n';
   std::cout << "Useless repairs " << dec.nb_useless_repairs() << '\n';
   std::cout << "Decoded " << dec.nb_decoded() << '\n';
+  std::cout << "Dropped acks " << to_enc.nb_dropped() << '\n';
   std::cout << '\n';
 }
 
@@ -213,16 +219,11 @@ int main(int argc, char** argv)
   bool _run = true;
   bool* run = &_run;
 
-  queue_type to_dec;
-  std::mutex to_dec_mutex;
-
-  queue_type to_enc;
-  std::mutex to_enc_mutex;
+  ntc::packet_ring to_dec{ring_sz, buffer_sz};
+  ntc::packet_ring to_enc{ring_sz, buffer_sz};
 
-  std::thread encoder_thread{ encoder, std::ref(to_dec), std::ref(to_dec_mutex), std::ref(to_enc)
-                            , std::ref(to_enc_mutex), run, packet_size};
-  std::thread decoder_thread{ decoder, std::ref(to_dec), std::ref(to_dec_mutex), std::ref(to_enc)
-                            , std::ref(to_enc_mutex), run, packet_size};
+  std::thread encoder_thread{encoder, std::ref(to_dec), std::ref(to_enc), run, packet_size};
+  std::thread decoder_thread{decoder, std::ref(to_dec), std::ref(to_enc), run, packet_size};
 
   std::this_thread::sleep_for(std::chrono::seconds{test_time});
 
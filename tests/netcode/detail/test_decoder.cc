@@ -1,4 +1,5 @@
 #include <algorithm> // equal
+#include <vector>
 
 #include <catch.hpp>
 #include "tests/netcode/launch.hh"
@@ -246,7 +247,7 @@ TEST_CASE("Decoder: drop outdated lost sources")
     REQUIRE(decoder.missing_sources().count(0));
     REQUIRE(decoder.missing_sources().count(1));
     REQUIRE(decoder.repairs().count(0));
-    REQUIRE(decoder.repairs().find(0)->second.source_ids().size() > 0);
+    REQUIRE(decoder.repairs().find(0)->source_ids().size() > 0);
 
     // Now create a repair that drops the 2 first sources due to a limited window size.
     detail::source_list sl1;
@@ -368,12 +369,12 @@ TEST_CASE("Decoder: 2 lost sources from 2 repairs")
     REQUIRE(decoder.repairs().size() == 0);
 
     // Now, check contents.
-    REQUIRE(decoder.sources().find(0)->second.symbol_size() == s0_data.size());
+    REQUIRE(decoder.sources().find(0)->symbol_size() == s0_data.size());
     REQUIRE(std::equal( s0_data.begin(), s0_data.end()
-                      , decoder.sources().find(0)->second.symbol()));
-    REQUIRE(decoder.sources().find(1)->second.symbol_size() == s1_data.size());
+                      , decoder.sources().find(0)->symbol()));
+    REQUIRE(decoder.sources().find(1)->symbol_size() == s1_data.size());
     REQUIRE(std::equal( s1_data.begin(), s1_data.end()
-                      , decoder.sources().find(1)->second.symbol()));
+                      , decoder.sources().find(1)->symbol()));
   });
 }
 
@@ -424,12 +425,12 @@ TEST_CASE("Decoder: several lost sources from several repairs")
     REQUIRE(decoder.repairs().size() == 0);
 
     // Now, check contents.
-    REQUIRE(decoder.sources().find(0)->second.symbol_size() == s0_data.size());
+    REQUIRE(decoder.sources().find(0)->symbol_size() == s0_data.size());
     REQUIRE(std::equal( s0_data.begin(), s0_data.end()
-                      , decoder.sources().find(0)->second.symbol()));
-    REQUIRE(decoder.sources().find(1)->second.symbol_size() == s1_data.size());
+                      , decoder.sources().find(0)->symbol()));
+    REQUIRE(decoder.sources().find(1)->symbol_size() == s1_data.size());
     REQUIRE(std::equal( s1_data.begin(), s1_data.end()
-                      , decoder.sources().find(1)->second.symbol()));
+                      , decoder.sources().find(1)->symbol()));
 
     SECTION("Sources are not outdated")
     {
@@ -492,15 +493,15 @@ TEST_CASE("Decoder: several lost sources from several repairs")
 
 
         // Check contents.
-        REQUIRE(decoder.sources().find(2)->second.symbol_size() == s2_data.size());
+        REQUIRE(decoder.sources().find(2)->symbol_size() == s2_data.size());
         REQUIRE(std::equal( s2_data.begin(), s2_data.end()
-                          , decoder.sources().find(2)->second.symbol()));
-        REQUIRE(decoder.sources().find(3)->second.symbol_size() == s3_data.size());
+                          , decoder.sources().find(2)->symbol()));
+        REQUIRE(decoder.sources().find(3)->symbol_size() == s3_data.size());
         REQUIRE(std::equal( s3_data.begin(), s3_data.end()
-                          , decoder.sources().find(3)->second.symbol()));
-        REQUIRE(decoder.sources().find(4)->second.symbol_size() == s4_data.size());
+                          , decoder.sources().find(3)->symbol()));
+        REQUIRE(decoder.sources().find(4)->symbol_size() == s4_data.size());
         REQUIRE(std::equal( s4_data.begin(), s4_data.end()
-                          , decoder.sources().find(4)->second.symbol()));      }
+                          , decoder.sources().find(4)->symbol()));      }
     }
 
     SECTION("Sources are outdated")
@@ -562,15 +563,15 @@ TEST_CASE("Decoder: several lost sources from several repairs")
       REQUIRE(decoder.repairs().size() == 0);
 
       // Check contents.
-      REQUIRE(decoder.sources().find(2)->second.symbol_size() == s2_data.size());
+      REQUIRE(decoder.sources().find(2)->symbol_size() == s2_data.size());
       REQUIRE(std::equal( s2_data.begin(), s2_data.end()
-                        , decoder.sources().find(2)->second.symbol()));
-      REQUIRE(decoder.sources().find(3)->second.symbol_size() == s3_data.size());
+                        , decoder.sources().find(2)->symbol()));
+      REQUIRE(decoder.sources().find(3)->symbol_size() == s3_data.size());
       REQUIRE(std::equal( s3_data.begin(), s3_data.end()
-                        , decoder.sources().find(3)->second.symbol()));
-      REQUIRE(decoder.sources().find(4)->second.symbol_size() == s4_data.size());
+                        , decoder.sources().find(3)->symbol()));
+      REQUIRE(decoder.sources().find(4)->symbol_size() == s4_data.size());
       REQUIRE(std::equal( s4_data.begin(), s4_data.end()
-                        , decoder.sources().find(4)->second.symbol()));
+                        , decoder.sources().find(4)->symbol()));
     }
   });
 }
@@ -817,9 +818,9 @@ TEST_CASE("Decoder: repair with only one source")
     decoder(mk_decoder_repair(r0));
     REQUIRE(decoder.sources().size() == 1);
     REQUIRE(decoder.sources().count(0));
-    REQUIRE(decoder.sources().find(0)->second.symbol_size() == s0_data.size());
+    REQUIRE(decoder.sources().find(0)->symbol_size() == s0_data.size());
     REQUIRE(std::equal( s0_data.begin(), s0_data.end()
-                      , decoder.sources().find(0)->second.symbol()));
+                      , decoder.sources().find(0)->symbol()));
     REQUIRE(decoder.missing_sources().size() == 0);
     REQUIRE(decoder.repairs().size() == 0);
   });
@@ -984,3 +985,446 @@ TEST_CASE("Outdating repair, but not reffered sources")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder: progressive engine")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    std::vector<std::uint32_t> delivered;
+    detail::encoder encoder{gf_size};
+    detail::decoder decoder{ gf_size
+                           , [&](const detail::decoder_source& src){delivered.push_back(src.id());}
+                           , in_order::yes};
+    decoder.set_engine(decoding_engine::progressive);
+    REQUIRE(decoder.engine() == decoding_engine::progressive);
+
+    // The payloads that should be reconstructed.
+    detail::byte_buffer s0_data{'a','a','a','a'};
+    detail::byte_buffer s1_data{'b','b','b','b','b','b','b','b'};
+    detail::byte_buffer s2_data{'c','c','c','c','c','c','c','c','c','c','c','c'};
+
+    // Push 3 sources.
+    detail::source_list sl;
+    add_source(sl, 0, detail::byte_buffer{s0_data});
+    add_source(sl, 1, detail::byte_buffer{s1_data});
+    add_source(sl, 2, detail::byte_buffer{s2_data});
+
+    // 2 repairs to store encoded sources
+    detail::encoder_repair r0{0};
+    detail::encoder_repair r1{1};
+    encoder(r0, sl);
+    encoder(r1, sl);
+
+    // s1 is received, but it can't be given in order.
+    decoder({1, detail::byte_buffer{s1_data}, s1_data.size()});
+    REQUIRE(delivered.empty());
+
+    // Not enough repairs yet.
+    decoder(mk_decoder_repair(r0));
+    REQUIRE(delivered.empty());
+    REQUIRE(decoder.nb_missing_sources() == 2);
+    REQUIRE(decoder.repairs().empty());
+    REQUIRE(decoder.missing_sources().empty());
+
+    SECTION("Missing sources are decoded when the rank is sufficient")
+    {
+      decoder(mk_decoder_repair(r1));
+      REQUIRE((delivered == std::vector<std::uint32_t>{0, 1, 2}));
+      REQUIRE(decoder.nb_decoded() == 2);
+      REQUIRE(decoder.nb_missing_sources() == 0);
+      REQUIRE(decoder.nb_failed_full_decodings() == 0);
+
+      REQUIRE(decoder.sources().find(0)->symbol_size() == s0_data.size());
+      REQUIRE(std::equal( s0_data.begin(), s0_data.end()
+                        , decoder.sources().find(0)->symbol()));
+      REQUIRE(decoder.sources().find(2)->symbol_size() == s2_data.size());
+      REQUIRE(std::equal( s2_data.begin(), s2_data.end()
+                        , decoder.sources().find(2)->symbol()));
+    }
+
+    SECTION("A duplicate repair is useless")
+    {
+      decoder(mk_decoder_repair(r0));
+      REQUIRE(decoder.nb_useless_repairs() == 1);
+      REQUIRE(decoder.nb_missing_sources() == 2);
+    }
+
+    SECTION("Pending repairs are dropped when the engine changes")
+    {
+      decoder.set_engine(decoding_engine::full);
+      REQUIRE(decoder.nb_missing_sources() == 0);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder: a burst of losses is peeled from repairs that encode one missing source")
+{
+  // With w = 32, sizes are truncated to 16 bits when they are multiplied, thus a size can't always
+  // be decoded from a long chain of repairs.
+  launch({4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    static constexpr auto nb_sources = 64u;
+    const auto symbol = [](std::uint32_t id)
+    {
+      return detail::byte_buffer(id % 8 * 4 + 4, static_cast<char>('a' + id % 26));
+    };
+
+    // Repair k encodes sources 0 to k.
+    detail::source_list sl;
+    detail::encoder encoder{gf_size};
+    std::vector<detail::decoder_repair> repairs;
+    for (auto id = 0u; id < nb_sources; ++id)
+    {
+      add_source(sl, id, symbol(id));
+      detail::encoder_repair r{id};
+      encoder(r, sl);
+      repairs.push_back(mk_decoder_repair(r));
+    }
+
+    std::vector<std::uint32_t> delivered;
+    detail::decoder decoder{ gf_size
+                           , [&](const detail::decoder_source& src)
+                             {
+                               const auto expected = symbol(src.id());
+                               REQUIRE(src.symbol_size() == expected.size());
+                               REQUIRE(std::equal(expected.begin(), expected.end(), src.symbol()));
+                               delivered.push_back(src.id());
+                             }
+                           , in_order::yes};
+
+    // All sources are lost. The last repairs are received first, none of them can be decoded.
+    for (auto id = nb_sources - 1; id > 0; --id)
+    {
+      decoder(std::move(repairs[id]));
+    }
+    REQUIRE(decoder.nb_decoded() == 0);
+    REQUIRE(decoder.missing_sources().size() == nb_sources);
+
+    // Repair 0 gives source 0, which leaves repair 1 with only source 1, and so on.
+    decoder(std::move(repairs[0]));
+    REQUIRE(decoder.nb_decoded() == nb_sources);
+    REQUIRE(decoder.nb_failed_full_decodings() == 0);
+    REQUIRE(decoder.repairs().empty());
+    REQUIRE(decoder.missing_sources().empty());
+    REQUIRE(delivered.size() == nb_sources);
+    for (auto id = 0u; id < nb_sources; ++id)
+    {
+      REQUIRE(delivered[id] == id);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder: the oldest missing sources are decoded before newer ones")
+{
+  // With w = 32, sizes are truncated to 16 bits when they are multiplied, thus a size can't always
+  // be decoded from a long chain of repairs.
+  launch({4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    const auto symbol = [](std::uint32_t id)
+    {
+      return detail::byte_buffer(id * 4 + 4, static_cast<char>('a' + id));
+    };
+
+    // Overlapping bands: r0 and r1 encode sources 0 to 3, r2 encodes sources 2 to 5.
+    detail::source_list sl;
+    detail::encoder encoder{gf_size};
+    for (auto id = 0u; id < 4; ++id)
+    {
+      add_source(sl, id, symbol(id));
+    }
+    detail::encoder_repair r0{0};
+    detail::encoder_repair r1{1};
+    encoder(r0, sl);
+    encoder(r1, sl);
+    sl.pop_front();
+    sl.pop_front();
+    add_source(sl, 4, symbol(4));
+    add_source(sl, 5, symbol(5));
+    detail::encoder_repair r2{2};
+    encoder(r2, sl);
+
+    std::vector<std::uint32_t> delivered;
+    detail::decoder decoder{ gf_size
+                           , [&](const detail::decoder_source& src)
+                             {
+                               const auto expected = symbol(src.id());
+                               REQUIRE(src.symbol_size() == expected.size());
+                               REQUIRE(std::equal(expected.begin(), expected.end(), src.symbol()));
+                               delivered.push_back(src.id());
+                             }
+                           , in_order::no};
+
+    // Sources 0, 1, 4 and 5 are lost, source 3 is late.
+    decoder({2, symbol(2), symbol(2).size()});
+    decoder(mk_decoder_repair(r0));
+    decoder(mk_decoder_repair(r1));
+    decoder(mk_decoder_repair(r2));
+    REQUIRE(decoder.missing_sources().size() == 5);
+    REQUIRE(decoder.repairs().size() == 3);
+
+    // There are less repairs than missing sources, but two of them now only encode sources 0 and 1.
+    decoder({3, symbol(3), symbol(3).size()});
+    REQUIRE(decoder.nb_decoded() == 2);
+    REQUIRE(decoder.nb_failed_full_decodings() == 0);
+    REQUIRE((delivered == std::vector<std::uint32_t>{2, 3, 0, 1}));
+    REQUIRE(decoder.missing_sources().size() == 2);
+    REQUIRE(decoder.missing_sources().count(4));
+    REQUIRE(decoder.missing_sources().count(5));
+    REQUIRE(decoder.repairs().size() == 1);
+    REQUIRE(decoder.repairs().count(2));
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder: first missing source and held sources")
+{
+  for (const auto order : {in_order::no, in_order::yes})
+  {
+    detail::decoder decoder{8, [](const detail::decoder_source&){}, order};
+    const auto add = [&](std::uint32_t id)
+    {
+      decoder(detail::decoder_source{id, detail::byte_buffer{}, 0});
+    };
+    const auto held = [&]
+    {
+      std::vector<std::pair<std::uint32_t, std::uint32_t>> res;
+      for (const auto& r : decoder.held_sources())
+      {
+        res.emplace_back(r.first, r.last);
+      }
+      return res;
+    };
+    using ranges = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+    add(0);
+    add(1);
+    REQUIRE(decoder.first_missing_source() == 2);
+    REQUIRE(decoder.held_sources().empty());
+
+    // Sources 2 and 5 are lost.
+    add(3);
+    add(4);
+    add(6);
+    add(7);
+    REQUIRE(decoder.first_missing_source() == 2);
+    REQUIRE((held() == ranges{{3, 5}, {6, 8}}));
+
+    // Source 5 is late, it merges both ranges.
+    add(5);
+    REQUIRE((held() == ranges{{3, 8}}));
+
+    // Source 2 is late, all sources up to 7 are known.
+    add(2);
+    REQUIRE(decoder.first_missing_source() == 8);
+
+    decoder.clear_held_sources();
+    add(10);
+    REQUIRE((held() == ranges{{10, 11}}));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder releases a closed block once all its sources are known")
+{
+  detail::decoder decoder{8, [](const detail::decoder_source&){}, in_order::yes};
+  const auto add = [&](std::uint32_t id)
+  {
+    decoder(detail::decoder_source{id, detail::byte_buffer{}, 0});
+  };
+
+  // Source 2 is missing.
+  add(0);
+  add(1);
+  add(3);
+  decoder.close_block(4);
+  REQUIRE(decoder.sources().size() == 3);
+
+  add(2);
+  REQUIRE(decoder.sources().size() == 0);
+
+  // Sources of the released block are outdated.
+  add(1);
+  REQUIRE(decoder.sources().size() == 0);
+  add(4);
+  REQUIRE(decoder.sources().size() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder gives up on sources before an identifier")
+{
+  std::vector<std::uint32_t> delivered;
+  detail::decoder decoder{ 8, [&](const detail::decoder_source& src){delivered.push_back(src.id());}
+                         , in_order::yes};
+  std::vector<detail::source_id_range> gaps;
+  decoder.set_gap_callback([&](std::uint32_t first, std::uint32_t last)
+                           {
+                             gaps.push_back(detail::source_id_range{first, last});
+                             // The gap is notified before the sources which follow it.
+                             REQUIRE(delivered.size() == 1);
+                           });
+  const auto add = [&](std::uint32_t id)
+  {
+    decoder(detail::decoder_source{id, detail::byte_buffer{}, 0});
+  };
+
+  // Source 1 is missing.
+  add(0);
+  add(2);
+  add(3);
+  REQUIRE((delivered == std::vector<std::uint32_t>{0}));
+
+  decoder.skip_to(2);
+  REQUIRE((delivered == std::vector<std::uint32_t>{0, 2, 3}));
+  REQUIRE(decoder.first_missing_source() == 4);
+  REQUIRE(decoder.sources().size() == 2);
+  REQUIRE(gaps.size() == 1);
+  REQUIRE(gaps[0].first == 1);
+  REQUIRE(gaps[0].last == 2);
+  REQUIRE(decoder.nb_skipped() == 1);
+
+  // Already given up.
+  decoder.skip_to(1);
+  add(1);
+  REQUIRE(delivered.size() == 3);
+  REQUIRE(decoder.sources().size() == 2);
+  REQUIRE(gaps.size() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder bounds the span of identifiers it keeps track of")
+{
+  std::vector<std::uint32_t> delivered;
+  detail::decoder decoder{ 8, [&](const detail::decoder_source& src){delivered.push_back(src.id());}
+                         , in_order::yes};
+  const auto add = [&](std::uint32_t id)
+  {
+    decoder(detail::decoder_source{id, detail::byte_buffer{}, 0});
+  };
+
+  SECTION("Far ahead source")
+  {
+    // Source 1 is missing.
+    add(0);
+    add(2);
+    // Would give up on all sources, ignored until corroborated.
+    add(100000000);
+    REQUIRE((delivered == std::vector<std::uint32_t>{0}));
+    REQUIRE(decoder.sources().size() == 2);
+    REQUIRE(decoder.first_missing_source() == 1);
+
+    add(100000001);
+    // Sources before the bounded span are given up on, the new one waits for the sources of the
+    // span which precede it.
+    REQUIRE((delivered == std::vector<std::uint32_t>{0, 2}));
+    REQUIRE(decoder.sources().size() == 1);
+    REQUIRE(decoder.first_missing_source() == 100000002 - decoder.max_span());
+
+    // Too far behind.
+    add(3);
+    REQUIRE(delivered.size() == 2);
+    REQUIRE(decoder.sources().size() == 1);
+  }
+
+  SECTION("Isolated far ahead sources")
+  {
+    // Source 1 is missing.
+    add(0);
+    add(2);
+    add(100000000);
+    add(3);
+    // Not near the previous far ahead source, which was followed by a source of the span.
+    add(100000001);
+    add(200000000);
+    REQUIRE((delivered == std::vector<std::uint32_t>{0}));
+    REQUIRE(decoder.sources().size() == 3);
+    REQUIRE(decoder.first_missing_source() == 1);
+  }
+
+  SECTION("Configured span")
+  {
+    decoder.set_max_span(4);
+    REQUIRE(decoder.max_span() == 4);
+    // Source 1 is missing.
+    add(0);
+    add(2);
+    add(3);
+    REQUIRE((delivered == std::vector<std::uint32_t>{0}));
+
+    // Slides the span, source 1 is given up on.
+    add(5);
+    REQUIRE((delivered == std::vector<std::uint32_t>{0, 2, 3}));
+    REQUIRE(decoder.first_missing_source() == 4);
+
+    // Too far behind.
+    add(1);
+    REQUIRE(delivered.size() == 3);
+  }
+
+  SECTION("Wrap around of identifiers")
+  {
+    add(0xfffffff0);
+    add(0xfffffff1);
+    REQUIRE(decoder.sources().size() == 2);
+
+    // Can't be represented.
+    add(0xffffffff);
+    // Identifiers after a wrap around are older ones.
+    add(0);
+    add(5);
+    REQUIRE(decoder.sources().size() == 2);
+    REQUIRE(delivered.empty());
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder bounds the span of repairs it keeps track of")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::source_list sl;
+    detail::encoder encoder{gf_size};
+    add_source(sl, 0, detail::byte_buffer(4, 'a'));
+    add_source(sl, 1, detail::byte_buffer(4, 'b'));
+    detail::encoder_repair r0{0};
+    detail::encoder_repair r1{100000000};
+    detail::encoder_repair r2{100000001};
+    encoder(r0, sl);
+    encoder(r1, sl);
+    encoder(r2, sl);
+
+    detail::decoder decoder{gf_size, [](const detail::decoder_source&){}, in_order::yes};
+
+    // Sources 0 and 1 are lost.
+    decoder(mk_decoder_repair(r0));
+    REQUIRE(decoder.repairs().size() == 1);
+    REQUIRE(decoder.missing_sources().size() == 2);
+
+    // Would drop all repairs, ignored until corroborated.
+    decoder(mk_decoder_repair(r1));
+    REQUIRE(decoder.repairs().size() == 1);
+    REQUIRE(decoder.repairs().count(0));
+
+    // The oldest repair is dropped rather than growing the window of repairs.
+    decoder(mk_decoder_repair(r2));
+    REQUIRE(decoder.repairs().size() == 1);
+    REQUIRE(decoder.repairs().count(100000001));
+    REQUIRE(decoder.missing_sources().size() == 2);
+    REQUIRE(decoder.nb_decoded() == 0);
+
+    // Too far behind.
+    decoder(mk_decoder_repair(r0));
+    REQUIRE(decoder.repairs().size() == 1);
+    REQUIRE(not decoder.repairs().count(0));
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
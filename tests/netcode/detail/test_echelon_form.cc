@@ -0,0 +1,170 @@
+#include <algorithm> // equal
+
+#include <catch.hpp>
+#include "tests/netcode/launch.hh"
+#include "tests/netcode/common.hh"
+
+#include "netcode/detail/echelon_form.hh"
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/source_list.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+bool
+same_symbol(const detail::decoder_source& src, const detail::byte_buffer& data)
+{
+  return src.symbol_size() == data.size()
+     and std::equal(data.begin(), data.end(), src.symbol());
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Echelon form: sources are decoded when the rank is sufficient")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::galois_field gf{gf_size};
+    detail::encoder encoder{gf_size};
+    packet_pool pool;
+    detail::echelon_form ef{gf, pool};
+
+    // The payloads that should be reconstructed.
+    detail::byte_buffer s0_data{'a','a','a','a'};
+    detail::byte_buffer s1_data{'b','b','b','b','b','b','b','b'};
+    detail::byte_buffer s2_data{'c','c','c','c','c','c','c','c','c','c','c','c'};
+
+    // Push 3 sources.
+    detail::source_list sl;
+    add_source(sl, 0, detail::byte_buffer{s0_data});
+    add_source(sl, 1, detail::byte_buffer{s1_data});
+    add_source(sl, 2, detail::byte_buffer{s2_data});
+
+    // 3 repairs to store encoded sources
+    detail::encoder_repair r0{0};
+    detail::encoder_repair r1{1};
+    detail::encoder_repair r2{2};
+    encoder(r0, sl);
+    encoder(r1, sl);
+    encoder(r2, sl);
+
+    SECTION("All sources are missing")
+    {
+      REQUIRE(ef.add(mk_decoder_repair(r0)));
+      REQUIRE(ef.rank() == 1);
+      REQUIRE(ef.nb_missing_sources() == 3);
+      REQUIRE(not ef.has_decoded());
+
+      REQUIRE(ef.add(mk_decoder_repair(r1)));
+      REQUIRE(ef.rank() == 2);
+      REQUIRE(ef.nb_missing_sources() == 3);
+      REQUIRE(not ef.has_decoded());
+
+      REQUIRE(ef.add(mk_decoder_repair(r2)));
+      REQUIRE(ef.rank() == 3);
+      REQUIRE(ef.has_decoded());
+
+      const auto s0 = ef.pop_decoded();
+      const auto s1 = ef.pop_decoded();
+      const auto s2 = ef.pop_decoded();
+      REQUIRE(not ef.has_decoded());
+      REQUIRE(ef.rank() == 0);
+      REQUIRE(ef.nb_missing_sources() == 0);
+
+      REQUIRE(s0.id() == 0);
+      REQUIRE(same_symbol(s0, s0_data));
+      REQUIRE(s1.id() == 1);
+      REQUIRE(same_symbol(s1, s1_data));
+      REQUIRE(s2.id() == 2);
+      REQUIRE(same_symbol(s2, s2_data));
+    }
+
+    SECTION("A duplicate repair is useless")
+    {
+      REQUIRE(ef.add(mk_decoder_repair(r0)));
+      REQUIRE(not ef.add(mk_decoder_repair(r0)));
+      REQUIRE(ef.rank() == 1);
+      REQUIRE(not ef.has_decoded());
+    }
+
+    SECTION("Received sources are removed from rows")
+    {
+      REQUIRE(ef.add(mk_decoder_repair(r0)));
+      REQUIRE(ef.add(mk_decoder_repair(r1)));
+
+      // s0 is the pivot of the first row.
+      ef.remove({0, detail::byte_buffer{s0_data}, s0_data.size()});
+      REQUIRE(ef.rank() == 2);
+      REQUIRE(ef.nb_missing_sources() == 2);
+      REQUIRE(ef.has_decoded());
+
+      // Both s1 and s2 are determined by the two remaining rows.
+      const auto s1 = ef.pop_decoded();
+      const auto s2 = ef.pop_decoded();
+      REQUIRE(not ef.has_decoded());
+      REQUIRE(ef.nb_missing_sources() == 0);
+      REQUIRE(s1.id() == 1);
+      REQUIRE(same_symbol(s1, s1_data));
+      REQUIRE(s2.id() == 2);
+      REQUIRE(same_symbol(s2, s2_data));
+    }
+
+    SECTION("Outdated rows are dropped")
+    {
+      REQUIRE(ef.add(mk_decoder_repair(r0)));
+      REQUIRE(ef.add(mk_decoder_repair(r1)));
+      // Only the row whose pivot is s0 references s0.
+      ef.drop_outdated(1);
+      REQUIRE(ef.rank() == 1);
+      REQUIRE(ef.nb_missing_sources() == 2);
+      REQUIRE(not ef.has_decoded());
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Echelon form: a row which loses its pivot is inserted again")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::galois_field gf{gf_size};
+    detail::encoder encoder{gf_size};
+    packet_pool pool;
+    detail::echelon_form ef{gf, pool};
+
+    detail::byte_buffer s0_data{'a','b','c','d'};
+    detail::byte_buffer s1_data{'e','f','g','h','i','j','k','l'};
+
+    detail::source_list sl;
+    add_source(sl, 0, detail::byte_buffer{s0_data});
+    add_source(sl, 1, detail::byte_buffer{s1_data});
+
+    detail::encoder_repair r0{0};
+    encoder(r0, sl);
+
+    REQUIRE(ef.add(mk_decoder_repair(r0)));
+    REQUIRE(not ef.has_decoded());
+
+    // s0 is the pivot, the row is left with s1 only.
+    ef.remove({0, detail::byte_buffer{s0_data}, s0_data.size()});
+    REQUIRE(ef.rank() == 1);
+    REQUIRE(ef.nb_missing_sources() == 1);
+    REQUIRE(ef.has_decoded());
+
+    const auto s1 = ef.pop_decoded();
+    REQUIRE(s1.id() == 1);
+    REQUIRE(same_symbol(s1, s1_data));
+    REQUIRE(ef.rank() == 0);
+    REQUIRE(ef.nb_missing_sources() == 0);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -1,5 +1,6 @@
 #include <array>
 #include <algorithm>
+#include <vector>
 
 #include <catch.hpp>
 #include "tests/netcode/launch.hh"
@@ -26,3 +27,39 @@ TEST_CASE("Verify operations on single elements")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Rows are multiplied element by element")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::galois_field gf{gf_size};
+    const auto max = gf_size == 32 ? 0xffffffffu : ((1u << gf_size) - 1);
+
+    // Short rows use the scalar arithmetic, longer ones use region kernels, if any.
+    for (const auto len : {3ul, 16ul, 67ul})
+    {
+      std::vector<std::uint32_t> src(len);
+      std::vector<std::uint32_t> dst(len);
+      for (auto i = 0ul; i < len; ++i)
+      {
+        src[i] = static_cast<std::uint32_t>(i * 2654435761u) & max;
+        dst[i] = static_cast<std::uint32_t>(i * 40503u + 1) & max;
+      }
+
+      for (const auto coeff : {1u, 2u, max})
+      {
+        auto product = dst;
+        gf.multiply_row(src.data(), product.data(), len, coeff);
+        auto sum = dst;
+        gf.multiply_add_row(src.data(), sum.data(), len, coeff);
+        for (auto i = 0ul; i < len; ++i)
+        {
+          REQUIRE(product[i] == gf.multiply(src[i], coeff));
+          REQUIRE(sum[i] == (dst[i] ^ gf.multiply(src[i], coeff)));
+        }
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
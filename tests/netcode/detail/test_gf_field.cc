@@ -0,0 +1,105 @@
+#include <random>
+#include <vector>
+
+#include <catch.hpp>
+
+extern "C" {
+#include <gf_complete.h>
+}
+
+#include "netcode/detail/gf_field.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+// Compare a field with gf-complete, the reference implementation.
+template <typename Field>
+void
+check(const Field& field, const std::vector<std::uint32_t>& elements)
+{
+  gf_t gf;
+  REQUIRE(gf_init_easy(&gf, Field::w) != 0);
+  for (const auto x : elements)
+  {
+    if (x != 0)
+    {
+      REQUIRE(field.invert(x) == gf.divide.w32(&gf, 1, x));
+    }
+    for (const auto y : elements)
+    {
+      REQUIRE(field.multiply(x, y) == (x == 0 or y == 0 ? 0 : gf.multiply.w32(&gf, x, y)));
+    }
+
+    // Sizes are multiplied like regions of 2 bytes.
+    __attribute__((aligned(16))) std::uint16_t size
+      = static_cast<std::uint16_t>(x * 2654435761u >> 16);
+    __attribute__((aligned(16))) std::uint16_t expected = 0;
+    gf.multiply_region.w32(&gf, &size, &expected, x, sizeof(size), 0 /* don't add */);
+    REQUIRE(field.multiply_size(size, x) == expected);
+  }
+  gf_free(&gf, 0);
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Field arithmetic gives the same results as gf-complete")
+{
+  SECTION("All elements of GF(2^4)")
+  {
+    std::vector<std::uint32_t> elements;
+    for (auto x = 0u; x < 16; ++x)
+    {
+      elements.push_back(x);
+    }
+    check(detail::gf4{}, elements);
+  }
+
+  SECTION("All elements of GF(2^8)")
+  {
+    std::vector<std::uint32_t> elements;
+    for (auto x = 0u; x < 256; ++x)
+    {
+      elements.push_back(x);
+    }
+    check(detail::gf8{}, elements);
+  }
+
+  SECTION("Some elements of GF(2^16)")
+  {
+    std::mt19937 gen{16};
+    std::vector<std::uint32_t> elements{0, 1, 2, 0xffff, 0xfffe, 0x8000};
+    for (auto i = 0u; i < 128; ++i)
+    {
+      elements.push_back(static_cast<std::uint32_t>(gen()) & 0xffff);
+    }
+    check(detail::gf16{}, elements);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Field coefficients are never 0")
+{
+  for (auto repair_id = 0u; repair_id < 64; ++repair_id)
+  {
+    for (auto src_id = 0u; src_id < 64; ++src_id)
+    {
+      REQUIRE(detail::gf4::coefficient(repair_id, src_id) != 0);
+      REQUIRE(detail::gf4::coefficient(repair_id, src_id) < 16);
+      REQUIRE(detail::gf8::coefficient(repair_id, src_id) != 0);
+      REQUIRE(detail::gf8::coefficient(repair_id, src_id) < 256);
+      REQUIRE(detail::gf16::coefficient(repair_id, src_id) != 0);
+      REQUIRE(detail::gf16::coefficient(repair_id, src_id) < 65536);
+      REQUIRE(detail::gf32::coefficient(repair_id, src_id) != 0);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
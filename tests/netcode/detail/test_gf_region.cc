@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/launch.hh"
+
+extern "C" {
+#include <gf_complete.h>
+}
+
+#include "netcode/detail/galois_field.hh"
+#include "netcode/detail/gf_region.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+// Multiply with gf-complete, the reference implementation.
+std::vector<char>
+reference(std::uint8_t w, const std::vector<char>& src, std::vector<char> dst, std::uint32_t coeff
+         , bool add)
+{
+  gf_t gf;
+  REQUIRE(gf_init_easy(&gf, w) != 0);
+  gf.multiply_region.w32( &gf, const_cast<char*>(src.data()), dst.data(), coeff
+                        , static_cast<int>(src.size()), add ? 1 : 0);
+  gf_free(&gf, 0);
+  return dst;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Region kernels give the same results as gf-complete")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    std::mt19937 gen{static_cast<std::mt19937::result_type>(gf_size)};
+    auto random_bytes = [&](std::size_t len)
+    {
+      std::vector<char> res(len);
+      for (auto& c : res)
+      {
+        c = static_cast<char>(gen());
+      }
+      return res;
+    };
+
+    const auto max = gf_size == 32 ? 0xffffffffu : ((1u << gf_size) - 1);
+    const auto coefficients = std::vector<std::uint32_t>
+      {0, 1, 2, max, max - 1, static_cast<std::uint32_t>(gen()) & max, 0x80000000 & max};
+
+    for (const auto& kernels : detail::gf_region_available())
+    {
+      const auto kernel = kernels.get(gf_size).multiply;
+      if (kernel == nullptr)
+      {
+        continue;
+      }
+      INFO("Kernels " << kernels.name);
+
+      // Cover the main loop and the tail of all vector sizes.
+      for (auto len : {4ul, 16ul, 28ul, 64ul, 100ul, 256ul, 1024ul, 1500ul})
+      {
+        for (const auto coeff : coefficients)
+        {
+          const auto src = random_bytes(len);
+          const auto dst = random_bytes(len);
+          detail::gf_region_coefficient c;
+          detail::gf_region_prepare(c, gf_size, coeff);
+
+          auto res = dst;
+          kernel(c, src.data(), res.data(), len, false);
+          REQUIRE(res == reference(gf_size, src, dst, coeff, false));
+
+          res = dst;
+          kernel(c, src.data(), res.data(), len, true);
+          REQUIRE(res == reference(gf_size, src, dst, coeff, true));
+        }
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Dot product kernels give the same results as gf-complete")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    std::mt19937 gen{static_cast<std::mt19937::result_type>(gf_size)};
+    auto random_bytes = [&](std::size_t len)
+    {
+      std::vector<char> res(len);
+      for (auto& c : res)
+      {
+        c = static_cast<char>(gen());
+      }
+      return res;
+    };
+
+    const auto max = gf_size == 32 ? 0xffffffffu : ((1u << gf_size) - 1);
+    for (const auto& kernels : detail::gf_region_available())
+    {
+      const auto kernel = kernels.get(gf_size).dot_product;
+      if (kernel == nullptr)
+      {
+        continue;
+      }
+      INFO("Kernels " << kernels.name);
+
+      // Sources are shorter, as long, or longer than the destination.
+      for (auto len : {4ul, 28ul, 100ul, 256ul, 1500ul})
+      {
+        for (auto n : {1ul, 2ul, 7ul})
+        {
+          std::vector<std::vector<char>> srcs;
+          std::vector<const char*> ptrs;
+          std::vector<std::size_t> lens;
+          std::vector<detail::gf_region_coefficient> coefficients(n);
+          const auto dst = random_bytes(len);
+          auto expected_add = dst;
+          auto expected = std::vector<char>(len, 0);
+          for (auto i = 0ul; i < n; ++i)
+          {
+            const auto src_len = std::min(len, (len / (i + 1) + 3) & ~std::size_t{3});
+            srcs.emplace_back(random_bytes(src_len));
+            ptrs.emplace_back(srcs.back().data());
+            lens.emplace_back(src_len);
+            const auto coeff = static_cast<std::uint32_t>(gen()) & max;
+            detail::gf_region_prepare(coefficients[i], gf_size, coeff);
+
+            auto padded = srcs.back();
+            padded.resize(len, 0);
+            expected = reference(gf_size, padded, expected, coeff, true);
+            expected_add = reference(gf_size, padded, expected_add, coeff, true);
+          }
+
+          auto res = dst;
+          kernel(coefficients.data(), ptrs.data(), lens.data(), n, res.data(), len, false);
+          REQUIRE(res == expected);
+
+          res = dst;
+          kernel(coefficients.data(), ptrs.data(), lens.data(), n, res.data(), len, true);
+          REQUIRE(res == expected_add);
+        }
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Galois field uses the selected region kernel")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::galois_field gf{gf_size};
+    const auto src = std::vector<char>(64, 3);
+    auto dst = std::vector<char>(64, 0);
+    gf.multiply(src.data(), dst.data(), src.size(), 7);
+    REQUIRE(dst == reference(gf_size, src, std::vector<char>(64, 0), 7, false));
+    gf.multiply_add(src.data(), dst.data(), src.size(), 7);
+    REQUIRE(dst == std::vector<char>(64, 0));
+
+    const char* srcs[] = {src.data(), src.data()};
+    const std::size_t lens[] = {64, 32};
+    const std::uint32_t coeffs[] = {7, 7};
+    gf.dot_product(srcs, lens, coeffs, 2, dst.data(), dst.size());
+    auto expected = reference(gf_size, src, std::vector<char>(64, 0), 7, false);
+    std::fill_n(expected.begin(), 32, 0);
+    REQUIRE(dst == expected);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,156 @@
+#include <cstdint>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "netcode/detail/id_window.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+std::vector<std::uint32_t>
+ids(const detail::id_window<std::uint32_t>& w)
+{
+  auto res = std::vector<std::uint32_t>{};
+  for (auto cit = w.begin(), end = w.end(); cit != end; ++cit)
+  {
+    REQUIRE(*cit == cit.id() * 10);
+    res.push_back(cit.id());
+  }
+  return res;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Values of an id_window are sorted by identifier")
+{
+  auto w = detail::id_window<std::uint32_t>{};
+  REQUIRE(w.empty());
+  REQUIRE(w.begin() == w.end());
+
+  w.emplace(10, 100);
+  w.emplace(12, 120);
+  w.emplace(11, 110);
+  // Smaller than the first identifier.
+  w.emplace(3, 30);
+  REQUIRE(w.size() == 4);
+  REQUIRE((ids(w) == std::vector<std::uint32_t>{3, 10, 11, 12}));
+
+  REQUIRE(w.count(11));
+  REQUIRE(not w.count(4));
+  REQUIRE(not w.count(13));
+  REQUIRE(*w.find(12) == 120);
+  REQUIRE(w.find(2) == nullptr);
+
+  w.erase(3);
+  w.erase(11);
+  w.erase(42);
+  REQUIRE(w.size() == 2);
+  REQUIRE((ids(w) == std::vector<std::uint32_t>{10, 12}));
+
+  w.clear();
+  REQUIRE(w.empty());
+  REQUIRE(w.begin() == w.end());
+  REQUIRE(not w.count(10));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("An id_window slides and grows")
+{
+  auto w = detail::id_window<std::uint32_t>{};
+
+  SECTION("Slide")
+  {
+    // Keep at most 50 values, the ring wraps around several times.
+    for (auto id = 0u; id < 1000; ++id)
+    {
+      w.emplace(id, id * 10);
+      if (id >= 50)
+      {
+        w.erase_before(id - 49);
+      }
+      REQUIRE(w.size() == std::min(id + 1, 50u));
+    }
+    const auto res = ids(w);
+    REQUIRE(res.size() == 50);
+    REQUIRE(res.front() == 950);
+    REQUIRE(res.back() == 999);
+  }
+
+  SECTION("Grow")
+  {
+    // Every third identifier is missing.
+    for (auto id = 0u; id < 1000; ++id)
+    {
+      if (id % 3 != 0)
+      {
+        w.emplace(id, id * 10);
+      }
+    }
+    REQUIRE(w.size() == 666);
+    REQUIRE(not w.count(999));
+    REQUIRE(*w.find(998) == 9980);
+
+    w.erase_before(500);
+    const auto res = ids(w);
+    REQUIRE(res.size() == 333);
+    REQUIRE(res.front() == 500);
+    REQUIRE(res.back() == 998);
+  }
+
+  SECTION("Erase the current value of an iteration")
+  {
+    for (auto id = 0u; id < 200; ++id)
+    {
+      w.emplace(id, id * 10);
+    }
+    for (auto it = w.begin(); it != w.end(); ++it)
+    {
+      if (it.id() % 2 == 0)
+      {
+        w.erase(it.id());
+      }
+    }
+    REQUIRE(w.size() == 100);
+    REQUIRE(ids(w).front() == 1);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("An id_window bounds the span of its identifiers")
+{
+  static constexpr auto max_span = detail::id_window<std::uint32_t>::default_max_span;
+  auto w = detail::id_window<std::uint32_t>{};
+  REQUIRE(w.fits(1000000));
+  REQUIRE(not w.fits(0xffffffff));
+
+  w.emplace(100000, 1000000);
+  REQUIRE(w.fits(100000 + max_span - 1));
+  REQUIRE(not w.fits(100000 + max_span));
+  REQUIRE(w.fits(100001 - max_span));
+  REQUIRE(not w.fits(100000 - max_span));
+  // After a wrap around of identifiers.
+  REQUIRE(not w.fits(0xfffffff0));
+
+  // The span starts again once the window is empty.
+  w.clear();
+  REQUIRE(w.fits(1000000));
+
+  w.set_max_span(10);
+  REQUIRE(w.max_span() == 10);
+  w.emplace(100, 100);
+  REQUIRE(w.end_id() == 101);
+  REQUIRE(w.fits(109));
+  REQUIRE(not w.fits(110));
+}
+
+/*------------------------------------------------------------------------------------------------*/
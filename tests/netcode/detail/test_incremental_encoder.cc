@@ -0,0 +1,122 @@
+#include <algorithm> // all_of, equal
+
+#include <catch.hpp>
+#include "tests/netcode/launch.hh"
+
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/incremental_encoder.hh"
+#include "netcode/detail/source_list.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+// An incremental repair must be the repair the encoder would have generated with the coefficient
+// identifier. The incremental repair might be larger, but then it's padded with 0.
+void
+require_same_repair(const detail::encoder_repair& incremental, const detail::encoder_repair& r)
+{
+  REQUIRE(incremental.source_ids() == r.source_ids());
+  REQUIRE(incremental.encoded_size() == r.encoded_size());
+  REQUIRE(incremental.symbol().size() >= r.symbol().size());
+  REQUIRE(std::equal(r.symbol().begin(), r.symbol().end(), incremental.symbol().begin()));
+  REQUIRE(std::all_of( incremental.symbol().begin() + static_cast<long>(r.symbol().size())
+                     , incremental.symbol().end(), [](char c){return c == 0;}));
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Incremental encoder generates the same repairs as the encoder")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::encoder encoder{gf_size};
+    detail::incremental_encoder incremental{gf_size, 3};
+    REQUIRE(incremental.nb_accumulators() == 3);
+
+    detail::source_list sl;
+    incremental.add(sl.emplace(0, {'a','b','c','d'}));
+    incremental.add(sl.emplace(1, {'e','f','g','h','i','j','k','l'}));
+    incremental.add(sl.emplace(2, {'m','n','o','p'}));
+
+    // Accumulators are built when first used, then rebuilt with a new key as long as the window
+    // still holds the sources of the last repair copied from them.
+    for (auto id = 0u; id < 6; ++id)
+    {
+      detail::encoder_repair r_incremental{id};
+      incremental(r_incremental, sl);
+      REQUIRE(r_incremental.id() == id);
+      REQUIRE(r_incremental.coefficient_id() == id);
+      REQUIRE(not r_incremental.keyed());
+
+      detail::encoder_repair r{id};
+      encoder(r, sl);
+      require_same_repair(r_incremental, r);
+    }
+
+    SECTION("Sources are added after the first repair")
+    {
+      incremental.add(sl.emplace(3, {'q','r','s','t'}));
+
+      detail::encoder_repair r_incremental{7};
+      incremental(r_incremental, sl);
+      REQUIRE(r_incremental.coefficient_id() == 7);
+
+      detail::encoder_repair r{7};
+      encoder(r, sl);
+      require_same_repair(r_incremental, r);
+    }
+
+    SECTION("Accumulators are copied once the window has slid past their last repair")
+    {
+      const auto ids = detail::source_id_list{0, 1, 2};
+      sl.erase( begin(ids), end(ids)
+              , [&](const detail::encoder_source& src){incremental.remove(src);});
+      incremental.add(sl.emplace(3, {'q','r','s','t'}));
+      incremental.add(sl.emplace(4, {'u','v','w','x','y','z'}));
+
+      detail::encoder_repair r_incremental{8};
+      incremental(r_incremental, sl);
+      REQUIRE(r_incremental.coefficient_id() == 5);
+      REQUIRE(r_incremental.keyed());
+
+      detail::encoder_repair r{5};
+      encoder(r, sl);
+      require_same_repair(r_incremental, r);
+
+      SECTION("Unless keyed repairs are not allowed")
+      {
+        detail::encoder_repair r_unkeyed{9};
+        incremental(r_unkeyed, sl, false);
+        REQUIRE(r_unkeyed.coefficient_id() == 9);
+        REQUIRE(not r_unkeyed.keyed());
+
+        detail::encoder_repair r9{9};
+        encoder(r9, sl);
+        require_same_repair(r_unkeyed, r9);
+      }
+    }
+
+    SECTION("Accumulators are rebuilt when their number changes")
+    {
+      incremental.reset(2);
+      incremental.add(sl.emplace(3, {'q','r','s','t'}));
+
+      detail::encoder_repair r_incremental{5};
+      incremental(r_incremental, sl);
+      REQUIRE(r_incremental.coefficient_id() == 5);
+
+      detail::encoder_repair r{5};
+      encoder(r, sl);
+      require_same_repair(r_incremental, r);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
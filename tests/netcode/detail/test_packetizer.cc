@@ -1,4 +1,4 @@
-#include <algorithm> // copy_n
+#include <algorithm> // copy_n, equal, fill_n
 #include <vector>
 
 #include <catch.hpp>
@@ -27,6 +27,62 @@ struct handler
   void operator()() noexcept {} // end of data
 };
 
+/// @brief Takes a whole packet as an array of iovec.
+struct gather_handler
+{
+  std::vector<packet> pkts;
+
+  void
+  operator()(const ::iovec* iov, std::size_t iovcnt)
+  {
+    pkts.emplace_back();
+    for (auto i = 0ul; i < iovcnt; ++i)
+    {
+      const auto data = static_cast<const char*>(iov[i].iov_base);
+      std::copy_n(data, iov[i].iov_len, std::back_inserter(pkts.back()));
+    }
+  }
+};
+
+/// @brief Provides a buffer to serialize a packet into.
+struct buffer_handler
+{
+  std::vector<packet> pkts;
+  bool complete = true;
+
+  char*
+  operator()(std::size_t len)
+  {
+    complete = false;
+    pkts.emplace_back(len);
+    return pkts.back().data();
+  }
+
+  void operator()() noexcept {complete = true;} // end of data
+};
+
+/// @brief Takes each part of a packet as untyped bytes.
+struct void_handler
+{
+  void operator()(const void*, std::size_t) {}
+  void operator()() {}
+};
+
+bool
+same_packet(const packet& lhs, const packet& rhs)
+{
+  return lhs.size() == rhs.size() and std::equal(lhs.data(), lhs.data() + lhs.size(), rhs.data());
+}
+
+static_assert(not detail::is_gather_packet_handler<handler>::value, "");
+static_assert(not detail::is_buffer_packet_handler<handler>::value, "");
+static_assert(detail::is_gather_packet_handler<gather_handler>::value, "");
+static_assert(not detail::is_buffer_packet_handler<gather_handler>::value, "");
+static_assert(not detail::is_gather_packet_handler<buffer_handler>::value, "");
+static_assert(detail::is_buffer_packet_handler<buffer_handler>::value, "");
+static_assert(not detail::is_gather_packet_handler<void_handler>::value, "");
+static_assert(not detail::is_buffer_packet_handler<void_handler>::value, "");
+
 } // namespace unnamed
 
 /*------------------------------------------------------------------------------------------------*/
@@ -43,6 +99,159 @@ TEST_CASE("An ack is (de)serialized by packetizer")
   const auto a_out = serializer.read_ack(std::move(h.pkt)).first;
   REQUIRE(a_in.source_ids() == a_out.source_ids());
   REQUIRE(a_in.nb_packets() == a_out.nb_packets());
+  REQUIRE(not a_out.cumulative());
+  REQUIRE(a_out.version() == wire_version::v5);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("A cumulative ack is (de)serialized by packetizer")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  // The last range is too long to be written at once.
+  serializer.write_ack( detail::ack{ 1000, {{1002, 1010}, {1020, 1021}, {2000, 2000 + 70000}}, 33
+                                   , wire_version::v3}
+                      , wire_version::v3);
+  REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::ack);
+  REQUIRE(detail::get_wire_version(h.pkt) == wire_version::v3);
+  REQUIRE(h.pkt.size() == 1 + 2 + 1 + 4 + 2 + 4 * 6);
+
+  const auto a_out = serializer.read_ack(std::move(h.pkt)).first;
+  REQUIRE(a_out.cumulative());
+  REQUIRE(a_out.nb_packets() == 33);
+  REQUIRE(a_out.version() == wire_version::v3);
+  REQUIRE(a_out.first_missing() == 1000);
+  REQUIRE(a_out.ranges().size() == 4);
+  REQUIRE(a_out.ranges()[0].first == 1002);
+  REQUIRE(a_out.ranges()[0].last == 1010);
+  REQUIRE(a_out.ranges()[1].first == 1020);
+  REQUIRE(a_out.ranges()[1].last == 1021);
+  REQUIRE(a_out.ranges()[2].first == 2000);
+  REQUIRE(a_out.ranges()[3].first == a_out.ranges()[2].last);
+  REQUIRE(a_out.ranges()[3].last == 2000 + 70000);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("A cumulative ack is (de)serialized by packetizer in v4 wire format")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  const auto base = 1u << 20;
+  serializer.write_ack( detail::ack{base, {{base + 2, base + 10}, {2 * base, 3 * base}}, 33}
+                      , wire_version::v4);
+  REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::ack);
+  REQUIRE(detail::get_wire_version(h.pkt) == wire_version::v4);
+  // Ranges are written as gaps and lengths on as few bytes as possible.
+  REQUIRE(h.pkt.size() == 1 + 2 + 1 + 3 + 1 + (1 + 1) + (3 + 3));
+
+  const auto a_out = serializer.read_ack(std::move(h.pkt)).first;
+  REQUIRE(a_out.cumulative());
+  REQUIRE(a_out.nb_packets() == 33);
+  REQUIRE(a_out.version() == wire_version::v5);
+  REQUIRE(a_out.first_missing() == base);
+  REQUIRE(a_out.ranges().size() == 2);
+  REQUIRE(a_out.ranges()[0].first == base + 2);
+  REQUIRE(a_out.ranges()[0].last == base + 10);
+  REQUIRE(a_out.ranges()[1].first == 2 * base);
+  REQUIRE(a_out.ranges()[1].last == 3 * base);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Malformed ranges of a cumulative ack are rejected")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  SECTION("v3")
+  {
+    serializer.write_ack( detail::ack{1000, {{1002, 1010}, {1020, 1021}}, 33, wire_version::v3}
+                        , wire_version::v3);
+    // type | nb_packets | version | first_missing | nb_ranges | (first | length)*
+    const auto valid = h.pkt;
+    REQUIRE(valid.size() == 22);
+    REQUIRE_NOTHROW(serializer.read_ack(packet{valid}));
+
+    // Overlapping ranges.
+    auto p = valid;
+    std::copy_n(p.begin() + 10, 6, p.begin() + 16);
+    REQUIRE_THROWS_AS(serializer.read_ack(std::move(p)), overflow_error);
+
+    // A range before the first missing source.
+    p = valid;
+    std::copy_n(p.begin() + 16, 4, p.begin() + 4);
+    REQUIRE_THROWS_AS(serializer.read_ack(std::move(p)), overflow_error);
+
+    // A range which wraps around.
+    p = valid;
+    std::fill_n(p.begin() + 16, 4, '\xff');
+    REQUIRE_THROWS_AS(serializer.read_ack(std::move(p)), overflow_error);
+  }
+
+  SECTION("v4")
+  {
+    serializer.write_ack(detail::ack{10, {{12, 14}}, 33}, wire_version::v4);
+    // type | nb_packets | version | first_missing | nb_ranges | (gap | length)*
+    const auto valid = h.pkt;
+    REQUIRE(valid.size() == 8);
+    REQUIRE_NOTHROW(serializer.read_ack(packet{valid}));
+
+    // A gap which wraps around.
+    auto p = packet(valid.begin(), valid.begin() + 6);
+    for (const auto c : {'\xff', '\xff', '\xff', '\xff', '\x0f', '\x02'})
+    {
+      p.push_back(c);
+    }
+    REQUIRE_THROWS_AS(serializer.read_ack(std::move(p)), overflow_error);
+
+    // A length which wraps around.
+    p = packet(valid.begin(), valid.begin() + 7);
+    for (const auto c : {'\xff', '\xff', '\xff', '\xff', '\x0f'})
+    {
+      p.push_back(c);
+    }
+    REQUIRE_THROWS_AS(serializer.read_ack(std::move(p)), overflow_error);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("A v3 cumulative ack leaves out the ranges which don't fit")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  auto ranges = std::vector<detail::source_id_range>{};
+  for (auto i = 0u; i < 70000; ++i)
+  {
+    ranges.push_back(detail::source_id_range{2 * i + 1, 2 * i + 2});
+  }
+  serializer.write_ack(detail::ack{0, std::move(ranges), 33, wire_version::v3}, wire_version::v3);
+
+  const auto a_out = serializer.read_ack(std::move(h.pkt)).first;
+  REQUIRE(a_out.ranges().size() == 65535);
+  REQUIRE(a_out.ranges().back().first == 2 * 65534 + 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("An ack without version is read as a v1 ack")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  serializer.write_ack(detail::ack{{0,1,2,3}, 33});
+  // Remove the trailing version, like a decoder which only knows v1 would do.
+  h.pkt.resize(h.pkt.size() - 1);
+
+  const auto res = serializer.read_ack(std::move(h.pkt));
+  REQUIRE((res.first.source_ids() == detail::source_id_list{0,1,2,3}));
+  REQUIRE(res.first.nb_packets() == 33);
+  REQUIRE(res.first.version() == wire_version::v1);
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -113,6 +322,132 @@ TEST_CASE("A repair is (de)serialized by packetizer")
     REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
   }
 
+  SECTION("Repair with a coefficient identifier")
+  {
+    detail::encoder_repair r_in{ 42, 54, {1,2,3,4}, detail::zero_byte_buffer{'a', 'b', 'c'}};
+    r_in.coefficient_id() = 42;
+    r_in.keyed() = true;
+    serializer.write_repair(r_in, wire_version::v4);
+    // The flag decides, even if the coefficient identifier is the repair's own.
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::keyed_repair);
+
+    const auto r_out = serializer.read_repair(std::move(h.pkt)).first;
+    REQUIRE(r_in.id() == r_out.id());
+    REQUIRE(r_in.coefficient_id() == r_out.coefficient_id());
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(r_in.encoded_size() == r_out.encoded_size());
+    REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
+  }
+
+  SECTION("Repair in v2 wire format")
+  {
+    const detail::encoder_repair r_in{42, 54, {1,2,3,4}, detail::zero_byte_buffer(100, 'a')};
+    serializer.write_repair(r_in, wire_version::v1);
+    const auto v1_size = h.pkt.size();
+    h.pkt.resize(0);
+    serializer.write_repair(r_in, wire_version::v2);
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::repair);
+    REQUIRE(detail::get_wire_version(h.pkt) == wire_version::v2);
+    // Only the symbol and its size are no longer duplicated.
+    REQUIRE(h.pkt.size() == v1_size - 100 - sizeof(std::uint16_t));
+
+    const auto res = serializer.read_repair(std::move(h.pkt));
+    REQUIRE(res.second == v1_size - 100 - sizeof(std::uint16_t));
+    const auto& r_out = res.first;
+    REQUIRE(r_in.id() == r_out.id());
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(r_in.encoded_size() == r_out.encoded_size());
+    REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
+  }
+
+  SECTION("Keyed repair in v2 wire format")
+  {
+    detail::encoder_repair r_in{ 42, 54, {1,2,3,4}, detail::zero_byte_buffer{'a', 'b', 'c'}};
+    r_in.coefficient_id() = 3;
+    r_in.keyed() = true;
+    serializer.write_repair(r_in, wire_version::v2);
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::keyed_repair);
+    REQUIRE(detail::get_wire_version(h.pkt) == wire_version::v2);
+
+    const auto r_out = serializer.read_repair(std::move(h.pkt)).first;
+    REQUIRE(r_in.id() == r_out.id());
+    REQUIRE(r_in.coefficient_id() == r_out.coefficient_id());
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
+  }
+
+  SECTION("Repair in v4 wire format")
+  {
+    const auto base = 1u << 21;
+    const detail::encoder_repair r_in{ 42, 54, {base, base + 1, base + 2, base + 100, base + 101}
+                                     , detail::zero_byte_buffer(100, 'a')};
+    serializer.write_repair(r_in, wire_version::v2);
+    const auto v2_size = h.pkt.size();
+    h.pkt.resize(0);
+    serializer.write_repair(r_in, wire_version::v4);
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::repair);
+    REQUIRE(detail::get_wire_version(h.pkt) == wire_version::v4);
+    // v2: [nb elements (2) | first id (4) | 3 * (run (1) | delta (2))]
+    // v4: [nb ranges (1) | gap (4) | length (1) | gap (1) | length (1)]
+    REQUIRE(h.pkt.size() == v2_size - 15 + 8);
+
+    const auto res = serializer.read_repair(std::move(h.pkt));
+    REQUIRE(res.second == v2_size - 7);
+    const auto& r_out = res.first;
+    REQUIRE(r_in.id() == r_out.id());
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(r_in.encoded_size() == r_out.encoded_size());
+    REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
+  }
+
+  SECTION("Repair dropped before its source ids are read")
+  {
+    for (const auto version : {wire_version::v2, wire_version::v4})
+    {
+      detail::encoder_repair r_in{ 42, 54, {1,2,3,7,8}, detail::zero_byte_buffer{'a', 'b', 'c'}};
+      r_in.coefficient_id() = 3;
+      r_in.keyed() = true;
+      serializer.write_repair(r_in, version);
+      const auto size = h.pkt.size();
+
+      auto ranges = std::vector<std::pair<std::uint32_t, std::uint32_t>>{};
+      const auto res = serializer.read_repair( std::move(h.pkt)
+                                             , [&]( std::uint32_t id
+                                                  , const std::vector<detail::source_id_range>& rs)
+                                               {
+                                                 REQUIRE(id == 42);
+                                                 for (const auto& r : rs)
+                                                 {
+                                                   ranges.emplace_back(r.first, r.last);
+                                                 }
+                                                 return true;
+                                               });
+      REQUIRE(not res.first);
+      REQUIRE(res.second == size);
+      REQUIRE((ranges == std::vector<std::pair<std::uint32_t, std::uint32_t>>{{1, 4}, {7, 9}}));
+      h.pkt.resize(0);
+    }
+  }
+
+  SECTION("Repair at the end of a block")
+  {
+    const detail::encoder_repair r_in{42, 54, {1,2,3,4}, detail::zero_byte_buffer{'a', 'b', 'c'}};
+
+    // Only marked from v5.
+    serializer.write_repair(r_in, wire_version::v4, true);
+    REQUIRE(not detail::ends_block(h.pkt));
+    h.pkt.resize(0);
+
+    serializer.write_repair(r_in, wire_version::v5, true);
+    REQUIRE(detail::ends_block(h.pkt));
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::repair);
+    REQUIRE(detail::get_wire_version(h.pkt) == wire_version::v5);
+
+    const auto r_out = serializer.read_repair(std::move(h.pkt)).first;
+    REQUIRE(r_in.id() == r_out.id());
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+  }
+
   SECTION("Repair with only one source")
   {
     const detail::encoder_repair r_in{ 0, 33, {4242}, detail::zero_byte_buffer{'x'}};
@@ -133,7 +468,8 @@ TEST_CASE("A source is (de)serialized by packetizer")
   handler h;
   detail::packetizer<handler> serializer{h};
 
-  const detail::encoder_source s_in{394839, {'a', 'b', 'c', 'd'}};
+  const auto data = detail::byte_buffer{'a', 'b', 'c', 'd'};
+  const detail::encoder_source s_in{394839, data.data(), 4};
 
   serializer.write_source(s_in);
 
@@ -146,7 +482,7 @@ TEST_CASE("A source is (de)serialized by packetizer")
   const auto s_out = serializer.read_source(std::move(h.pkt)).first;
   REQUIRE(s_in.id() == s_out.id());
   REQUIRE(s_in.size() == s_out.symbol_size());
-  REQUIRE(std::equal(s_in.symbol().begin(), s_in.symbol().end(), s_out.symbol()));
+  REQUIRE(std::equal(data.begin(), data.end(), s_out.symbol()));
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -229,3 +565,91 @@ TEST_CASE("Prevent buffer overflow")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Prevent oversized ranges of source ids")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  const detail::encoder_repair r_in{42, 54, {1,2,3,4}, detail::zero_byte_buffer{'a', 'b'}};
+  serializer.write_repair(r_in, wire_version::v4);
+
+  // [header (7) | symbol (2) | nb ranges (1) | gap (1) | length (1) | encoded size (2)]
+  REQUIRE(h.pkt.size() == 14);
+  auto crafted = std::vector<char>(h.pkt.begin(), h.pkt.begin() + 9);
+
+  SECTION("Range too long")
+  {
+    // A length of 2^32 - 1 sources.
+    crafted.insert(crafted.end(), {1, 1, '\xff', '\xff', '\xff', '\xff', 0x0f, 0, 54});
+    REQUIRE_THROWS_AS( serializer.read_repair(packet{begin(crafted), end(crafted)})
+                     , overflow_error);
+  }
+
+  SECTION("Integer too long")
+  {
+    crafted.insert(crafted.end(), {'\xff', '\xff', '\xff', '\xff', '\xff', '\xff', 1, 4, 0, 54});
+    REQUIRE_THROWS_AS( serializer.read_repair(packet{begin(crafted), end(crafted)})
+                     , overflow_error);
+  }
+
+  SECTION("Truncated integer")
+  {
+    crafted.insert(crafted.end(), {1, '\x81'});
+    REQUIRE_THROWS_AS( serializer.read_repair(packet{begin(crafted), end(crafted)})
+                     , overflow_error);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("All packet handler concepts receive the same packets")
+{
+  handler h;
+  gather_handler gh;
+  buffer_handler bh;
+  detail::packetizer<handler> serializer{h};
+  detail::packetizer<gather_handler> gather_serializer{gh};
+  detail::packetizer<buffer_handler> buffer_serializer{bh};
+
+  const auto data = detail::byte_buffer{'a', 'b', 'c', 'd'};
+  const auto s = detail::encoder_source{394839, data.data(), 4};
+  const auto r = detail::encoder_repair{42, 42, {1,2,3,4,8,9}, detail::zero_byte_buffer(100, 'x')};
+  const auto a = detail::ack{{0,1,2,3}, 33};
+
+  SECTION("Source")
+  {
+    serializer.write_source(s);
+    gather_serializer.write_source(s);
+    buffer_serializer.write_source(s);
+  }
+
+  SECTION("Repair")
+  {
+    serializer.write_repair(r);
+    gather_serializer.write_repair(r);
+    buffer_serializer.write_repair(r);
+  }
+
+  SECTION("Repair in v2 wire format")
+  {
+    serializer.write_repair(r, wire_version::v2);
+    gather_serializer.write_repair(r, wire_version::v2);
+    buffer_serializer.write_repair(r, wire_version::v2);
+  }
+
+  SECTION("Ack")
+  {
+    serializer.write_ack(a);
+    gather_serializer.write_ack(a);
+    buffer_serializer.write_ack(a);
+  }
+
+  REQUIRE(gh.pkts.size() == 1);
+  REQUIRE(bh.pkts.size() == 1);
+  REQUIRE(bh.complete);
+  REQUIRE(same_packet(gh.pkts.front(), h.pkt));
+  REQUIRE(same_packet(bh.pkts.front(), h.pkt));
+}
+
+/*------------------------------------------------------------------------------------------------*/
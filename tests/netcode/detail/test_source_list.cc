@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <cstdint>
+#include <vector>
 
 #include <catch.hpp>
 
@@ -113,6 +115,44 @@ TEST_CASE("add and remove sources in source_list")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Remove ranges of sources from source_list")
+{
+  auto sl = detail::source_list{};
+  for (auto id = 0u; id < 10; ++id)
+  {
+    sl.emplace(id, detail::byte_buffer{});
+  }
+
+  auto removed = std::vector<std::uint32_t>{};
+  const auto remove = [&](const detail::encoder_source& src){removed.push_back(src.id());};
+
+  sl.erase(3, 6, remove);
+  REQUIRE((removed == std::vector<std::uint32_t>{3, 4, 5}));
+  REQUIRE(sl.size() == 7);
+  REQUIRE(not contains_id(sl, 3));
+  REQUIRE(contains_id(sl, 6));
+
+  // Already removed sources are ignored.
+  removed.clear();
+  sl.erase(2, 8, remove);
+  REQUIRE((removed == std::vector<std::uint32_t>{2, 6, 7}));
+  REQUIRE(sl.size() == 4);
+
+  removed.clear();
+  sl.erase_before(2, remove);
+  REQUIRE((removed == std::vector<std::uint32_t>{0, 1}));
+  REQUIRE(sl.size() == 2);
+  REQUIRE(sl.front().id() == 8);
+
+  // Beyond the last source.
+  removed.clear();
+  sl.erase_before(100, remove);
+  REQUIRE((removed == std::vector<std::uint32_t>{8, 9}));
+  REQUIRE(sl.size() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Error scenario")
 {
   auto sl = detail::source_list{};
@@ -123,3 +163,96 @@ TEST_CASE("Error scenario")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Sources survive the growth and the compaction of the ring")
+{
+  auto sl = detail::source_list{};
+  sl.reserve(4);
+
+  const auto symbol = [](std::uint32_t id)
+  {
+    return detail::byte_buffer(id % 40 + 1, static_cast<char>('a' + id % 26));
+  };
+
+  const auto check = [&]
+  {
+    for (auto cit = sl.cbegin(), end = sl.cend(); cit != end; ++cit)
+    {
+      const auto expected = symbol(cit->id());
+      REQUIRE((reinterpret_cast<std::uintptr_t>(cit->symbol()) % 16) == 0);
+      REQUIRE(cit->size() == expected.size());
+      REQUIRE(std::equal(expected.begin(), expected.end(), cit->symbol()));
+    }
+  };
+
+  SECTION("Acknowledge every other source")
+  {
+    // A source is never acknowledged, its slot remains at the beginning of the ring.
+    for (auto id = 0u; id < 200; ++id)
+    {
+      sl.emplace(id, symbol(id));
+      if (id % 2 == 0 and id != 0)
+      {
+        const auto ids = detail::source_id_list{id - 1, id};
+        sl.erase(begin(ids), end(ids));
+      }
+      check();
+    }
+    REQUIRE(sl.size() == 2);
+    REQUIRE(sl.front().id() == 0);
+    REQUIRE(contains_id(sl, 199));
+  }
+
+  SECTION("Drop sources in order")
+  {
+    for (auto id = 0u; id < 200; ++id)
+    {
+      if (sl.size() == 4)
+      {
+        sl.pop_front();
+      }
+      sl.emplace(id, symbol(id));
+      check();
+    }
+    REQUIRE(sl.size() == 4);
+    REQUIRE(sl.front().id() == 196);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("A symbol written in place is not moved before it's committed")
+{
+  auto sl = detail::source_list{};
+  for (auto id = 0u; id < 8; ++id)
+  {
+    sl.emplace(id, detail::byte_buffer(32, 'x'));
+  }
+
+  const auto buffer = sl.prepare(64);
+  REQUIRE((reinterpret_cast<std::uintptr_t>(buffer) % 16) == 0);
+  std::fill_n(buffer, 48, 'y');
+
+  // Neither acknowledgments nor evictions move the prepared slot.
+  const auto ids = detail::source_id_list{5, 6, 7};
+  sl.erase(begin(ids), end(ids));
+  sl.pop_front();
+
+  const auto& src = sl.commit(8, 48);
+  REQUIRE(static_cast<const void*>(src.symbol()) == static_cast<const void*>(buffer));
+  REQUIRE(src.size() == 48);
+  REQUIRE(sl.size() == 5);
+  REQUIRE(std::all_of(src.symbol(), src.symbol() + 48, [](char c){return c == 'y';}));
+
+  // Erased slots are skipped.
+  auto nb = 0u;
+  for (auto cit = sl.cbegin(), end = sl.cend(); cit != end; ++cit)
+  {
+    ++nb;
+  }
+  REQUIRE(nb == 5);
+  REQUIRE(contains_id(sl, 8));
+  REQUIRE(not contains_id(sl, 6));
+}
+
+/*------------------------------------------------------------------------------------------------*/
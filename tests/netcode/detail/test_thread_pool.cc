@@ -0,0 +1,52 @@
+#include <atomic>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "netcode/detail/thread_pool.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Thread pool runs each task once")
+{
+  detail::thread_pool pool{4};
+  REQUIRE(pool.size() == 4);
+
+  for (const auto nb_tasks : {0ul, 1ul, 3ul, 100ul})
+  {
+    std::vector<std::atomic<unsigned int>> runs(nb_tasks);
+    for (auto& r : runs)
+    {
+      r = 0;
+    }
+    std::vector<std::atomic<bool>> busy_slots(pool.size());
+    for (auto& b : busy_slots)
+    {
+      b = false;
+    }
+    std::atomic<bool> shared_slot{false};
+
+    pool.run(nb_tasks, [&](std::size_t task, std::size_t slot)
+    {
+      if (slot >= busy_slots.size() or busy_slots[slot].exchange(true))
+      {
+        shared_slot = true;
+        return;
+      }
+      ++runs[task];
+      busy_slots[slot] = false;
+    });
+
+    REQUIRE(not shared_slot);
+    for (const auto& r : runs)
+    {
+      REQUIRE(r == 1);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -8,7 +8,9 @@
 
 #include "netcode/decoder.hh"
 #include "netcode/encoder.hh"
+#include "netcode/detail/encoder.hh"
 #include "netcode/detail/packet_type.hh"
+#include "netcode/detail/packetizer.hh"
 
 #include <iostream>
 
@@ -164,6 +166,159 @@ TEST_CASE("Decoder generate acks when N packets are received")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Decoder repairs lost sources from incremental repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(2).set_nb_accumulators(3);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_frequency(std::chrono::milliseconds{0});
+
+    auto& enc_packet_handler = enc.packet_handler();
+    auto& dec_packet_handler = dec.packet_handler();
+    auto& dec_data_handler = dec.data_handler();
+
+    std::vector<std::vector<char>> sources;
+    for (auto i = 0; i < 8; ++i)
+    {
+      sources.emplace_back(8, static_cast<char>('a' + i));
+    }
+
+    // All sources should be given to the user, in order.
+    const auto check = [&]
+    {
+      REQUIRE(dec.nb_missing_sources() == 0);
+      REQUIRE(dec_data_handler.nb_data() == 8);
+      for (auto i = 0ul; i < 8; ++i)
+      {
+        REQUIRE(dec_data_handler[i] == sources[i]);
+      }
+    };
+
+    SECTION("Without acks")
+    {
+      for (const auto& s : sources)
+      {
+        enc(data{begin(s), end(s)});
+      }
+      // 8 sources and 4 repairs, interleaved.
+      REQUIRE(enc_packet_handler.nb_packets() == 12);
+      // The 4th repair would reuse the first accumulator, which still shares sources with the
+      // window: it's rebuilt with the repair's own identifier.
+      REQUIRE(detail::get_packet_type(enc_packet_handler[2]) == detail::packet_type::repair);
+      REQUIRE(detail::get_packet_type(enc_packet_handler[11]) == detail::packet_type::repair);
+
+      // Lose s1, s2 and s5.
+      for (const auto i : {0, 2, 4, 5, 6, 8, 9, 10, 11})
+      {
+        dec(enc_packet_handler[static_cast<std::size_t>(i)]);
+      }
+      check();
+    }
+
+    SECTION("More sources than accumulators are lost")
+    {
+      enc.set_nb_accumulators(1).set_wire_version(wire_version::v5);
+      for (const auto& s : sources)
+      {
+        enc(data{begin(s), end(s)});
+      }
+      REQUIRE(enc_packet_handler.nb_packets() == 12);
+
+      // Lose s1, s2 and s5: the repairs copied from the same accumulator are independent.
+      for (const auto i : {0, 2, 4, 5, 6, 8, 9, 10, 11})
+      {
+        dec(enc_packet_handler[static_cast<std::size_t>(i)]);
+      }
+      check();
+    }
+
+    SECTION("With acks")
+    {
+      for (auto i = 0ul; i < 4; ++i)
+      {
+        enc(data{begin(sources[i]), end(sources[i])});
+      }
+      // Lose s1.
+      for (const auto i : {0, 2, 3, 4, 5})
+      {
+        dec(enc_packet_handler[static_cast<std::size_t>(i)]);
+      }
+      REQUIRE(dec.nb_decoded() == 1);
+
+      // Sources 0 to 3 are now acknowledged and subtracted from accumulators.
+      dec.generate_ack();
+      enc(dec_packet_handler[0]);
+      REQUIRE(enc.window() == 0);
+
+      for (auto i = 4ul; i < 8; ++i)
+      {
+        enc(data{begin(sources[i]), end(sources[i])});
+      }
+      REQUIRE(enc_packet_handler.nb_packets() == 12);
+      // The window has slid past the sources of the 1st repair: the 4th one copies its accumulator.
+      REQUIRE(detail::get_packet_type(enc_packet_handler[11]) == detail::packet_type::keyed_repair);
+
+      // Lose s5 and s6.
+      for (const auto i : {6, 8, 10, 11})
+      {
+        dec(enc_packet_handler[static_cast<std::size_t>(i)]);
+      }
+      check();
+    }
+
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder repairs lost sources from banded repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(2).set_band_width(4);
+
+    // An in order decoder would give up s2 as soon as a band no longer encodes it.
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::no, packet_handler{}
+                                             , data_handler{}};
+
+    auto& enc_packet_handler = enc.packet_handler();
+    auto& dec_data_handler = dec.data_handler();
+
+    std::vector<std::vector<char>> sources;
+    for (auto i = 0; i < 8; ++i)
+    {
+      sources.emplace_back(8, static_cast<char>('a' + i));
+    }
+    for (const auto& s : sources)
+    {
+      enc(data{begin(s), end(s)});
+    }
+    // 8 sources and 4 repairs, interleaved. Repairs encode sources {0,1}, {0..3}, {2..5}, {4..7}.
+    REQUIRE(enc_packet_handler.nb_packets() == 12);
+
+    // Lose s2, s5 and the repair of {0..3}. The repair of {4..7} rebuilds s5, which leaves the
+    // repair of {2..5} with s2 only, even though s2 is older than the last band.
+    for (const auto i : {0, 1, 2, 4, 6, 8, 9, 10, 11})
+    {
+      dec(enc_packet_handler[static_cast<std::size_t>(i)]);
+    }
+    REQUIRE(dec.nb_decoded() == 2);
+    REQUIRE(dec.nb_missing_sources() == 0);
+    REQUIRE(dec_data_handler.nb_data() == 8);
+    for (auto i = 0ul; i < 8; ++i)
+    {
+      REQUIRE(std::count(begin(sources), end(sources), dec_data_handler[i]) == 1);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 test_case_0(ntc::in_order order)
 {
@@ -238,7 +393,7 @@ TEST_CASE("Out of order decoder: lost packet with an encoder's limited window")
 /*------------------------------------------------------------------------------------------------*/
 
 void
-test_non_systematic(ntc::in_order order)
+test_non_systematic(ntc::in_order order, ntc::decoding_engine engine = ntc::decoding_engine::full)
 {
   launch({8,16,32}, [&](std::uint8_t gf_size)
   {
@@ -248,6 +403,7 @@ test_non_systematic(ntc::in_order order)
 
     decoder<packet_handler, data_handler> dec{gf_size, order, packet_handler{}, data_handler{}};
     dec.set_ack_frequency(std::chrono::milliseconds{0});
+    dec.set_decoding_engine(engine);
 
     auto& enc_handler = enc.packet_handler();
     auto& dec_data_handler = dec.data_handler();
@@ -352,6 +508,16 @@ TEST_CASE("Out of order decoder: non systematic code")
   test_non_systematic(ntc::in_order::no);
 }
 
+TEST_CASE("In order progressive decoder: non systematic code")
+{
+  test_non_systematic(ntc::in_order::yes, ntc::decoding_engine::progressive);
+}
+
+TEST_CASE("Out of order progressive decoder: non systematic code")
+{
+  test_non_systematic(ntc::in_order::no, ntc::decoding_engine::progressive);
+}
+
 /*------------------------------------------------------------------------------------------------*/
 
 TEST_CASE("Decoder invalid read scenario")
@@ -690,8 +856,453 @@ TEST_CASE("Decoder rejects ack")
 
     SECTION("Garbage")
     {
-      REQUIRE_THROWS_AS(dec(packet{33,35,1,0}), packet_type_error);
+      // An unknown version of the wire format.
+      REQUIRE_THROWS_AS(dec(packet{113,35,1,0}), packet_type_error);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder receives a batch of packets")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(4);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_frequency(std::chrono::milliseconds{0});
+    dec.set_ack_nb_packets(4);
+
+    const auto d = std::vector<char>(32, 'x');
+    enc.commit(std::vector<data>(8, data(d.begin(), d.end())));
+    REQUIRE(enc.packet_handler().nb_packets() == 10);
+
+    // Lose the second source.
+    auto batch = std::vector<packet>{};
+    for (auto i = 0ul; i < 10; ++i)
+    {
+      if (i != 1)
+      {
+        batch.push_back(enc.packet_handler()[i]);
+      }
     }
+
+    REQUIRE(dec.receive(batch) > 0);
+    REQUIRE(dec.nb_received_sources() == 7);
+    REQUIRE(dec.nb_received_repairs() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 8);
+
+    // Only one ack for the whole batch.
+    REQUIRE(dec.nb_sent_acks() == 1);
+    REQUIRE(dec.packet_handler().nb_packets() == 1);
+    enc(dec.packet_handler()[0]);
+    REQUIRE(enc.window() == 0);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder rebuilds sources on several threads")
+{
+  // GF(2^4) doesn't have enough coefficients for a system of 32 sources.
+  launch({8,16}, [](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(1000);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_decoding_threads(4);
+    REQUIRE(dec.decoding_threads() == 4);
+
+    // Large enough for the sources to be rebuilt in parallel.
+    std::vector<std::vector<char>> sources;
+    for (auto i = 0; i < 32; ++i)
+    {
+      sources.emplace_back(4096 - 2 * i, static_cast<char>('a' + i));
+      enc(data{begin(sources.back()), end(sources.back())});
+    }
+    for (auto i = 0; i < 32; ++i)
+    {
+      enc.generate_repair();
+    }
+    REQUIRE(enc.packet_handler().nb_packets() == 64);
+
+    // Lose all sources.
+    for (auto i = 32ul; i < 64; ++i)
+    {
+      dec(enc.packet_handler()[i]);
+    }
+    REQUIRE(dec.nb_decoded() == 32);
+    REQUIRE(dec.data_handler().nb_data() == 32);
+    for (auto i = 0ul; i < 32; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == sources[i]);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder reuses the buffers of dropped packets")
+{
+  // Sizes decoded with GF(2^32) are truncated to 16 bits and can be wrong.
+  launch({4,8,16}, [](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(4).set_window_size(8);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_frequency(std::chrono::milliseconds{0});
+
+    const auto d = std::vector<char>(64, 'x');
+    for (auto i = 0; i < 200; ++i)
+    {
+      enc(data{d.begin(), d.end()});
+    }
+
+    // Receive packets in buffers of the decoder's pool, lose one source out of 4.
+    const auto& packets = enc.packet_handler();
+    auto nb_allocations = std::size_t{0};
+    for (auto i = 0ul; i < packets.nb_packets(); ++i)
+    {
+      if (i % 5 == 1)
+      {
+        continue;
+      }
+      if (i == packets.nb_packets() / 2)
+      {
+        nb_allocations = dec.pool().nb_allocations();
+      }
+      const auto& p = packets[i];
+      auto pkt = packet{dec.pool(), p.size()};
+      std::copy(p.begin(), p.end(), pkt.begin());
+      dec(std::move(pkt));
+    }
+    REQUIRE(dec.data_handler().nb_data() == 200);
+    for (auto i = 0ul; i < 200; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == d);
+    }
+
+    // In the steady state, buffers are recycled.
+    REQUIRE(dec.pool().nb_allocations() == nb_allocations);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder sends cumulative acks to an encoder which understands them")
+{
+  for (const auto version : {wire_version::v3, wire_version::v4})
+  {
+    // Sizes decoded with GF(2^32) are truncated to 16 bits and can be wrong.
+    launch({4,8,16}, [&](std::uint8_t gf_size)
+    {
+      encoder<packet_handler> enc{gf_size, packet_handler{}};
+      enc.set_rate(10).set_wire_version(version);
+      decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                               , data_handler{}};
+      dec.set_ack_frequency(std::chrono::milliseconds{0});
+      REQUIRE(not dec.cumulative_acks());
+
+      const auto d = std::vector<char>(16, 'x');
+      for (auto i = 0; i < 2000; ++i)
+      {
+        enc(data(d.begin(), d.end()));
+      }
+      REQUIRE(enc.window() == 2000);
+
+      // Source 5 is lost, the first repair rebuilds it.
+      for (auto i = 0ul; i < enc.packet_handler().nb_packets(); ++i)
+      {
+        if (i != 5)
+        {
+          dec(enc.packet_handler()[i]);
+        }
+      }
+      dec.generate_ack();
+      REQUIRE(dec.cumulative_acks());
+      REQUIRE(dec.nb_decoded() == 1);
+      REQUIRE(dec.data_handler().nb_data() == 2000);
+
+      // Acks don't grow with the encoder's window.
+      REQUIRE(dec.packet_handler().nb_packets() > 1);
+      for (auto i = 0ul; i < dec.packet_handler().nb_packets(); ++i)
+      {
+        REQUIRE(detail::get_wire_version(dec.packet_handler()[i]) == version);
+        REQUIRE(dec.packet_handler()[i].size() < 64);
+        enc(dec.packet_handler()[i]);
+      }
+      REQUIRE(enc.window() == 0);
+    });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder drops useless repairs before reading their sources")
+{
+  for (const auto version : {wire_version::v1, wire_version::v4})
+  {
+    launch([&](std::uint8_t gf_size)
+    {
+      encoder<packet_handler> enc{gf_size, packet_handler{}};
+      enc.set_rate(4).set_wire_version(version);
+      decoder<packet_handler, data_handler> dec{ gf_size, in_order::no, packet_handler{}
+                                               , data_handler{}};
+
+      const auto d = std::vector<char>(16, 'x');
+      for (auto i = 0; i < 100; ++i)
+      {
+        enc(data(d.begin(), d.end()));
+      }
+      for (auto i = 0ul; i < enc.packet_handler().nb_packets(); ++i)
+      {
+        dec(enc.packet_handler()[i]);
+      }
+      REQUIRE(dec.nb_received_repairs() == 25);
+      REQUIRE(dec.nb_useless_repairs() == 25);
+      REQUIRE(dec.nb_decoded() == 0);
+      REQUIRE(dec.data_handler().nb_data() == 100);
+      REQUIRE(dec.nb_missing_sources() == 0);
+    });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder decodes blocks independently")
+{
+  // Sizes decoded with GF(2^32) are truncated to 16 bits and can be wrong.
+  launch({4,8,16}, [](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_block(8, 3).set_wire_version(wire_version::v5);
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    std::vector<std::vector<char>> sources;
+    for (auto i = 0u; i < 80; ++i)
+    {
+      sources.emplace_back(16, static_cast<char>(i));
+      enc(data(sources.back().begin(), sources.back().end()));
+    }
+    REQUIRE(enc.window() == 0);
+    REQUIRE(enc.packet_handler().nb_packets() == 110);
+
+    // Lose 2 sources of each block of 8 sources and 3 repairs.
+    for (auto i = 0ul; i < enc.packet_handler().nb_packets(); ++i)
+    {
+      if (i % 11 != 1 and i % 11 != 6)
+      {
+        dec(enc.packet_handler()[i]);
+      }
+    }
+    REQUIRE(dec.nb_decoded() == 20);
+    REQUIRE(dec.nb_missing_sources() == 0);
+    REQUIRE(dec.data_handler().nb_data() == 80);
+    for (auto i = 0ul; i < 80; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == sources[i]);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder bounds its window in a one-way operation")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(5);
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_frequency(std::chrono::milliseconds{0});
+    dec.set_max_span(10);
+    REQUIRE(dec.max_span() == 10);
+
+    for (auto i = 0u; i < 100; ++i)
+    {
+      enc(data(16, static_cast<char>(i)));
+    }
+    REQUIRE(enc.packet_handler().nb_packets() == 120);
+
+    // Source 2 and all repairs are lost.
+    for (auto i = 0ul; i < enc.packet_handler().nb_packets(); ++i)
+    {
+      auto& p = enc.packet_handler()[i];
+      if (i != 2 and detail::get_packet_type(p) == detail::packet_type::source)
+      {
+        dec(p);
+        if (i == 13)
+        {
+          // Sources wait for source 2 until source 12 is received.
+          REQUIRE(dec.data_handler().nb_data() == 2);
+        }
+      }
+    }
+    REQUIRE(dec.data_handler().nb_data() == 99);
+    REQUIRE(dec.data_handler()[2] == std::vector<char>(16, 3));
+
+    // Too late.
+    dec(enc.packet_handler()[2]);
+    REQUIRE(dec.data_handler().nb_data() == 99);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder gives up on missing sources after a deadline")
+{
+  // Sizes decoded with GF(2^32) are truncated to 16 bits and can be wrong.
+  launch({4,8,16}, [](std::uint8_t gf_size)
+  {
+    for (const auto ordered : {in_order::yes, in_order::no})
+    {
+      encoder<packet_handler> enc{gf_size, packet_handler{}};
+      enc.set_rate(5);
+      decoder<packet_handler, data_handler> dec{gf_size, ordered, packet_handler{}, data_handler{}};
+      dec.set_ack_frequency(std::chrono::milliseconds{0});
+      dec.set_max_latency(std::chrono::milliseconds{50});
+      REQUIRE(dec.max_latency() == std::chrono::milliseconds{50});
+
+      for (auto i = 0u; i < 10; ++i)
+      {
+        enc(data(16, static_cast<char>(i)));
+      }
+      // s0 s1 s2 s3 s4 r0 s5 s6 s7 s8 s9 r1
+      REQUIRE(enc.packet_handler().nb_packets() == 12);
+
+      // Sources 1 and 2 are lost, repairs come late.
+      for (const auto i : {0ul, 3ul, 4ul, 6ul})
+      {
+        dec(enc.packet_handler()[i]);
+      }
+      REQUIRE(dec.data_handler().nb_data() == (ordered == in_order::yes ? 1 : 4));
+
+      // Nothing expires before the deadline.
+      dec.expire();
+      REQUIRE(dec.data_handler().nb_data() == (ordered == in_order::yes ? 1 : 4));
+
+      std::this_thread::sleep_for(std::chrono::milliseconds{60});
+      dec(enc.packet_handler()[7]);
+      REQUIRE(dec.data_handler().nb_data() == 5);
+      REQUIRE(dec.data_handler()[1] == std::vector<char>(16, 3));
+
+      // Repairs can't deliver the given up sources anymore.
+      dec(enc.packet_handler()[5]);
+      dec(enc.packet_handler()[11]);
+      REQUIRE(dec.data_handler().nb_data() == 5);
+      for (const auto i : {8ul, 9ul, 10ul})
+      {
+        dec(enc.packet_handler()[i]);
+      }
+      REQUIRE(dec.data_handler().nb_data() == 8);
+      REQUIRE(dec.data_handler()[7] == std::vector<char>(16, 9));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder bounds the reordering delay of in-order delivery")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(5);
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> gaps;
+    dec.set_max_latency(std::chrono::milliseconds{50})
+       .set_gap_handler([&](std::uint32_t first, std::uint32_t last)
+                        {
+                          gaps.emplace_back(first, last);
+                          // Data after the gap are not delivered yet.
+                          REQUIRE(dec.data_handler().nb_data() == 1);
+                        });
+
+    for (auto i = 0u; i < 10; ++i)
+    {
+      enc(data(16, static_cast<char>(i)));
+    }
+    // s0 s1 s2 s3 s4 r0 s5 s6 s7 s8 s9 r1
+
+    // Sources 1 and 2 and all repairs are lost.
+    for (const auto i : {0ul, 3ul, 4ul})
+    {
+      dec(enc.packet_handler()[i]);
+    }
+    REQUIRE(dec.data_handler().nb_data() == 1);
+    REQUIRE(gaps.empty());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{60});
+    dec.expire();
+    REQUIRE((gaps == std::vector<std::pair<std::uint32_t, std::uint32_t>>{{1, 3}}));
+    REQUIRE(dec.nb_skipped_sources() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 3);
+    REQUIRE(dec.data_handler()[1] == std::vector<char>(16, 3));
+
+    // No more gap.
+    for (const auto i : {6ul, 7ul, 8ul, 9ul, 10ul})
+    {
+      dec(enc.packet_handler()[i]);
+    }
+    REQUIRE(dec.data_handler().nb_data() == 8);
+    REQUIRE(gaps.size() == 1);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder gives up on missing sources waited for by decoded sources")
+{
+  // Sizes decoded with GF(2^32) are truncated to 16 bits and can be wrong.
+  launch({4,8,16}, [](std::uint8_t gf_size)
+  {
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_frequency(std::chrono::milliseconds{0});
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> gaps;
+    dec.set_max_latency(std::chrono::milliseconds{50})
+       .set_gap_handler([&](std::uint32_t first, std::uint32_t last)
+                        {
+                          gaps.emplace_back(first, last);
+                          // The decoded source is not delivered yet.
+                          REQUIRE(dec.data_handler().nb_data() == 1);
+                        });
+
+    // A repair of sources 0 and 2, thus source 1 is never rebuilt.
+    detail::source_list sl;
+    add_source(sl, 0, detail::byte_buffer(16, 'a'));
+    add_source(sl, 2, detail::byte_buffer(16, 'c'));
+    detail::encoder encoder{gf_size};
+    detail::encoder_repair r{0};
+    encoder(r, sl);
+    packet_handler h;
+    detail::packetizer<packet_handler> serializer{h};
+    serializer.write_source(*sl.cbegin());
+    serializer.write_repair(r, wire_version::v2);
+
+    // Source 2 is decoded, then waits for source 1.
+    dec(h[0]);
+    dec(h[1]);
+    REQUIRE(dec.nb_decoded() == 1);
+    REQUIRE(dec.data_handler().nb_data() == 1);
+    REQUIRE(gaps.empty());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{60});
+    dec.expire();
+    REQUIRE((gaps == std::vector<std::pair<std::uint32_t, std::uint32_t>>{{1, 2}}));
+    REQUIRE(dec.nb_skipped_sources() == 1);
+    REQUIRE(dec.data_handler().nb_data() == 2);
+    REQUIRE(dec.data_handler()[1] == std::vector<char>(16, 'c'));
   });
 }
 
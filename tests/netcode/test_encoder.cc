@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 #include <catch.hpp>
 #include "tests/netcode/common.hh"
@@ -202,7 +204,7 @@ TEST_CASE("Encoder correctly handles new incoming packets")
     SECTION("incoming source")
     {
       // Create a source.
-      const auto source = detail::encoder_source{0, {}};
+      const auto source = detail::encoder_source{0, nullptr, 0};
       
       // Serialize the source.
       serializer.write_source(source);
@@ -382,7 +384,8 @@ TEST_CASE("Encoder rejects sources and repairs")
 
     SECTION("source")
     {
-      serializer.write_source(detail::encoder_source{394839, {'a', 'b', 'c', 'd'}});
+      const auto data = detail::byte_buffer{'a', 'b', 'c', 'd'};
+      serializer.write_source(detail::encoder_source{394839, data.data(), 4});
       REQUIRE_THROWS_AS(encoder(h[0]), packet_type_error);
     }
 
@@ -447,3 +450,405 @@ TEST_CASE("Encoder adapts rate automatically")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder negotiates the wire format with acks")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(1);
+    REQUIRE(enc.wire_version() == wire_version::v1);
+
+    // Simulate decoder.
+    packet_handler h_decoder;
+    detail::packetizer<packet_handler> serializer{h_decoder};
+
+    const auto d = std::vector<char>(32, 'x');
+    enc(data(d.begin(), d.end()));
+    REQUIRE(enc.packet_handler().nb_packets() == 2);
+    REQUIRE(detail::get_wire_version(enc.packet_handler()[1]) == wire_version::v1);
+
+    // A decoder which understands v2.
+    serializer.write_ack(detail::ack{{0}, 2, wire_version::v2});
+    REQUIRE_NOTHROW(enc(packet{h_decoder[0]}));
+    REQUIRE(enc.wire_version() == wire_version::v2);
+
+    enc(data(d.begin(), d.end()));
+    REQUIRE(enc.packet_handler().nb_packets() == 4);
+    REQUIRE(detail::get_packet_type(enc.packet_handler()[3]) == detail::packet_type::repair);
+    REQUIRE(detail::get_wire_version(enc.packet_handler()[3]) == wire_version::v2);
+    // The repair no longer carries its symbol twice.
+    REQUIRE(enc.packet_handler()[3].size() < enc.packet_handler()[1].size());
+
+    // A decoder which only knows v1 doesn't write its version.
+    serializer.write_ack(detail::ack{{1}, 2});
+    auto v1_ack = packet{h_decoder[1]};
+    v1_ack.resize(v1_ack.size() - 1);
+    REQUIRE_NOTHROW(enc(std::move(v1_ack)));
+    REQUIRE(enc.wire_version() == wire_version::v1);
+
+    // A decoder which understands cumulative acks.
+    serializer.write_ack(detail::ack{{2}, 2});
+    REQUIRE_NOTHROW(enc(packet{h_decoder[2]}));
+    REQUIRE(enc.wire_version() == wire_version::v5);
+    enc(data(d.begin(), d.end()));
+    REQUIRE(enc.packet_handler().nb_packets() == 6);
+    REQUIRE(detail::get_wire_version(enc.packet_handler()[5]) == wire_version::v5);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder removes the sources of a cumulative ack")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+    const auto d = std::vector<char>(32, 'x');
+    for (auto i = 0; i < 20; ++i)
+    {
+      enc(data(d.begin(), d.end()));
+    }
+    REQUIRE(enc.window() == 20);
+
+    packet_handler h_decoder;
+    detail::packetizer<packet_handler> serializer{h_decoder};
+
+    // Sources 0 to 4 are acknowledged, as well as 7, 8 and 12.
+    serializer.write_ack(detail::ack{5, {{7, 9}, {12, 13}}, 10});
+    REQUIRE_NOTHROW(enc(packet{h_decoder[0]}));
+    REQUIRE(enc.window() == 12);
+
+    // Sources 5 and 6 have been decoded since.
+    serializer.write_ack(detail::ack{9, {}, 10});
+    REQUIRE_NOTHROW(enc(packet{h_decoder[1]}));
+    REQUIRE(enc.window() == 10);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder generates the repairs of a batch after its sources")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    const auto d = std::vector<char>(32, 'x');
+    const auto batch = std::vector<data>(6, data(d.begin(), d.end()));
+    const auto type = [](const packet& p){return detail::get_packet_type(p);};
+    const auto source = detail::packet_type::source;
+    const auto repair = detail::packet_type::repair;
+
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(2);
+
+    SECTION("Unlimited window")
+    {
+      enc.commit(batch);
+      REQUIRE(enc.window() == 6);
+      REQUIRE(enc.nb_sent_sources() == 6);
+      REQUIRE(enc.nb_sent_repairs() == 3);
+
+      const auto& h = enc.packet_handler();
+      REQUIRE(h.nb_packets() == 9);
+      for (auto i = 0ul; i < 6; ++i)
+      {
+        REQUIRE(type(h[i]) == source);
+      }
+      REQUIRE(type(h[6]) == repair);
+      REQUIRE(type(h[7]) == repair);
+      REQUIRE(type(h[8]) == repair);
+    }
+
+    SECTION("Pending repairs are generated before a source leaves the window")
+    {
+      enc.set_window_size(4);
+      enc.commit(begin(batch), end(batch));
+      REQUIRE(enc.window() == 4);
+      REQUIRE(enc.nb_sent_repairs() == 3);
+
+      const auto& h = enc.packet_handler();
+      REQUIRE(h.nb_packets() == 9);
+      REQUIRE(type(h[3]) == source);
+      REQUIRE(type(h[4]) == repair);
+      REQUIRE(type(h[5]) == repair);
+      REQUIRE(type(h[6]) == source);
+      REQUIRE(type(h[7]) == source);
+      REQUIRE(type(h[8]) == repair);
+    }
+
+    SECTION("Non systematic code")
+    {
+      enc.set_code_type(systematic::no);
+      enc.commit(batch);
+      REQUIRE(enc.nb_sent_sources() == 0);
+      REQUIRE(enc.nb_sent_repairs() == 9);
+      REQUIRE(enc.packet_handler().nb_packets() == 9);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder takes data written in place")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(2).set_window_size(3);
+
+    const auto s0 = {'a','b','c','d','e','f','g','h'};
+    for (auto i = 0ul; i < 4; ++i)
+    {
+      const auto buffer = enc.reserve_source(64);
+      REQUIRE((reinterpret_cast<std::uintptr_t>(buffer) % 16) == 0);
+      std::copy(begin(s0), end(s0), buffer);
+      enc.commit_reserved(s0.size());
+    }
+    REQUIRE(enc.window() == 3);
+    REQUIRE(enc.nb_sent_sources() == 4);
+    REQUIRE(enc.nb_sent_repairs() == 2);
+
+    // The same packets as if the data had been copied.
+    encoder<packet_handler> ref{gf_size, packet_handler{}};
+    ref.set_rate(2).set_window_size(3);
+    for (auto i = 0ul; i < 4; ++i)
+    {
+      ref(data{begin(s0), end(s0)});
+    }
+    REQUIRE(enc.packet_handler().nb_packets() == ref.packet_handler().nb_packets());
+    for (auto i = 0ul; i < ref.packet_handler().nb_packets(); ++i)
+    {
+      const auto& p0 = enc.packet_handler()[i];
+      const auto& p1 = ref.packet_handler()[i];
+      REQUIRE(p0.size() == p1.size());
+      REQUIRE(std::equal(p0.begin(), p0.end(), p1.begin()));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder bounds the sources encoded by a repair")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    const auto data = std::vector<char>(100, 'x');
+
+    encoder<packet_handler> encoder{gf_size, packet_handler{}};
+    encoder.set_rate(2).set_band_width(4);
+    REQUIRE(encoder.band_width() == 4);
+
+    for (auto i = 0ul; i < 5; ++i)
+    {
+      encoder(ntc::data(data.begin(), data.begin() + 32));
+    }
+    REQUIRE(encoder.nb_sent_repairs() == 2);
+    REQUIRE(encoder.window() == 5);
+
+    // The next repair encodes only the 4 most recent sources, the oldest ones are dropped.
+    encoder(ntc::data(data.begin(), data.begin() + 32));
+    REQUIRE(encoder.nb_sent_repairs() == 3);
+    REQUIRE(encoder.window() == 4);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder protects all sources of a batch with a band")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    for (const auto batch : {false, true})
+    {
+      encoder<packet_handler> enc{gf_size, packet_handler{}};
+      enc.set_rate(4).set_band_width(4);
+
+      const auto d = std::vector<char>(32, 'x');
+      if (batch)
+      {
+        enc.commit(std::vector<data>(16, data(d.begin(), d.end())));
+      }
+      else
+      {
+        for (auto i = 0; i < 16; ++i)
+        {
+          enc(data(d.begin(), d.end()));
+        }
+      }
+      REQUIRE(enc.nb_sent_repairs() == 4);
+      REQUIRE(enc.packet_handler().nb_packets() == 20);
+
+      // Each repair encodes the 4 sources which precede it.
+      detail::packetizer<packet_handler> serializer{enc.packet_handler()};
+      for (auto i = 0u; i < 4; ++i)
+      {
+        auto& p = enc.packet_handler()[i * 5 + 4];
+        REQUIRE(detail::get_packet_type(p) == detail::packet_type::repair);
+        const auto r = serializer.read_repair(packet{p}).first;
+        REQUIRE(r.source_ids().size() == 4);
+        REQUIRE(*r.source_ids().begin() == i * 4);
+        REQUIRE(*r.source_ids().rbegin() == i * 4 + 3);
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder protects the sources of a batch which expire")
+{
+  // Gives data, but waits before giving the one at slow.
+  struct slow_iterator
+  {
+    std::vector<data>::const_iterator it;
+    std::vector<data>::const_iterator slow;
+
+    const data&
+    operator*()
+    const
+    {
+      if (it == slow)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds{60});
+      }
+      return *it;
+    }
+
+    slow_iterator&
+    operator++()
+    {
+      ++it;
+      return *this;
+    }
+
+    bool
+    operator!=(const slow_iterator& other)
+    const
+    {
+      return it != other.it;
+    }
+  };
+
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(4).set_band_width(8).set_max_age(std::chrono::milliseconds{50});
+
+    const auto d = std::vector<char>(32, 'x');
+    const auto batch = std::vector<data>(8, data(d.begin(), d.end()));
+    // Sources 0 to 3 expire before source 4 is added.
+    enc.commit( slow_iterator{batch.cbegin(), batch.cbegin() + 4}
+              , slow_iterator{batch.cend(), batch.cbegin() + 4});
+    REQUIRE(enc.nb_sent_repairs() == 2);
+    REQUIRE(enc.window() == 4);
+    REQUIRE(enc.packet_handler().nb_packets() == 10);
+
+    // The first repair was generated before sources 0 to 3 were dropped.
+    detail::packetizer<packet_handler> serializer{enc.packet_handler()};
+    for (const auto i : {4ul, 9ul})
+    {
+      auto& p = enc.packet_handler()[i];
+      REQUIRE(detail::get_packet_type(p) == detail::packet_type::repair);
+      const auto first = i == 4 ? 0u : 4u;
+      const auto r = serializer.read_repair(packet{p}).first;
+      REQUIRE(r.source_ids().size() == 4);
+      REQUIRE(*r.source_ids().begin() == first);
+      REQUIRE(*r.source_ids().rbegin() == first + 3);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder sends repairs by blocks")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    for (const auto batch : {false, true})
+    {
+      encoder<packet_handler> enc{gf_size, packet_handler{}};
+      enc.set_block(8, 2).set_wire_version(wire_version::v5);
+      REQUIRE(enc.block_size() == 8);
+      REQUIRE(enc.block_nb_repairs() == 2);
+
+      const auto d = std::vector<char>(32, 'x');
+      if (batch)
+      {
+        enc.commit(std::vector<data>(20, data(d.begin(), d.end())));
+      }
+      else
+      {
+        for (auto i = 0; i < 20; ++i)
+        {
+          enc(data(d.begin(), d.end()));
+        }
+      }
+
+      // 2 full blocks, each followed by its repairs, then the beginning of the third one.
+      REQUIRE(enc.nb_sent_repairs() == 4);
+      REQUIRE(enc.window() == 4);
+      REQUIRE(enc.packet_handler().nb_packets() == 24);
+
+      detail::packetizer<packet_handler> serializer{enc.packet_handler()};
+      for (const auto i : {8ul, 9ul, 18ul, 19ul})
+      {
+        auto& p = enc.packet_handler()[i];
+        REQUIRE(detail::get_packet_type(p) == detail::packet_type::repair);
+        REQUIRE(detail::ends_block(p));
+        const auto first = i < 10 ? 0u : 8u;
+        const auto r = serializer.read_repair(packet{p}).first;
+        REQUIRE(r.source_ids().size() == 8);
+        REQUIRE(*r.source_ids().begin() == first);
+        REQUIRE(*r.source_ids().rbegin() == first + 7);
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder expires sources by age")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+    REQUIRE(enc.max_age() == std::chrono::milliseconds{0});
+
+    const auto d = std::vector<char>(32, 'x');
+    for (auto i = 0; i < 3; ++i)
+    {
+      enc(data(d.begin(), d.end()));
+    }
+    // Sources don't expire by default.
+    REQUIRE(enc.expire() == 0);
+    REQUIRE(enc.window() == 3);
+
+    // Sources committed before the age is set are dated too.
+    enc.set_max_age(std::chrono::milliseconds{50});
+    REQUIRE(enc.expire() == 0);
+    REQUIRE(enc.window() == 3);
+
+    for (auto i = 0; i < 3; ++i)
+    {
+      enc(data(d.begin(), d.end()));
+    }
+    REQUIRE(enc.window() == 6);
+    std::this_thread::sleep_for(std::chrono::milliseconds{60});
+
+    // Expired sources are dropped before a new one is added.
+    enc(data(d.begin(), d.end()));
+    REQUIRE(enc.window() == 1);
+    REQUIRE(enc.nb_received_acks() == 0);
+
+    enc.generate_repair();
+    detail::packetizer<packet_handler> serializer{enc.packet_handler()};
+    auto& last = enc.packet_handler()[enc.packet_handler().nb_packets() - 1];
+    const auto r = serializer.read_repair(packet{last}).first;
+    REQUIRE(r.source_ids().size() == 1);
+    REQUIRE(*r.source_ids().begin() == 6);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -143,3 +143,55 @@ TEST_CASE("Packet resizing")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet from a pool")
+{
+  packet_pool pool{2};
+  REQUIRE(pool.size() == 0);
+
+  const char* data = nullptr;
+  {
+    packet p{pool, 100};
+    REQUIRE(p.size() == 100);
+    REQUIRE(pool.nb_allocations() == 1);
+    data = p.data();
+  }
+  // The buffer is back in the pool.
+  REQUIRE(pool.size() == 1);
+
+  {
+    packet p{pool, 50, 'x'};
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.nb_allocations() == 1);
+    REQUIRE(static_cast<const void*>(p.data()) == static_cast<const void*>(data));
+    REQUIRE(p.size() == 50);
+    REQUIRE(std::all_of(p.begin(), p.end(), [](char x){return x == 'x';}));
+
+    // The moved-from packet doesn't give back anything.
+    packet q{std::move(p)};
+    REQUIRE(static_cast<const void*>(q.data()) == static_cast<const void*>(data));
+  }
+  REQUIRE(pool.size() == 1);
+
+  SECTION("move assignment gives back the previous buffer")
+  {
+    packet p{pool, 10};
+    packet q{pool, 10};
+    REQUIRE(pool.nb_allocations() == 2);
+    p = std::move(q);
+    REQUIRE(pool.size() == 1);
+  }
+
+  SECTION("the pool keeps a bounded number of buffers")
+  {
+    {
+      packet p0{pool, 10};
+      packet p1{pool, 10};
+      packet p2{pool, 10};
+    }
+    REQUIRE(pool.nb_allocations() == 3);
+    REQUIRE(pool.size() == 2);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,195 @@
+#include <algorithm> // equal
+#include <cstdint>
+#include <cstring> // memcpy, memset
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+#include "tests/netcode/launch.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/packet_ring.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+bool
+equal(const packet& p, std::initializer_list<char> bytes)
+{
+  return p.size() == bytes.size() and std::equal(bytes.begin(), bytes.end(), p.begin());
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet ring capacity is a power of 2")
+{
+  REQUIRE(packet_ring(1, 16).capacity() == 1);
+  REQUIRE(packet_ring(5, 16).capacity() == 8);
+  REQUIRE(packet_ring(64, 16).capacity() == 64);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet ring exchanges packets")
+{
+  packet_ring ring{4, 16};
+  REQUIRE(ring.empty());
+
+  auto p = packet{'a', 'b'};
+  REQUIRE(ring.push(p));
+  // p now holds one of the packets of the ring.
+  REQUIRE(p.size() == 0);
+  REQUIRE(p.capacity() >= 16);
+  REQUIRE(ring.size() == 1);
+
+  auto q = packet{};
+  REQUIRE(ring.pop(q));
+  REQUIRE(equal(q, {'a', 'b'}));
+  REQUIRE(ring.empty());
+  REQUIRE(not ring.pop(q));
+  REQUIRE(equal(q, {'a', 'b'}));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet ring pushes and pops batches")
+{
+  packet_ring ring{4, 16};
+
+  std::vector<packet> in;
+  for (auto i = 0; i < 6; ++i)
+  {
+    in.push_back(packet{static_cast<char>(i)});
+  }
+
+  // Only 4 packets fit.
+  REQUIRE(ring.push(in.begin(), in.end()) == 4);
+  REQUIRE(ring.size() == 4);
+  REQUIRE(equal(in[4], {4}));
+  REQUIRE(not ring.push(in[4]));
+
+  std::vector<packet> out(3);
+  REQUIRE(ring.pop(out.begin(), out.end()) == 3);
+  for (auto i = 0; i < 3; ++i)
+  {
+    REQUIRE(equal(out[static_cast<std::size_t>(i)], {static_cast<char>(i)}));
+  }
+
+  // Wraps around.
+  REQUIRE(ring.push(in.begin() + 4, in.end()) == 2);
+  REQUIRE(ring.pop(out.begin(), out.end()) == 3);
+  for (auto i = 0; i < 3; ++i)
+  {
+    REQUIRE(equal(out[static_cast<std::size_t>(i)], {static_cast<char>(i + 3)}));
+  }
+  REQUIRE(ring.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet ring writer drops packets when the ring is full")
+{
+  packet_ring ring{2, 16};
+  auto writer = ring.make_writer();
+
+  for (auto i = 0; i < 3; ++i)
+  {
+    auto buffer = writer(3);
+    std::memset(buffer, 'a' + i, 3);
+    writer();
+  }
+  REQUIRE(ring.size() == 2);
+  REQUIRE(ring.nb_dropped() == 1);
+
+  auto p = packet{};
+  REQUIRE(ring.pop(p));
+  REQUIRE(equal(p, {'a', 'a', 'a'}));
+  REQUIRE(ring.pop(p));
+  REQUIRE(equal(p, {'b', 'b', 'b'}));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet ring between an encoder and a decoder")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    packet_ring ring{64, 2048};
+    encoder<packet_ring::writer> enc{gf_size, ring.make_writer()};
+    enc.set_rate(4);
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    for (auto i = 0; i < 8; ++i)
+    {
+      enc(data(100, static_cast<char>('a' + i)));
+    }
+    REQUIRE(ring.size() == 10);
+
+    std::vector<packet> batch(16);
+    const auto nb = ring.pop(batch.begin(), batch.end());
+    REQUIRE(nb == 10);
+    dec.receive(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(nb));
+    REQUIRE(dec.data_handler().nb_data() == 8);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet ring between two threads")
+{
+  static constexpr auto nb_packets = 100000u;
+  packet_ring ring{128, 16};
+
+  std::thread producer{[&]
+  {
+    auto p = packet{};
+    for (auto i = 0u; i < nb_packets;)
+    {
+      p.resize(sizeof(i));
+      std::memcpy(p.data(), &i, sizeof(i));
+      if (ring.push(p))
+      {
+        ++i;
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  auto nb_errors = 0u;
+  auto expected = 0u;
+  std::vector<packet> batch(32);
+  while (expected < nb_packets)
+  {
+    const auto nb = ring.pop(batch.begin(), batch.end());
+    for (auto i = 0ul; i < nb; ++i, ++expected)
+    {
+      auto value = 0u;
+      std::memcpy(&value, batch[i].data(), sizeof(value));
+      nb_errors += value == expected ? 0 : 1;
+    }
+    if (nb == 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  REQUIRE(nb_errors == 0);
+  REQUIRE(ring.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -136,7 +136,7 @@ TEST_CASE("Encode two sources")
                         ^ r0.encoded_size();
 
       // Second, remove data.
-      gf.multiply_add(s1.symbol().data(), r0.symbol().data(), s1.size(), c1);
+      gf.multiply_add(s1.symbol(), r0.symbol().data(), s1.size(), c1);
 
       // The inverse of the coefficient.
       const auto inv0 = gf.invert(c0);
@@ -148,7 +148,7 @@ TEST_CASE("Encode two sources")
       // Now, reconstruct missing data.
       detail::decoder_source s0_dst{1, detail::byte_buffer(src_size), src_size};
       gf.multiply(r0.symbol().data(), s0_dst.symbol(), src_size, inv0);
-      REQUIRE(s0.symbol().size() == s0_dst.symbol_size());
+      REQUIRE(s0.size() == s0_dst.symbol_size());
       for (auto i = 0ul; i < src_size; ++i)
       {
         REQUIRE(s0.symbol()[i] == s0_dst.symbol()[i]);
@@ -161,7 +161,7 @@ TEST_CASE("Encode two sources")
       r0.encoded_size() = gf.multiply_size(static_cast<std::uint16_t>(s0_data.size()), c0)
                         ^ r0.encoded_size();
       // Second, remove data.
-      gf.multiply_add(s0.symbol().data(), r0.symbol().data(), s0.size(), c0);
+      gf.multiply_add(s0.symbol(), r0.symbol().data(), s0.size(), c0);
 
       // The inverse of the coefficient.
       const auto inv1 = gf.invert(c1);
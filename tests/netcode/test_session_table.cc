@@ -0,0 +1,232 @@
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/launch.hh"
+
+#include "netcode/session_table.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Packets sent by a session table, shared by the handlers of all its shards.
+struct network
+{
+  std::mutex mutex;
+  std::deque<packet> packets;
+};
+
+struct network_handler
+{
+  network* net;
+
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    std::lock_guard<std::mutex> lock{net->mutex};
+    net->packets.emplace_back(data, data + len);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Data received by a session table, for each flow.
+struct received
+{
+  std::mutex mutex;
+  std::map<std::uint32_t, std::vector<std::vector<char>>> data;
+  std::size_t nb;
+};
+
+struct received_handler
+{
+  received* rec;
+
+  void
+  operator()(std::uint32_t flow, const char* data, std::size_t len)
+  {
+    std::lock_guard<std::mutex> lock{rec->mutex};
+    rec->data[flow].emplace_back(data, data + len);
+    ++rec->nb;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+using table_type = session_table<network_handler, received_handler>;
+
+// Give all packets sent on a network to a table.
+void
+deliver(network& net, table_type& table)
+{
+  auto packets = std::deque<packet>{};
+  {
+    std::lock_guard<std::mutex> lock{net.mutex};
+    std::swap(packets, net.packets);
+  }
+  for (auto& p : packets)
+  {
+    table(std::move(p));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table demultiplexes flows over several shards")
+{
+  launch({4,8,16}, [](std::uint8_t gf_size)
+  {
+    static constexpr auto nb_flows = 8u;
+    static constexpr auto nb_data = 10u;
+
+    network to_a;
+    network to_b;
+    received rec_a;
+    received rec_b;
+    rec_a.nb = 0;
+    rec_b.nb = 0;
+
+    table_type a{3, gf_size, in_order::yes, network_handler{&to_b}, received_handler{&rec_a}};
+    table_type b{2, gf_size, in_order::yes, network_handler{&to_a}, received_handler{&rec_b}};
+    REQUIRE(a.nb_shards() == 3);
+    REQUIRE(a.shard_of(7) == 1);
+
+    for (auto flow = 0u; flow < nb_flows; ++flow)
+    {
+      a.add_flow(flow, [](table_type::encoder_type& enc, table_type::decoder_type&)
+                       {
+                         enc.set_rate(3);
+                       });
+      b.add_flow(flow);
+    }
+
+    for (auto i = 0u; i < nb_data; ++i)
+    {
+      for (auto flow = 0u; flow < nb_flows; ++flow)
+      {
+        a.send(flow, data{static_cast<char>(flow), static_cast<char>(i)});
+      }
+    }
+
+    // Forward packets both ways until all data are received.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+      deliver(to_b, b);
+      deliver(to_a, a);
+      {
+        std::lock_guard<std::mutex> lock{rec_b.mutex};
+        if (rec_b.nb == nb_flows * nb_data)
+        {
+          break;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    std::lock_guard<std::mutex> lock{rec_b.mutex};
+    REQUIRE(rec_b.nb == nb_flows * nb_data);
+    for (auto flow = 0u; flow < nb_flows; ++flow)
+    {
+      const auto& flow_data = rec_b.data[flow];
+      REQUIRE(flow_data.size() == nb_data);
+      for (auto i = 0u; i < nb_data; ++i)
+      {
+        REQUIRE((flow_data[i] == std::vector<char>{static_cast<char>(flow), static_cast<char>(i)}));
+      }
+    }
+    REQUIRE(a.nb_dropped() == 0);
+    REQUIRE(b.nb_dropped() == 0);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table drops packets of unknown flows")
+{
+  network net;
+  received rec;
+  rec.nb = 0;
+  table_type table{2, 8, in_order::yes, network_handler{&net}, received_handler{&rec}};
+  table.add_flow(1);
+
+  // Too small to carry a flow identifier.
+  REQUIRE_THROWS_AS(table(packet{'\x00', '\x00', '\x00', '\x01'}), packet_type_error);
+
+  // A source of flow 2, which is not registered.
+  const auto p = packet{'\x02', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x02'};
+  REQUIRE(table_type::flow_of(p) == 2);
+  table(packet{p});
+
+  // An invalid packet of flow 1.
+  table(packet{'\x0f', '\x00', '\x00', '\x00', '\x01'});
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+  while (table.nb_dropped() != 2 and std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  REQUIRE(table.nb_dropped() == 2);
+  REQUIRE(rec.nb == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table counts the work which failed")
+{
+  network net;
+  received rec;
+  rec.nb = 0;
+  table_type table{2, 8, in_order::yes, network_handler{&net}, received_handler{&rec}};
+
+  // The flow is not registered when its configuration throws.
+  table.add_flow(1, [](table_type::encoder_type&, table_type::decoder_type&)
+                    {
+                      throw std::runtime_error{"configuration"};
+                    });
+  table.send(1, data{'a', 'b'});
+  table.add_flow(2);
+  table.send(2, data{'a', 'b'});
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+  while ( table.nb_dropped() + table.nb_failed() != 2
+        and std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  REQUIRE(table.nb_failed() == 1);
+  REQUIRE(table.nb_dropped() == 1);
+
+  // The shard still works.
+  while (true)
+  {
+    {
+      std::lock_guard<std::mutex> lock{net.mutex};
+      if (not net.packets.empty() or std::chrono::steady_clock::now() >= deadline)
+      {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  std::lock_guard<std::mutex> lock{net.mutex};
+  REQUIRE(net.packets.size() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
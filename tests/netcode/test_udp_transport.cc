@@ -0,0 +1,215 @@
+#if defined(__linux__)
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstring> // memset
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+#include "tests/netcode/launch.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/udp_transport.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A UDP socket bound on the loopback.
+struct loopback_socket
+{
+  int fd;
+
+  loopback_socket()
+    : fd{::socket(AF_INET, SOCK_DGRAM, 0)}
+  {
+    REQUIRE(fd >= 0);
+    auto addr = address();
+    addr.sin_port = 0;
+    REQUIRE(::bind(fd, reinterpret_cast<const ::sockaddr*>(&addr), sizeof(addr)) == 0);
+    // Don't wait forever if a packet is lost.
+    const auto timeout = ::timeval{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+
+  ~loopback_socket()
+  {
+    ::close(fd);
+  }
+
+  ::sockaddr_in
+  address()
+  const
+  {
+    ::sockaddr_in addr;
+    auto len = static_cast<::socklen_t>(sizeof(addr));
+    std::memset(&addr, 0, sizeof(addr));
+    ::getsockname(fd, reinterpret_cast<::sockaddr*>(&addr), &len);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+  }
+
+  void
+  connect(const loopback_socket& other)
+  {
+    const auto addr = other.address();
+    REQUIRE(::connect(fd, reinterpret_cast<const ::sockaddr*>(&addr), sizeof(addr)) == 0);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport sends and receives batches")
+{
+  for (const auto offload : {false, true})
+  {
+    loopback_socket a;
+    loopback_socket b;
+    a.connect(b);
+    udp_transport tx{a.fd, 32, 512};
+    udp_transport rx{b.fd, 32, 512};
+    tx.set_segmentation_offload(offload);
+    rx.set_receive_offload(offload);
+
+    // A run of packets of the same size, ended by a smaller one, then packets of another size.
+    std::vector<std::size_t> sizes(10, 100);
+    sizes.push_back(50);
+    sizes.insert(sizes.end(), 5, 300);
+
+    auto writer = tx.make_writer();
+    for (auto i = 0ul; i < sizes.size(); ++i)
+    {
+      std::memset(writer(sizes[i]), static_cast<int>(i), sizes[i]);
+      writer();
+    }
+    REQUIRE(tx.nb_send_calls() == 0);
+    tx.flush();
+    REQUIRE(tx.nb_send_calls() == 1);
+    REQUIRE(tx.nb_sent_packets() == sizes.size());
+
+    std::vector<packet> packets(sizes.size());
+    auto nb = 0ul;
+    while (nb < sizes.size())
+    {
+      const auto res = rx.receive(packets.begin() + static_cast<std::ptrdiff_t>(nb), packets.end());
+      if (res == 0)
+      {
+        break;
+      }
+      nb += res;
+    }
+    REQUIRE(nb == sizes.size());
+    REQUIRE(rx.nb_received_packets() == sizes.size());
+    for (auto i = 0ul; i < sizes.size(); ++i)
+    {
+      REQUIRE(packets[i].size() == sizes[i]);
+      REQUIRE(packets[i][0] == static_cast<char>(i));
+      REQUIRE(packets[i][sizes[i] - 1] == static_cast<char>(i));
+    }
+    REQUIRE(rx.nb_dropped() == 0);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport only enables receive offload on demand")
+{
+  loopback_socket s;
+  const auto gro = [&]
+  {
+    auto value = 0;
+    auto len = static_cast<::socklen_t>(sizeof(value));
+    ::getsockopt(s.fd, SOL_UDP, UDP_GRO, &value, &len);
+    return value;
+  };
+
+  udp_transport rx{s.fd};
+  REQUIRE(not rx.receive_offload());
+  REQUIRE(gro() == 0);
+
+  if (rx.set_receive_offload(true))
+  {
+    REQUIRE(gro() != 0);
+  }
+  rx.set_receive_offload(false);
+  REQUIRE(gro() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport sends full batches")
+{
+  loopback_socket a;
+  loopback_socket b;
+  a.connect(b);
+  udp_transport tx{a.fd, 4, 512};
+
+  auto writer = tx.make_writer();
+  for (auto i = 0; i < 9; ++i)
+  {
+    std::memset(writer(64), 'x', 64);
+    writer();
+  }
+  // The last packet waits for the next batch.
+  REQUIRE(tx.nb_send_calls() == 2);
+  REQUIRE(tx.nb_sent_packets() == 8);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport between an encoder and a decoder")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    loopback_socket a;
+    loopback_socket b;
+    a.connect(b);
+    udp_transport tx{a.fd};
+    udp_transport rx{b.fd};
+
+    encoder<udp_transport::writer> enc{gf_size, tx.make_writer()};
+    enc.set_rate(4);
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    for (auto i = 0; i < 100; ++i)
+    {
+      enc(data(100, static_cast<char>(i)));
+    }
+    tx.flush();
+    REQUIRE(tx.nb_sent_packets() == 125);
+
+    while (rx.nb_received_packets() < 125)
+    {
+      if (rx.receive(dec) == 0)
+      {
+        break;
+      }
+    }
+    REQUIRE(rx.nb_received_packets() == 125);
+    REQUIRE(dec.nb_received_sources() == 100);
+    REQUIRE(dec.data_handler().nb_data() == 100);
+    REQUIRE(rx.nb_receive_calls() < 125);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#endif // defined(__linux__)
@@ -76,6 +76,7 @@ main(int argc, const char** argv)
         }
 
         case ntc::detail::packet_type::repair:
+        case ntc::detail::packet_type::keyed_repair:
         {
           packetizer.read_repair(ntc::packet{packet});
           break;